@@ -57,10 +57,13 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
+    long long start = kernel->stats->totalTicks;
+
     lock->Acquire();			// only one disk I/O at a time
     disk->ReadRequest(sectorNumber, data);
     semaphore->P();			// wait for interrupt
     lock->Release();
+    kernel->stats->diskLatency.Record(kernel->stats->totalTicks - start);
 }
 
 //----------------------------------------------------------------------
@@ -75,10 +78,13 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
+    long long start = kernel->stats->totalTicks;
+
     lock->Acquire();			// only one disk I/O at a time
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();			// wait for interrupt
     lock->Release();
+    kernel->stats->diskLatency.Record(kernel->stats->totalTicks - start);
 }
 
 //----------------------------------------------------------------------
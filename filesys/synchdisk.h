@@ -44,6 +44,8 @@ class SynchDisk : public CallBackObj {
 					// handler, to signal that the
 					// current disk operation is complete.
 
+    Disk *getDisk() { return disk; }	// the raw disk, to snapshot it
+
   private:
     Disk *disk;		  		// Raw disk device
     Semaphore *semaphore; 		// To synchronize requesting thread 
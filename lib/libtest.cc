@@ -11,6 +11,7 @@
 #include "bitmap.h"
 #include "list.h"
 #include "hash.h"
+#include "slab.h"
 #include "sysdep.h"
 
 //----------------------------------------------------------------------
@@ -60,8 +61,8 @@ static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and 
-//	hash tables.
+//	Run self tests on bitmaps, lists, sorted lists, hash tables,
+//	and slab caches.
 //----------------------------------------------------------------------
 
 void
@@ -77,6 +78,7 @@ LibSelfTest () {
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
+    SlabCache::SelfTest();
 
     delete map;
     delete list;
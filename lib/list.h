@@ -15,6 +15,7 @@
 
 #include "copyright.h"
 #include "debug.h"
+#include "slab.h"
 
 // The following class defines a "list element" -- which is
 // used to keep track of one item on a list.  It is equivalent to a
@@ -30,6 +31,17 @@ class ListElement {
     ListElement(T itm); 	// initialize a list element
     ListElement *next;	     	// next element on list, NULL if this is last
     T item; 	   	     	// item on the list
+
+    // List elements are allocated and freed on every Append and
+    // RemoveFront, so they come from a slab cache, one per type of item.
+    void *operator new(size_t size) { return Cache()->Alloc(size); }
+    void operator delete(void *p, size_t size) { Cache()->Free(p, size); }
+
+  private:
+    static SlabCache *Cache() {
+	static SlabCache cache("ListElement", sizeof(ListElement<T>));
+	return &cache;
+    }
 };
 
 // The following class defines a "list" -- a singly linked list of
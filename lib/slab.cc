@@ -0,0 +1,187 @@
+// slab.cc
+//	Routines to allocate and free small objects from slabs.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "slab.h"
+#include "debug.h"
+
+SlabCache *SlabCache::all = NULL;
+
+//----------------------------------------------------------------------
+// SlabCache::SlabCache
+// 	Initialize an empty cache, and add it to the list of all caches.
+//
+//	"cacheName" says what kind of object the cache is for.
+//	"size" is the size of each object, in bytes.
+//----------------------------------------------------------------------
+
+SlabCache::SlabCache(char *cacheName, int size)
+{
+    name = cacheName;
+    objectSize = size;
+    slotSize = max(size, (int) sizeof(void *));	// room for the link
+    free = NULL;
+    numAllocs = numFrees = numSlabs = 0;
+    next = all;
+    all = this;
+}
+
+//----------------------------------------------------------------------
+// SlabCache::Grow
+// 	Allocate a new slab from the heap, and put all of its objects
+//	on the free list.
+//----------------------------------------------------------------------
+
+void
+SlabCache::Grow()
+{
+    char *slab = new char[SlabObjects * slotSize];
+
+    for (int i = SlabObjects - 1; i >= 0; i--) {
+	void *object = slab + i * slotSize;
+
+	*(void **) object = free;
+	free = object;
+    }
+    numSlabs++;
+}
+
+//----------------------------------------------------------------------
+// SlabCache::Alloc
+// 	Return space for an object, from the free list.  An object of
+//	some other size than the cache is for (a subclass, say) comes
+//	from the heap instead.
+//----------------------------------------------------------------------
+
+void *
+SlabCache::Alloc(size_t size)
+{
+    void *object;
+
+    if (size != (size_t) objectSize) {
+	return ::operator new(size);
+    }
+    if (free == NULL) {
+	Grow();
+    }
+    object = free;
+    free = *(void **) object;
+    numAllocs++;
+    return object;
+}
+
+//----------------------------------------------------------------------
+// SlabCache::Free
+// 	Put an object back on the free list (or the heap, if that is
+//	where it came from).
+//----------------------------------------------------------------------
+
+void
+SlabCache::Free(void *object, size_t size)
+{
+    if (object == NULL) {
+	return;
+    }
+    if (size != (size_t) objectSize) {
+	::operator delete(object);
+	return;
+    }
+    *(void **) object = free;
+    free = object;
+    numFrees++;
+}
+
+//----------------------------------------------------------------------
+// SlabCache::PrintAll
+// 	Print, for each kind of object that has been allocated, how many
+//	have been allocated and freed, and how many slabs they took.
+//	Caches with the same name and size (ListElement has one for each
+//	type of item) are added together.
+//----------------------------------------------------------------------
+
+bool
+SlabCache::SameKind(SlabCache *other)
+{
+    return objectSize == other->objectSize && strcmp(name, other->name) == 0;
+}
+
+void
+SlabCache::PrintAll()
+{
+    for (SlabCache *cache = all; cache != NULL; cache = cache->next) {
+	SlabCache *other;
+	int allocs = 0, frees = 0, slabs = 0;
+
+	for (other = all; other != cache; other = other->next) {
+	    if (other->SameKind(cache)) {
+		break;		// already printed
+	    }
+	}
+	if (other != cache) {
+	    continue;
+	}
+	for (; other != NULL; other = other->next) {
+	    if (other->SameKind(cache)) {
+		allocs += other->numAllocs;
+		frees += other->numFrees;
+		slabs += other->numSlabs;
+	    }
+	}
+	if (allocs > 0) {
+	    cout << "Slab " << cache->name << " (" << cache->objectSize
+		 << " bytes): allocs " << allocs << ", frees " << frees
+		 << ", slabs " << slabs << "\n";
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// SlabCache::TotalSlabs
+// 	Return how many slabs have been taken from the heap, by all the
+//	caches together.  If this stays the same while the kernel runs,
+//	the kernel is not allocating any of these objects from the heap.
+//----------------------------------------------------------------------
+
+int
+SlabCache::TotalSlabs()
+{
+    int total = 0;
+
+    for (SlabCache *cache = all; cache != NULL; cache = cache->next) {
+	total += cache->numSlabs;
+    }
+    return total;
+}
+
+//----------------------------------------------------------------------
+// SlabCache::SelfTest
+// 	Allocate more than a slab's worth of objects, free them, and
+//	allocate them again: the second time should not need a new slab.
+//----------------------------------------------------------------------
+
+void
+SlabCache::SelfTest()
+{
+    SlabCache *cache = new SlabCache("test", sizeof(int));
+    int *objects[SlabObjects + 1];
+
+    for (int round = 0; round < 2; round++) {
+	for (int i = 0; i <= SlabObjects; i++) {
+	    objects[i] = (int *) cache->Alloc(sizeof(int));
+	    *objects[i] = i;
+	}
+	for (int i = 0; i <= SlabObjects; i++) {
+	    ASSERT(*objects[i] == i);
+	    cache->Free(objects[i], sizeof(int));
+	}
+	ASSERT(cache->numSlabs == 2);
+    }
+    ASSERT(cache->numAllocs == cache->numFrees);
+    all = cache->next;			// we know it is first on the list
+    // its slabs are lost, but it is only a test
+    delete cache;
+}
@@ -0,0 +1,65 @@
+// slab.h
+//	Data structures for a simple slab allocator.
+//
+//	The kernel allocates and frees a few kinds of small object over
+//	and over: list elements, pending interrupts, semaphores, threads,
+//	network messages.  Rather than go to the host's heap each time,
+//	each of these classes has its own SlabCache, which carves objects
+//	out of larger blocks (slabs) and keeps freed objects on a free list
+//	for re-use.  Once a cache has as many objects as the kernel ever
+//	has in use at once, allocating and freeing never touch the heap.
+//
+//	A class uses a cache by defining its own operator new and
+//	operator delete to call Alloc and Free.  Objects of a subclass
+//	are a different size, so they go to the heap as usual.
+//
+//	Memory in a slab is never given back to the host.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "copyright.h"
+#include "sysdep.h"
+
+#define SlabObjects	64	// # of objects in each slab
+
+// The following class defines a cache of free objects of one size.
+
+class SlabCache {
+  public:
+    SlabCache(char *name, int objectSize);
+				// Create an empty cache, for objects of
+				// type "name", "objectSize" bytes each
+
+    void *Alloc(size_t size);	// Return space for an object of "size"
+				// bytes (normally, the cache's size)
+    void Free(void *object, size_t size);
+				// "object" is no longer in use
+
+    static void PrintAll();	// Print the counts for every cache
+    static int TotalSlabs();	// # of slabs allocated by all caches
+    static void SelfTest();	// Test a cache of ints
+
+  private:
+    char *name;			// what the objects are, for printing
+    int objectSize;		// # of bytes in each object
+    int slotSize;		// # of bytes set aside for each object
+    void *free;			// first free object, linked through
+				// the first word of each one
+    int numAllocs;		// # of objects allocated
+    int numFrees;		// # of objects freed
+    int numSlabs;		// # of slabs allocated from the heap
+    SlabCache *next;		// next cache in "all"
+
+    static SlabCache *all;	// every cache there is
+
+    void Grow();		// Add a slab's worth of free objects
+    bool SameKind(SlabCache *other);
+				// same name and size as "other"?
+};
+
+#endif // SLAB_H
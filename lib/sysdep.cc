@@ -29,6 +29,7 @@
 #include "stdlib.h"
 #include "unistd.h"
 #include "sys/time.h"
+#include <time.h>
 #include "sys/file.h"
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -50,9 +51,7 @@ extern "C" {
 #include <signal.h>
 #include <sys/types.h>
 
-#ifndef NO_MPROT 
 #include <sys/mman.h>
-#endif
 
 // UNIX routines called by procedures in this file 
 
@@ -258,6 +257,100 @@ DeallocBoundedArray(char *ptr, int size)
 }
 #endif
 
+//----------------------------------------------------------------------
+// HostPageSize, MapPages, UnmapPages, GuardPages, ReleasePages,
+// UnguardPages
+// 	Allocate and de-allocate memory a page at a time, straight from
+//	the host, so that it can be given back; and make pages
+//	inaccessible, to catch references that run off the end of an
+//	array (as in AllocBoundedArray).
+//
+//	ReleasePages gives the memory back without giving up the
+//	addresses, by mapping fresh inaccessible pages over the old
+//	ones; so pages in the middle of a mapping can be given back
+//	without disturbing their neighbours.  UnguardPages makes them
+//	usable again (as zeroes).
+//
+//	"p" -- the first page
+//	"size" -- # of bytes, a multiple of the page size
+//----------------------------------------------------------------------
+
+int
+HostPageSize()
+{
+    return getpagesize();
+}
+
+char *
+MapPages(int size)
+{
+    void *p = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(p != MAP_FAILED);
+    return (char *) p;
+}
+
+void
+UnmapPages(char *p, int size)
+{
+    munmap(p, (size_t) size);
+}
+
+void
+GuardPages(char *p, int size)
+{
+#ifndef NO_MPROT
+    mprotect(p, (size_t) size, 0);
+#endif
+}
+
+void
+ReleasePages(char *p, int size)
+{
+    void *q = mmap(p, (size_t) size, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+
+    ASSERT(q == (void *) p);
+}
+
+void
+UnguardPages(char *p, int size)
+{
+    mprotect(p, (size_t) size, PROT_READ | PROT_WRITE);
+}
+
+//----------------------------------------------------------------------
+// HostMicroseconds
+// 	Return the host's time of day, in microseconds.  Only differences
+//	between two calls mean anything.
+//----------------------------------------------------------------------
+
+double
+HostMicroseconds()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+//----------------------------------------------------------------------
+// HostNanoseconds
+// 	Return the host's monotonic clock, in nanoseconds.  This is read
+//	often enough, when profiling (see hostprofile.h), that it matters
+//	how long it takes; on Linux it does not enter the host kernel.
+//----------------------------------------------------------------------
+
+long long
+HostNanoseconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 //----------------------------------------------------------------------
 // PollFile
 // 	Check open file or open socket to see if there are any 
@@ -27,6 +27,9 @@ extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
+// Arrange that "func" is called when the host sends us signal "sig"
+extern void RegisterSignalHandler(void (*func)(int), int sig);
+
 // Initialize the pseudo random number generator
 extern void RandomInit(unsigned seed);
 extern unsigned int RandomNumber();
@@ -36,6 +39,22 @@ extern unsigned int RandomNumber();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Map, unmap, and protect whole pages of memory directly, so that
+// a caller can keep guard pages in place while it re-uses the memory
+// between them.  "size" must be a multiple of HostPageSize().
+extern int HostPageSize();
+extern char *MapPages(int size);
+extern void UnmapPages(char *p, int size);
+extern void GuardPages(char *p, int size);	// make pages inaccessible
+extern void ReleasePages(char *p, int size);	// ... and give back the
+						// memory, but keep the
+						// addresses reserved
+extern void UnguardPages(char *p, int size);	// make them usable again
+
+// The host's clock, in microseconds, for timing Nachos itself
+extern double HostMicroseconds();
+extern long long HostNanoseconds();	// the same, but cheaper and finer
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
@@ -15,6 +15,7 @@
 #include "copyright.h"
 #include "console.h"
 #include "main.h"
+#include "inputlog.h"
 
 //----------------------------------------------------------------------
 // ConsoleInput::ConsoleInput
@@ -35,9 +36,10 @@ ConsoleInput::ConsoleInput(char *readFile, CallBackObj *toCall)
     // set up the stuff to emulate asynchronous interrupts
     callWhenAvail = toCall;
     incoming = EOF;
+    arrived = 0;
 
-    // start polling for incoming keystrokes
-    kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
+    // interrupt when there are keystrokes to be read
+    kernel->interrupt->WhenReadable(readFileNo, this, ConsoleReadInt);
 }
 
 //----------------------------------------------------------------------
@@ -59,6 +61,13 @@ ConsoleInput::~ConsoleInput()
 //
 //	First check to make sure character is available.
 //	Then invoke the "callBack" registered by whoever wants the character.
+//
+//	If it isn't (the last character was read, and nothing more has
+//	been typed since), wait to be told when there is one.
+//
+//	Whether there was a character, and which, is logged if input is
+//	being recorded -- or comes from the log, if it is being played
+//	back (see inputlog.h).
 //----------------------------------------------------------------------
 
 void
@@ -66,14 +75,25 @@ ConsoleInput::CallBack()
 {
   char c;
   int readCount;
+  InputLog *log = kernel->inputLog;
 
     ASSERT(incoming == EOF);
-    if (!PollFile(readFileNo)) { // nothing to be read
-        // schedule the next time to poll for a packet
-        kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
+    if (log != NULL && log->IsPlayingBack()) {
+	readCount = log->Play(InputConsole, &c, sizeof(char));
+    } else {
+	readCount = -1;
+	if (PollFile(readFileNo)) {
+	    readCount = ReadPartial(readFileNo, &c, sizeof(char));
+	}
+	if (log != NULL) {
+	    log->Record(InputConsole, &c, readCount);
+	}
+    }
+    if (readCount < 0) { // nothing to be read
+        // interrupt again when there is
+        kernel->interrupt->WhenReadable(readFileNo, this, ConsoleReadInt);
     } else { 
-    	// otherwise, try to read a character
-    	readCount = ReadPartial(readFileNo, &c, sizeof(char));
+    	// otherwise, we tried to read a character
 	if (readCount == 0) {
 	   // this seems to happen at end of file, when the
 	   // console input is a regular file
@@ -86,6 +106,7 @@ ConsoleInput::CallBack()
 	  // it is available
 	  ASSERT(readCount == sizeof(char));
 	  incoming = c;
+	  arrived = kernel->stats->totalTicks;
 	  kernel->stats->numConsoleCharsRead++;
 	}
 	callWhenAvail->CallBack();
@@ -105,6 +126,8 @@ ConsoleInput::GetChar()
 
    if (incoming != EOF) {	// schedule when next char will arrive
        kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
+       kernel->stats->consoleReadLatency.Record(
+				kernel->stats->totalTicks - arrived);
    }
    incoming = EOF;
    return ch;
@@ -65,6 +65,7 @@ class ConsoleInput : public CallBackObj {
     char incoming;    			// Contains the character to be read,
 					// if there is one available. 
 					// Otherwise contains EOF.
+    long long arrived;			// when it came in
 };
 
 class ConsoleOutput : public CallBackObj {
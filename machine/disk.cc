@@ -18,6 +18,8 @@
 #include "debug.h"
 #include "sysdep.h"
 #include "main.h"
+#include "snapshot.h"
+#include "hostprofile.h"
 
 // We put a magic number at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file 
@@ -34,6 +36,9 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 //	if it doesn't exist), and check the magic number to make sure it's 
 // 	ok to treat it as Nachos disk storage.
 //
+//	If the kernel was started from a snapshot, use the disk in the
+//	snapshot instead, and leave the file alone.
+//
 //	"toCall" -- object to call when disk read/write request completes
 //----------------------------------------------------------------------
 
@@ -46,8 +51,15 @@ Disk::Disk(CallBackObj *toCall)
     callWhenDone = toCall;
     lastSector = 0;
     bufferInit = 0;
+    active = FALSE;
     
     sprintf(diskname,"DISK_%d",kernel->hostName);
+    if (kernel->snapshot != NULL) {
+	image = kernel->snapshot->DiskImage();
+	fileno = -1;
+	return;
+    }
+    image = NULL;
     fileno = OpenForReadWrite(diskname, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
@@ -61,7 +73,6 @@ Disk::Disk(CallBackObj *toCall)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
-    active = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -72,7 +83,9 @@ Disk::Disk(CallBackObj *toCall)
 
 Disk::~Disk()
 {
-    Close(fileno);
+    if (fileno >= 0) {
+	Close(fileno);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -113,14 +126,19 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
+    HostTimer timer(HostDisk);
     int ticks = ComputeLatency(sectorNumber, FALSE);
 
     ASSERT(!active);				// only one request at a time
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    if (image != NULL) {
+	bcopy(image + SectorSize * sectorNumber, data, SectorSize);
+    } else {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	Read(fileno, data, SectorSize);
+    }
     if (debug->IsEnabled('d'))
 	PrintSector(FALSE, sectorNumber, data);
     
@@ -133,14 +151,19 @@ Disk::ReadRequest(int sectorNumber, char* data)
 void
 Disk::WriteRequest(int sectorNumber, char* data)
 {
+    HostTimer timer(HostDisk);
     int ticks = ComputeLatency(sectorNumber, TRUE);
 
     ASSERT(!active);
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    if (image != NULL) {
+	bcopy(data, image + SectorSize * sectorNumber, SectorSize);
+    } else {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	WriteFile(fileno, data, SectorSize);
+    }
     if (debug->IsEnabled('d'))
 	PrintSector(TRUE, sectorNumber, data);
     
@@ -150,6 +173,25 @@ Disk::WriteRequest(int sectorNumber, char* data)
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::CopyOut()
+// 	Copy the contents of the whole disk into "into", at once, and
+//	without counting it as disk I/O: this is for taking a snapshot,
+//	not something the simulated machine does.
+//----------------------------------------------------------------------
+
+void
+Disk::CopyOut(char *into)
+{
+    ASSERT(!active);
+    if (image != NULL) {
+	bcopy(image, into, NumSectors * SectorSize);
+    } else {
+	Lseek(fileno, MagicSize, 0);
+	Read(fileno, into, NumSectors * SectorSize);
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::CallBack()
 // 	Called by the machine simulation when the disk interrupt occurs.
@@ -180,7 +222,7 @@ Disk::TimeToSeek(int newSector, int *rotation)
     int oldTrack = lastSector / SectorsPerTrack;
     int seek = abs(newTrack - oldTrack) * SeekTime;
 				// how long will seek take?
-    int over = (kernel->stats->totalTicks + seek) % RotationTime; 
+    int over = (int) ((kernel->stats->totalTicks + seek) % RotationTime);
 				// will we be in the middle of a sector when
 				// we finish the seek?
 
@@ -197,10 +239,10 @@ Disk::TimeToSeek(int newSector, int *rotation)
 //----------------------------------------------------------------------
 
 int 
-Disk::ModuloDiff(int to, int from)
+Disk::ModuloDiff(int to, long long from)
 {
     int toOffset = to % SectorsPerTrack;
-    int fromOffset = from % SectorsPerTrack;
+    int fromOffset = (int) (from % SectorsPerTrack);
 
     return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
 }
@@ -231,7 +273,7 @@ Disk::ComputeLatency(int newSector, bool writing)
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
-    int timeAfter = kernel->stats->totalTicks + seek + rotation;
+    long long timeAfter = kernel->stats->totalTicks + seek + rotation;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
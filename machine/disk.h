@@ -74,18 +74,22 @@ class Disk : public CallBackObj {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    void CopyOut(char *into);		// Copy every sector, all at once,
+					// for a snapshot (see snapshot.h)
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    char *image;			// if not NULL, the disk's sectors,
+					// in memory, instead of the file
     char diskname[32];			// name of simulated disk's file
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
-    int bufferInit;			// When the track buffer started 
+    long long bufferInit;		// When the track buffer started 
 					// being loaded
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
-    int ModuloDiff(int to, int from);        // # sectors between to and from
+    int ModuloDiff(int to, long long from);  // # sectors between to and from
     void UpdateLast(int newSector);
 };
 
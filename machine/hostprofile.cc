@@ -0,0 +1,106 @@
+// hostprofile.cc
+//	Routines to charge host time to the parts of the simulator, and
+//	to report it.  See hostprofile.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "hostprofile.h"
+#include "debug.h"
+#include "sysdep.h"
+
+HostProfile *HostProfile::active = NULL;
+
+// The names of the parts, for printing; in the order of HostActivity.
+
+static char *activityNames[] = {
+    "kernel", "user", "interrupt", "exception", "switch", "disk", "idle"
+};
+
+//----------------------------------------------------------------------
+// HostProfile::HostProfile
+// 	Start profiling: there can only be one profile at a time.
+//----------------------------------------------------------------------
+
+HostProfile::HostProfile()
+{
+    ASSERT(active == NULL);
+    ASSERT(sizeof(activityNames) / sizeof(activityNames[0])
+						== NumHostActivities);
+    for (int i = 0; i < NumHostActivities; i++) {
+	nanoseconds[i] = entries[i] = 0;
+    }
+    current = HostKernel;
+    entries[current] = 1;
+    since = HostNanoseconds();
+    active = this;
+}
+
+HostProfile::~HostProfile()
+{
+    active = NULL;
+}
+
+//----------------------------------------------------------------------
+// HostProfile::Charge
+// 	Charge the host time since the last change to what was running
+//	then, and start charging "what".  Return what was running.
+//----------------------------------------------------------------------
+
+HostActivity
+HostProfile::Charge(HostActivity what)
+{
+    HostActivity was = current;
+    long long now;
+
+    if (what == was) {			// nothing to do
+	return was;
+    }
+    now = HostNanoseconds();
+    nanoseconds[was] += now - since;
+    entries[what]++;
+    current = what;
+    since = now;
+    return was;
+}
+
+//----------------------------------------------------------------------
+// HostProfile::Print
+// 	Print the host time charged to each part so far, in total, per
+//	time it was started, and per simulated instruction (the time
+//	charged to one part, divided by "instructions").  Parts that
+//	were never started are left out.
+//----------------------------------------------------------------------
+
+void
+HostProfile::Print(long long instructions)
+{
+    long long now = HostNanoseconds();
+    long long total = 0;
+
+    nanoseconds[current] += now - since;	// bring it up to date
+    since = now;
+    for (int i = 0; i < NumHostActivities; i++) {
+	total += nanoseconds[i];
+    }
+    if (total == 0) {
+	return;
+    }
+    cout << "Host time: (part, entries, ms, ns per entry, "
+	 << "ns per instruction, %), " << instructions << " instructions\n";
+    for (int i = 0; i < NumHostActivities; i++) {
+	if (nanoseconds[i] == 0) {
+	    continue;
+	}
+	cout << "    " << activityNames[i] << ", " << entries[i] << ", "
+	     << nanoseconds[i] / 1000000.0 << ", "
+	     << (entries[i] > 0 ? nanoseconds[i] / entries[i] : 0) << ", "
+	     << (instructions > 0 ? (double) nanoseconds[i] / instructions
+				  : 0.0) << ", "
+	     << nanoseconds[i] * 100.0 / total << "\n";
+    }
+}
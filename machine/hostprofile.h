@@ -0,0 +1,89 @@
+// hostprofile.h
+//	Data structures to measure where the host's time goes, while it
+//	runs the simulation.
+//
+//	The statistics count simulated ticks; they say nothing about
+//	what the simulation itself costs.  With "-hp", the host time is
+//	charged, as it goes by, to whichever part of the simulator is
+//	running: decoding and executing user instructions, handling
+//	interrupts and exceptions, switching threads, emulating the disk,
+//	waiting for input, or everything else the kernel does.  At Halt,
+//	each part's share is printed as host nanoseconds per simulated
+//	instruction, to show where making Nachos faster would pay off.
+//
+//	The parts don't overlap: the time an exception handler spends
+//	emulating the disk is charged to the disk, not to the handler.
+//	The clock is read only when the simulator goes from one part to
+//	another, and not at all when profiling is off.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HOSTPROFILE_H
+#define HOSTPROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The parts of the simulator that host time is charged to.
+enum HostActivity {
+    HostKernel,		// kernel code, and anything not listed below
+    HostUser,		// fetching, decoding and executing user
+			// instructions, and translating their addresses
+			// (Machine::Run)
+    HostInterrupt,	// interrupt handlers (Interrupt::CheckIfDue)
+    HostException,	// system calls and faults (ExceptionHandler)
+    HostSwitch,		// context switches (Scheduler::Run)
+    HostDisk,		// disk emulation (Disk::ReadRequest, WriteRequest)
+    HostIdle,		// waiting for input from the host
+    NumHostActivities
+};
+
+// The following class defines the profile: the host time charged to
+// each part so far.
+
+class HostProfile {
+  public:
+    HostProfile();		// start charging to HostKernel
+    ~HostProfile();
+
+    static HostActivity Start(HostActivity what) {
+		return (active == NULL) ? what : active->Charge(what); }
+				// from now on, charge "what"; return what
+				// was being charged before (do nothing if
+				// profiling is off)
+
+    void Print(long long instructions);
+				// print the time charged to each part,
+				// per simulated instruction
+
+  private:
+    static HostProfile *active;	// the profile being kept, or NULL
+
+    HostActivity current;	// what is being charged now
+    long long since;		// host time it has been charged from
+    long long nanoseconds[NumHostActivities];	// host time charged
+    long long entries[NumHostActivities];	// # of times started
+
+    HostActivity Charge(HostActivity what);
+};
+
+// The following class charges host time to "what" for as long as the
+// timer exists -- for the rest of the block it is declared in --
+// and then goes back to charging what was charged before.  The timer
+// lives on the stack of the thread that made it, so a thread that is
+// switched out part way through picks up where it left off.
+
+class HostTimer {
+  public:
+    HostTimer(HostActivity what) { previous = HostProfile::Start(what); }
+    ~HostTimer() { (void) HostProfile::Start(previous); }
+
+  private:
+    HostActivity previous;	// what to charge afterwards
+};
+
+#endif // HOSTPROFILE_H
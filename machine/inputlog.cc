@@ -0,0 +1,316 @@
+// inputlog.cc
+//	Routines to record input from the host into a log, and to play
+//	it back.  See inputlog.h for what is logged, and why.
+//
+//	Numbers are written 7 bits to a byte, low bits first, with the
+//	top bit set on every byte but the last.  Results of reads, which
+//	can be -1, are written plus one.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "inputlog.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// InputLog::InputLog
+// 	Start a log of input.  Recording, create the file and write the
+//	header; playing back, read in the whole file, and the header.
+//
+//	"fileName" -- the log
+//	"playBack" -- play the log back, rather than record it
+//	"randomSeed" -- the seed for random time slicing, or NoSeed
+//		(when playing back, the seed comes from the log)
+//----------------------------------------------------------------------
+
+InputLog::InputLog(char *fileName, bool playBack, int randomSeed)
+{
+    playingBack = playBack;
+    lastTick = kernel->stats->totalTicks;
+    lastPoint = 0;
+    fd = -1;
+    recordSize = 64;
+    record = new char[recordSize];
+    recordLength = 0;
+    contents = NULL;
+    length = position = 0;
+
+    if (!playingBack) {
+	seed = randomSeed;
+	fd = OpenForWrite(fileName);
+	PutNumber(InputLogMagic);
+	PutNumber(seed + 1);
+	PutNumber(lastTick);
+	Flush();
+	return;
+    }
+
+    if ((fd = OpenForReadWrite(fileName, FALSE)) < 0) {
+	cerr << "Unable to open input log " << fileName << "\n";
+	Abort();
+    }
+    Lseek(fd, 0, 2);
+    length = Tell(fd);
+    Lseek(fd, 0, 0);
+    contents = new char[length];
+    Read(fd, contents, length);
+    Close(fd);
+    fd = -1;
+    if (GetNumber() != InputLogMagic) {
+	cerr << "Not an input log: " << fileName << "\n";
+	Abort();
+    }
+    seed = (int) GetNumber() - 1;
+    if ((long long) GetNumber() != lastTick) {
+	Diverged("the log starts at a different time");
+    }
+}
+
+//----------------------------------------------------------------------
+// InputLog::~InputLog
+// 	The run is over.  Recording, note when it ended; playing back,
+//	check that it ended when the recorded run did.
+//----------------------------------------------------------------------
+
+InputLog::~InputLog()
+{
+    if (!playingBack) {
+	Begin(InputEnd);
+	Flush();
+	Close(fd);
+    } else if (position < length && contents[position] == InputEnd) {
+	long long now = kernel->stats->totalTicks;
+
+	position++;
+	if ((long long) (lastTick + GetNumber()) != now) {
+	    cerr << "Playback ended at tick " << now
+		 << ", not when the recorded run did\n";
+	}
+    } else {
+	cerr << "Playback ended before the recorded run did\n";
+    }
+    delete [] record;
+    delete [] contents;
+}
+
+//----------------------------------------------------------------------
+// InputLog::PutBytes, PutNumber, Flush
+// 	Build up a record, and then write it to the log all at once, so
+//	that a run that crashes leaves a log that is complete up to then.
+//----------------------------------------------------------------------
+
+void
+InputLog::PutBytes(char *bytes, int n)
+{
+    if (recordLength + n > recordSize) {	// out of room
+	char *bigger;
+
+	while (recordLength + n > recordSize) {
+	    recordSize *= 2;
+	}
+	bigger = new char[recordSize];
+	bcopy(record, bigger, recordLength);
+	delete [] record;
+	record = bigger;
+    }
+    bcopy(bytes, record + recordLength, n);
+    recordLength += n;
+}
+
+void
+InputLog::PutNumber(unsigned long long n)
+{
+    char byte;
+
+    while (n >= 0x80) {
+	byte = (char) ((n & 0x7f) | 0x80);
+	PutBytes(&byte, 1);
+	n >>= 7;
+    }
+    byte = (char) n;
+    PutBytes(&byte, 1);
+}
+
+void
+InputLog::Flush()
+{
+    WriteFile(fd, record, recordLength);
+    recordLength = 0;
+}
+
+//----------------------------------------------------------------------
+// InputLog::GetBytes, GetNumber
+// 	Read back what PutBytes and PutNumber wrote.
+//----------------------------------------------------------------------
+
+void
+InputLog::GetBytes(char *into, int n)
+{
+    if (position + n > length) {
+	Diverged("the log ran out");
+    }
+    bcopy(contents + position, into, n);
+    position += n;
+}
+
+unsigned long long
+InputLog::GetNumber()
+{
+    unsigned long long n = 0;
+    int shift = 0;
+    char byte;
+
+    do {
+	GetBytes(&byte, 1);
+	n |= (unsigned long long) (byte & 0x7f) << shift;
+	shift += 7;
+    } while (byte & 0x80);
+    return n;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Begin
+// 	Start a record of "kind", at the current time.  Playing back,
+//	check that the next record in the log is the same.
+//----------------------------------------------------------------------
+
+void
+InputLog::Begin(InputKind kind)
+{
+    long long now = kernel->stats->totalTicks;
+    char byte = (char) kind;
+
+    if (!playingBack) {
+	PutBytes(&byte, 1);
+	PutNumber(now - lastTick);
+    } else {
+	GetBytes(&byte, 1);
+	if (byte != kind) {
+	    Diverged("the input is not of the kind recorded");
+	}
+	if ((long long) (lastTick + GetNumber()) != now) {
+	    Diverged("the input comes at a different time");
+	}
+    }
+    lastTick = now;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Diverged
+// 	The run being played back has stopped following the recorded
+//	one, so the log is no use from here on: say why, and give up.
+//----------------------------------------------------------------------
+
+void
+InputLog::Diverged(char *why)
+{
+    cerr << "Playback diverged at tick " << kernel->stats->totalTicks
+	 << ": " << why << "\n";
+    Abort();
+}
+
+//----------------------------------------------------------------------
+// InputLog::RecordReady
+// 	Note that the watched files in "mask" had input, when the
+//	watcher delivered it for the "point"'th time.
+//----------------------------------------------------------------------
+
+void
+InputLog::RecordReady(unsigned long long point, unsigned int mask)
+{
+    Begin(InputReady);
+    PutNumber(point - lastPoint);
+    PutNumber(mask);
+    Flush();
+    lastPoint = point;
+}
+
+//----------------------------------------------------------------------
+// InputLog::PlayReady
+// 	Return TRUE, and set "mask" to the files that had input, if the
+//	recorded run got input at delivery "point".  The watcher asks
+//	at every point, so usually the answer is no.
+//----------------------------------------------------------------------
+
+bool
+InputLog::PlayReady(unsigned long long point, unsigned int *mask)
+{
+    int start = position;
+    unsigned long long recorded;
+
+    if (position >= length || contents[position] != InputReady) {
+	return FALSE;
+    }
+    position++;
+    (void) GetNumber();			// the time, checked below
+    recorded = lastPoint + GetNumber();
+    position = start;
+    if (recorded > point) {
+	return FALSE;			// not yet
+    } else if (recorded < point) {
+	Diverged("input was recorded at a point that has gone by");
+    }
+    Begin(InputReady);
+    (void) GetNumber();
+    *mask = (unsigned int) GetNumber();
+    lastPoint = point;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// InputLog::AtEnd
+// 	Return TRUE if there is no more input to play back -- so that
+//	a run waiting for some will wait forever.
+//----------------------------------------------------------------------
+
+bool
+InputLog::AtEnd()
+{
+    return position >= length || contents[position] == InputEnd;
+}
+
+//----------------------------------------------------------------------
+// InputLog::Record
+// 	Note what a read from the host returned: "result" bytes in
+//	"buffer", or nothing, if "result" is 0 (end of file) or less
+//	(nothing to read, or an error).
+//----------------------------------------------------------------------
+
+void
+InputLog::Record(InputKind kind, char *buffer, int result)
+{
+    ASSERT(result >= -1);
+    Begin(kind);
+    PutNumber(result + 1);
+    if (result > 0) {
+	PutBytes(buffer, result);
+    }
+    Flush();
+}
+
+//----------------------------------------------------------------------
+// InputLog::Play
+// 	Play back a read from the host, of at most "size" bytes into
+//	"buffer": return what the recorded read returned, with the
+//	same data.
+//----------------------------------------------------------------------
+
+int
+InputLog::Play(InputKind kind, char *buffer, int size)
+{
+    int result;
+
+    Begin(kind);
+    result = (int) GetNumber() - 1;
+    if (result > size) {
+	Diverged("more input was recorded than there is room for");
+    }
+    if (result > 0) {
+	GetBytes(buffer, result);
+    }
+    return result;
+}
@@ -0,0 +1,102 @@
+// inputlog.h
+//	Data structures to record the input that comes into the machine
+//	from outside, and to play it back.
+//
+//	Everything the simulation does is decided by the simulation
+//	itself, except for what comes in from the host: when console and
+//	network input turns up, what it is, what user programs read from
+//	the host's stdin, and the seed for random time slicing.  Record
+//	those ("-rec log"), and a later run can be given exactly the same
+//	input at exactly the same points ("-play log"), without touching
+//	the host devices at all -- and without waiting for any of it.  So
+//	a run seen once, under load, can be repeated tick for tick, as
+//	many times as needed.
+//
+//	Each record notes the simulated time it happened at.  When playing
+//	back, a record that comes up at a different time, or is of a
+//	different kind than the simulation asks for, means the run is not
+//	the same as the one recorded (it was given different flags, say),
+//	and the playback stops.  The last record notes the time the run
+//	ended at, so that a complete replay can be checked.
+//
+//	The log is compact: a small header, then a byte for the kind of
+//	each record, and variable length numbers for the rest, with each
+//	time given relative to the one before.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define InputLogMagic	0x4e494c47	// marks a file as an input log
+#define NoSeed		-1		// random time slicing is off
+
+// The kinds of input that are logged.
+enum InputKind {
+    InputReady,		// host input came in for some watched files
+    InputConsole,	// the console read a character (or didn't)
+    InputPacket,	// the network read a packet (or didn't)
+    InputHostRead,	// a user program read from a host file
+    InputEnd		// the run ended
+};
+
+// The following class defines a log of input, being recorded or
+// played back.
+
+class InputLog {
+  public:
+    InputLog(char *fileName, bool playBack, int seed);
+				// Start recording into "fileName", or
+				// playing it back; "seed" is only used
+				// when recording
+    ~InputLog();		// Note (or check) the end of the run
+
+    bool IsPlayingBack() { return playingBack; }
+    int Seed() { return seed; }	// seed the run was recorded with
+
+    // Input from the host watcher (see iowatcher.h): the watched
+    // files in "mask" had input at the "point"'th delivery.
+
+    void RecordReady(unsigned long long point, unsigned int mask);
+    bool PlayReady(unsigned long long point, unsigned int *mask);
+				// was there input at this point?
+    bool AtEnd();		// has all the input been played back?
+
+    // Data read from the host: "result" is what the read returned
+    // (< 0 for nothing to read), and the data is in "buffer".
+
+    void Record(InputKind kind, char *buffer, int result);
+    int Play(InputKind kind, char *buffer, int size);
+
+  private:
+    bool playingBack;		// playing back, rather than recording?
+    int seed;			// random seed, or NoSeed
+    long long lastTick;		// time of the last record
+    unsigned long long lastPoint;	// point of the last InputReady record
+
+    int fd;			// the log file, when recording
+    char *record;		// the record being built
+    int recordSize, recordLength;	// room for it; # of bytes so far
+
+    char *contents;		// the whole log, when playing back
+    int length, position;	// # of bytes in it; how far we've read
+
+    void Begin(InputKind kind);	// start a record; or, playing back,
+				// check that the next one is this kind,
+				// and from now
+    void PutBytes(char *bytes, int n);	// add to the record
+    void PutNumber(unsigned long long n);
+    void Flush();		// write the record to the log
+    void GetBytes(char *into, int n);	// read back
+    unsigned long long GetNumber();
+    void Diverged(char *why);	// playback doesn't match: give up
+};
+
+#endif // INPUTLOG_H
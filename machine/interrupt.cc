@@ -23,6 +23,9 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include "slab.h"
+#include "iowatcher.h"
+#include "hostprofile.h"
 
 // String definitions for debugging messages
 
@@ -31,6 +34,28 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 			"console read", "network send", 
 			"network recv"};
 
+//----------------------------------------------------------------------
+// PendingInterrupt::operator new, operator delete
+// 	One of these is allocated for every timer tick and every
+//	device operation, and freed when the interrupt fires, so they
+//	come from a slab cache rather than the heap.
+//----------------------------------------------------------------------
+
+static SlabCache pendingInterruptSlab("PendingInterrupt",
+				     sizeof(PendingInterrupt));
+
+void *
+PendingInterrupt::operator new(size_t size)
+{
+    return pendingInterruptSlab.Alloc(size);
+}
+
+void
+PendingInterrupt::operator delete(void *p, size_t size)
+{
+    pendingInterruptSlab.Free(p, size);
+}
+
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
 // 	Initialize a hardware device interrupt that is to be scheduled 
@@ -42,7 +67,7 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, 
-					int time, IntType kind)
+					long long time, IntType kind)
 {
     callOnInterrupt = callOnInt;
     when = time;
@@ -50,16 +75,171 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt,
 }
 
 //----------------------------------------------------------------------
-// PendingCompare
-//	Compare to interrupts based on which should occur first.
+// PendingQueue::PendingQueue, PendingQueue::~PendingQueue
+// 	Initialize an empty queue of pending interrupts, and get rid of
+//	one.  The interrupts still on the queue are the caller's to
+//	de-allocate.
 //----------------------------------------------------------------------
 
-static int
-PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
+PendingQueue::PendingQueue()
 {
-    if (x->when < y->when) { return -1; }
-    else if (x->when > y->when) { return 1; }
-    else { return 0; }
+    size = 16;
+    heap = new PendingInterrupt *[size];
+    numPending = 0;
+    nextOrder = 0;
+}
+
+PendingQueue::~PendingQueue()
+{
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Before
+// 	Should interrupt "a" fire before "b"?  If they are due at the
+//	same time, the one scheduled first fires first (the order is
+//	allowed to wrap around, so compare the difference).
+//----------------------------------------------------------------------
+
+bool
+PendingQueue::Before(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when) {
+	return a->when < b->when;
+    }
+    return (int) (a->order - b->order) < 0;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::SiftUp, SiftDown
+// 	The usual binary heap routines: move heap[i] up or down the heap
+//	until it is in order, keeping each interrupt's heapIndex up to
+//	date as it moves.
+//----------------------------------------------------------------------
+
+void
+PendingQueue::SiftUp(int i)
+{
+    PendingInterrupt *p = heap[i];
+
+    while (i > 0 && Before(p, heap[(i - 1) / 2])) {
+	heap[i] = heap[(i - 1) / 2];
+	heap[i]->heapIndex = i;
+	i = (i - 1) / 2;
+    }
+    heap[i] = p;
+    p->heapIndex = i;
+}
+
+void
+PendingQueue::SiftDown(int i)
+{
+    PendingInterrupt *p = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < numPending) {
+	if (child + 1 < numPending && Before(heap[child + 1], heap[child])) {
+	    child++;
+	}
+	if (!Before(heap[child], p)) {
+	    break;
+	}
+	heap[i] = heap[child];
+	heap[i]->heapIndex = i;
+	i = child;
+    }
+    heap[i] = p;
+    p->heapIndex = i;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Insert
+// 	Add "p" to the pending interrupts, growing the array if it is
+//	full.
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Insert(PendingInterrupt *p)
+{
+    if (numPending == size) {		// out of room: double the array
+	PendingInterrupt **bigger = new PendingInterrupt *[2 * size];
+	for (int i = 0; i < numPending; i++) {
+	    bigger[i] = heap[i];
+	}
+	delete [] heap;
+	heap = bigger;
+	size *= 2;
+    }
+    p->order = nextOrder++;
+    heap[numPending++] = p;
+    SiftUp(numPending - 1);
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::RemoveFront, Remove
+// 	Take the earliest interrupt off the queue (returning NULL if there
+//	isn't one), or take "p" off, wherever it is.  Either way, the last
+//	interrupt in the array fills the hole, and is moved to its place.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+PendingQueue::RemoveFront()
+{
+    PendingInterrupt *p = Front();
+
+    if (p != NULL) {
+	Remove(p);
+    }
+    return p;
+}
+
+void
+PendingQueue::Remove(PendingInterrupt *p)
+{
+    int i = p->heapIndex;
+
+    ASSERT(i >= 0 && i < numPending && heap[i] == p);
+    p->heapIndex = -1;
+    if (i == --numPending) {
+	return;				// it was the last one
+    }
+    heap[i] = heap[numPending];
+    if (i > 0 && Before(heap[i], heap[(i - 1) / 2])) {
+	SiftUp(i);
+    } else {
+	SiftDown(i);
+    }
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Find
+// 	Return an interrupt that is scheduled to call "callOnInt", or
+//	NULL if there is none.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+PendingQueue::Find(CallBackObj *callOnInt)
+{
+    for (int i = 0; i < numPending; i++) {
+	if (heap[i]->callOnInterrupt == callOnInt) {
+	    return heap[i];
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Apply
+// 	Call "f" on each pending interrupt, in heap order (which is not
+//	the order they will fire in).
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Apply(void (*f)(PendingInterrupt *))
+{
+    for (int i = 0; i < numPending; i++) {
+	(*f)(heap[i]);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -67,12 +247,17 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 // 	Initialize the simulation of hardware device interrupts.
 //	
 //	Interrupts start disabled, with no interrupts pending, etc.
+//
+//	"deterministicInput" -- if true, input from the host is only
+//		passed on to the devices when there is nothing else to
+//		do, so that runs can be repeated exactly.
 //----------------------------------------------------------------------
 
-Interrupt::Interrupt()
+Interrupt::Interrupt(bool deterministicInput)
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new PendingQueue();
+    watcher = new IOWatcher(deterministicInput);
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -85,6 +270,7 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
+    delete watcher;
     while (!pending->IsEmpty()) {
 	delete pending->RemoveFront();
     }
@@ -143,6 +329,9 @@ Interrupt::SetLevel(IntStatus now)
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	On a multiprocessor, this is also where the host may go off to
+//	run another CPU for a while.
 //----------------------------------------------------------------------
 void
 Interrupt::OneTick()
@@ -152,18 +341,21 @@ Interrupt::OneTick()
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
+        kernel->scheduler->Advance(SystemTick);
 	stats->systemTicks += SystemTick;
     } else {
-	stats->totalTicks += UserTick;
+	kernel->scheduler->Advance(UserTick);
 	stats->userTicks += UserTick;
+	kernel->currentThread->userTicks += UserTick;
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
+    stats->CheckSignal();	// has the host asked for the statistics?
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);	// first, turn off interrupts
 				// (interrupt handlers run with
 				// interrupts disabled)
+    watcher->Deliver(FALSE);	// has any host input come in?
     CheckIfDue(FALSE);		// check for pending interrupts
     ChangeLevel(IntOff, IntOn);	// re-enable interrupts
     if (yieldOnReturn) {	// if the timer device handler asked 
@@ -173,6 +365,18 @@ Interrupt::OneTick()
 	kernel->currentThread->Yield();
 	status = oldStatus;
     }
+    if (kernel->scheduler->NumCpus() > 1) {
+	bool yield;			// give the other CPUs a turn
+
+	ChangeLevel(IntOn, IntOff);
+	status = SystemMode;
+	yield = kernel->scheduler->SwitchCpus();
+	ChangeLevel(IntOff, IntOn);
+	if (yield) {			// another CPU asked us to
+	    kernel->currentThread->Yield();
+	}
+	status = oldStatus;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -201,24 +405,40 @@ Interrupt::YieldOnReturn()
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
 //
-//	If there are no pending interrupts, stop.  There's nothing
-//	more for us to do.
+//	If there are no pending interrupts, wait for input from the
+//	host, if a device is expecting some; otherwise, stop.  There's
+//	nothing more for us to do.
 //----------------------------------------------------------------------
 void
 Interrupt::Idle()
 {
+    bool input;
+
     DEBUG(dbgInt, "Machine idling; checking for interrupts.");
     status = IdleMode;
+    kernel->stats->CheckSignal();
+    watcher->Deliver(FALSE);
     if (CheckIfDue(TRUE)) {	// check for any pending interrupts
 	status = SystemMode;
 	return;			// return in case there's now
 				// a runnable thread
     }
+    {
+	HostTimer timer(HostIdle);	// the host's time is not ours
+	input = watcher->WaitForInput();
+    }
+    if (input) {
+	DEBUG(dbgInt, "Machine idle.  Waiting for input.");
+	watcher->Deliver(TRUE);
+	(void) CheckIfDue(TRUE);
+	status = SystemMode;
+	return;
+    }
 
-    // if there are no pending interrupts, and nothing is on the ready
-    // queue, it is time to stop.   If the console or the network is 
-    // operating, there are *always* pending interrupts, so this code
-    // is not reached.  Instead, the halt must be invoked by the user program.
+    // if there are no pending interrupts, no input is expected, and
+    // nothing is on the ready queue, it is time to stop.   If the
+    // console or the network is waiting for input, this code is not
+    // reached.  Instead, the halt must be invoked by the user program.
 
     DEBUG(dbgInt, "Machine idle.  No interrupts to do.");
     cout << "No threads ready or runnable, and no pending interrupts.\n";
@@ -233,8 +453,19 @@ Interrupt::Idle()
 void
 Interrupt::Halt()
 {
+    Thread *current = kernel->currentThread;
+
     cout << "Machine halting!\n\n";
+    if (current != NULL && current->getStatus() == RUNNING) {
+	kernel->scheduler->ReportThread(current);	// never got to Finish
+    }
     kernel->stats->Print();
+    if (kernel->hostProfile != NULL) {
+	kernel->hostProfile->Print(kernel->stats->userTicks);
+    }
+    if (kernel->scheduler->NumCpus() > 1) {
+	kernel->scheduler->PrintCpus();
+    }
     delete kernel;	// Never returns.
 }
 
@@ -243,7 +474,7 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on a heap, ordered by time.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -252,17 +483,109 @@ Interrupt::Halt()
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
+//
+//	Returns a handle, which the device can use to cancel or move the
+//	interrupt.  The handle is no good once the interrupt has fired
+//	(that is, once the device's CallBack has been called for it), or
+//	has been cancelled.
 //----------------------------------------------------------------------
-void
+PendingInterrupt *
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 {
-    int when = kernel->stats->totalTicks + fromNow;
+    long long when = kernel->stats->totalTicks + fromNow;
     PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
     pending->Insert(toOccur);
+    return toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::WhenReadable
+// 	Arrange for an interrupt to call "toCall" once the host file
+//	"fd" has something to read, however long that takes.  Used by
+//	devices that get their input from the host, rather than having
+//	them poll for it.
+//----------------------------------------------------------------------
+
+void
+Interrupt::WhenReadable(int fd, CallBackObj *toCall, IntType type)
+{
+    DEBUG(dbgInt, "Waiting for input for the " << intTypeNames[type]);
+    watcher->Watch(fd, toCall, type);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ForgetReadable
+// 	"toCall" has stopped waiting for input on the host file "fd"
+//	(it is going away, say): forget what WhenReadable arranged,
+//	including any interrupt for it that is already scheduled.
+//----------------------------------------------------------------------
+
+void
+Interrupt::ForgetReadable(int fd, CallBackObj *toCall)
+{
+    watcher->Forget(fd, toCall);
+    (void) Cancel(toCall);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Withdraw a scheduled interrupt, so that it never fires.
+//
+//	"handle" is what Schedule returned for it; it must not have
+//	fired yet.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Cancel(PendingInterrupt *handle)
+{
+    DEBUG(dbgInt, "Cancelling interrupt handler the " 
+		  << intTypeNames[handle->type] << " at time = " << handle->when);
+    pending->Remove(handle);
+    delete handle;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Reschedule
+// 	Move a scheduled interrupt to "fromNow" ticks from now, whether
+//	that is sooner or later than it was going to be.  The handle
+//	stays good.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Reschedule(PendingInterrupt *handle, int fromNow)
+{
+    ASSERT(fromNow > 0);
+    pending->Remove(handle);
+    handle->when = kernel->stats->totalTicks + fromNow;
+    DEBUG(dbgInt, "Rescheduling interrupt handler the " 
+		  << intTypeNames[handle->type] << " at time = " << handle->when);
+    pending->Insert(handle);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Or, withdraw every interrupt that is scheduled to call "toCall"
+//	(a device that has been reset, say), so that they never fire.
+//	Return how many there were.
+//
+//	Like Schedule, this is for the hardware device simulators.
+//----------------------------------------------------------------------
+
+int
+Interrupt::Cancel(CallBackObj *toCall)
+{
+    PendingInterrupt *p;
+    int numCancelled = 0;
+
+    while ((p = pending->Find(toCall)) != NULL) {
+	Cancel(p);
+	numCancelled++;
+    }
+    return numCancelled;
 }
 
 //----------------------------------------------------------------------
@@ -310,6 +633,8 @@ Interrupt::CheckIfDue(bool advanceClock)
     	kernel->machine->DelayedLoad(0, 0);
     }
 
+    HostTimer timer(HostInterrupt);	// (only once one is due, so the
+					// check itself is not timed)
     inHandler = TRUE;
     do {
         next = pending->RemoveFront();    // pull interrupt off list
@@ -345,7 +670,146 @@ Interrupt::DumpState()
 {
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
-    cout << "Pending interrupts:\n";
+    cout << "Pending interrupts (" << pending->NumPending() << "):\n";
     pending->Apply(PrintPending);
     cout << "\nEnd of pending interrupts\n";
+    kernel->alarm->Print();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SelfTest
+// 	Check that interrupts fire in order of time, and in the order
+//	they were scheduled for the same time; that a rescheduled
+//	interrupt fires at its new time; and that a cancelled interrupt
+//	does not fire at all.
+//
+//	Then time scheduling and firing EventTestEvents interrupts, with
+//	EventTestDepth of them pending at any one time, and compare the
+//	cost of just the queue operations with keeping them on a sorted
+//	list instead (as we used to).
+//----------------------------------------------------------------------
+
+static const int EventTestEvents = 1000000;
+static const int EventTestDepth = 256;
+static const int EventTestSpread = 1000;	// longest delay, in ticks
+
+static int eventLog[4];			// which tester fired, in order
+static int eventsLogged;
+
+class EventTester : public CallBackObj {
+  public:
+    EventTester(int id) { which = id; fired = toSchedule = 0; }
+
+    void CallBack() {
+	fired++;
+	if (which >= 0) {
+	    ASSERT(eventsLogged < 4);
+	    eventLog[eventsLogged++] = which;
+	}
+	if (toSchedule > 0) {
+	    toSchedule--;
+	    kernel->interrupt->Schedule(this, 
+			1 + RandomNumber() % EventTestSpread, TimerInt);
+	}
+    }
+
+    int which;				// for the log; -1 to not log
+    int fired;				// # of interrupts so far
+    int toSchedule;			// # more to schedule as they fire
+};
+
+static int
+PendingCompare(PendingInterrupt *x, PendingInterrupt *y)
+{
+    if (x->when < y->when) { return -1; }
+    else if (x->when > y->when) { return 1; }
+    else { return 0; }
+}
+
+// Time EventTestEvents removals and insertions, on "heap" if it isn't 
+// NULL, else on "list", with EventTestDepth interrupts queued.
+static double
+QueueOpsPerSecond(PendingQueue *heap, SortedList<PendingInterrupt *> *list)
+{
+    PendingInterrupt *p;
+    double start;
+
+    for (int i = 0; i < EventTestDepth; i++) {
+	p = new PendingInterrupt(NULL, RandomNumber() % EventTestSpread,
+				 TimerInt);
+	if (heap != NULL) { heap->Insert(p); } else { list->Insert(p); }
+    }
+    start = HostMicroseconds();
+    for (int i = 0; i < EventTestEvents; i++) {
+	p = (heap != NULL) ? heap->RemoveFront() : list->RemoveFront();
+	p->when += 1 + RandomNumber() % EventTestSpread;
+	if (heap != NULL) { heap->Insert(p); } else { list->Insert(p); }
+    }
+    start = HostMicroseconds() - start;
+    for (int i = 0; i < EventTestDepth; i++) {
+	delete ((heap != NULL) ? heap->RemoveFront() : list->RemoveFront());
+    }
+    return EventTestEvents * 1000000.0 / start;
+}
+
+void
+Interrupt::SelfTest()
+{
+    IntStatus oldLevel = SetLevel(IntOff);
+    EventTester *testers[4], *cancelled, *many;
+    int delays[4] = { 30, 10, 20, 10 };
+    int expected[4] = { 0, 1, 3, 2 };
+    PendingInterrupt *handle = NULL;
+    PendingQueue *heap;
+    SortedList<PendingInterrupt *> *list;
+    double start, fired, heapOps, listOps;
+
+    eventsLogged = 0;
+    for (int i = 0; i < 4; i++) {
+	testers[i] = new EventTester(i);
+	handle = Schedule(testers[i], delays[i], TimerInt);
+	if (i == 0) {
+	    Reschedule(handle, 5);	// now it goes first
+	}
+    }
+    cancelled = new EventTester(-1);
+    handle = Schedule(cancelled, 12, TimerInt);
+    Cancel(handle);
+    Schedule(cancelled, 15, TimerInt);
+    Schedule(cancelled, 25, TimerInt);
+    ASSERT(Cancel(cancelled) == 2);
+    while (eventsLogged < 4) {
+	CheckIfDue(TRUE);		// other devices may be pending too
+    }
+    for (int i = 0; i < 4; i++) {
+	ASSERT(eventLog[i] == expected[i]);
+	delete testers[i];
+    }
+    ASSERT(cancelled->fired == 0);
+    delete cancelled;
+
+    many = new EventTester(-1);
+    many->toSchedule = EventTestEvents - EventTestDepth;
+    start = HostMicroseconds();
+    for (int i = 0; i < EventTestDepth; i++) {
+	Schedule(many, 1 + RandomNumber() % EventTestSpread, TimerInt);
+    }
+    while (many->fired < EventTestEvents) {
+	CheckIfDue(TRUE);
+    }
+    fired = EventTestEvents * 1000000.0 / (HostMicroseconds() - start);
+    delete many;
+
+    heap = new PendingQueue();
+    heapOps = QueueOpsPerSecond(heap, NULL);
+    delete heap;
+    list = new SortedList<PendingInterrupt *>(PendingCompare);
+    listOps = QueueOpsPerSecond(NULL, list);
+    delete list;
+    (void) SetLevel(oldLevel);
+
+    cout << "Interrupts scheduled and fired per second: " << (int) fired
+	 << "; queue operations per second, " << EventTestDepth
+	 << " pending: heap " << (int) heapOps << ", sorted list " 
+	 << (int) listOps << "\n";
 }
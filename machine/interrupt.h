@@ -37,6 +37,8 @@
 #include "list.h"
 #include "callback.h"
 
+class IOWatcher;
+
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
 
@@ -57,15 +59,61 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt(CallBackObj *callOnInt, long long time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
 
     CallBackObj *callOnInterrupt;// The object (in the hardware device
 				// emulator) to call when the interrupt occurs
     
-    int when;			// When the interrupt is supposed to fire
+    long long when;		// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int order;		// interrupts due at the same time fire
+				// in the order they were scheduled
+    int heapIndex;		// where it is in the PendingQueue
+
+    void *operator new(size_t size);	// these come from a slab cache
+    void operator delete(void *p, size_t size);
+};
+
+// The following class defines the interrupts that are scheduled to
+// occur, as a binary heap, earliest first.  Scheduling an interrupt
+// or taking the earliest one off takes O(log n) time, and so does
+// taking one off from the middle (each interrupt knows where it is in
+// the heap).  The array grows as needed, and is never shrunk, so once
+// it is big enough, no allocation is needed.
+
+class PendingQueue {
+  public:
+    PendingQueue();		// initialize an empty queue
+    ~PendingQueue();		// de-allocate the array (not the
+				// interrupts on it)
+
+    bool IsEmpty() { return numPending == 0; }
+    int NumPending() { return numPending; }
+    PendingInterrupt *Front()	// the earliest interrupt, if any
+	{ return (numPending == 0) ? NULL : heap[0]; }
+
+    void Insert(PendingInterrupt *p);	// put "p" in its place
+    PendingInterrupt *RemoveFront();	// take off the earliest interrupt
+    void Remove(PendingInterrupt *p);	// take "p" off
+    PendingInterrupt *Find(CallBackObj *callOnInt);
+				// any interrupt that calls "callOnInt"
+
+    void Apply(void (*f)(PendingInterrupt *));
+				// call "f" on each interrupt, in no
+				// particular order
+
+  private:
+    PendingInterrupt **heap;	// heap[0] is the earliest interrupt
+    int size;			// # of entries the array has room for
+    int numPending;		// # of entries in use
+    unsigned int nextOrder;	// "order" of the next interrupt inserted
+
+    bool Before(PendingInterrupt *a, PendingInterrupt *b);
+				// should "a" fire before "b"?
+    void SiftUp(int i);		// move heap[i] up, or down, until it
+    void SiftDown(int i);	// is in order
 };
 
 // The following class defines the data structures for the simulation
@@ -75,7 +123,8 @@ class PendingInterrupt {
 
 class Interrupt {
   public:
-    Interrupt();		// initialize the interrupt simulation
+    Interrupt(bool deterministicInput = FALSE);
+				// initialize the interrupt simulation
     ~Interrupt();		// de-allocate data structures
     
     IntStatus SetLevel(IntStatus level);
@@ -98,29 +147,51 @@ class Interrupt {
 				// from an interrupt handler
 
     MachineStatus getStatus() { return status; } 
+    bool inInterruptHandler() { return inHandler; }
     void setStatus(MachineStatus st) { status = st; }
         			// idle, kernel, user
 
     void DumpState();		// Print interrupt state
     
+    void SelfTest();		// check the order interrupts fire in,
+				// and time scheduling lots of them
+
 
     // NOTE: the following are internal to the hardware simulation code.
     // DO NOT call these directly.  I should make them "private",
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    PendingInterrupt *Schedule(CallBackObj *callTo, int when, IntType type);
     				// Schedule an interrupt to occur
 				// at time "when".  This is called
     				// by the hardware device simulators.
+				// Returns a handle for the interrupt,
+				// good until it fires or is cancelled.
+    void Cancel(PendingInterrupt *handle);
+				// Withdraw a scheduled interrupt
+    void Reschedule(PendingInterrupt *handle, int when);
+				// Move a scheduled interrupt to
+				// "when" from now, sooner or later
+
+    void WhenReadable(int fd, CallBackObj *callTo, IntType type);
+				// Interrupt "callTo" once the host
+				// file "fd" has input (see iowatcher.h)
+    void ForgetReadable(int fd, CallBackObj *callTo);
+				// Stop waiting for input for "callTo"
+
+    int Cancel(CallBackObj *callTo);
+				// Cancel every interrupt scheduled to
+				// call "callTo", and return how many
+				// there were
     
     void OneTick();       	// Advance simulated time
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
+    PendingQueue *pending;	// the interrupts scheduled
 				// to occur in the future
+    IOWatcher *watcher;		// finds host input for the devices
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -0,0 +1,318 @@
+// iowatcher.cc
+//	Routines to wait for input on host files and sockets, on a host
+//	thread of its own, and to pass it on to the simulated devices as
+//	interrupts.
+//
+//	This uses epoll, so it only works on Linux.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "iowatcher.h"
+#include "main.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------
+// IOWatcher::IOWatcher
+// 	Initialize the watcher, with nothing to watch yet, and start the
+//	helper thread.
+//
+//	"deterministic" -- if true, only pass on input when the
+//		simulation has nothing else to do.
+//----------------------------------------------------------------------
+
+IOWatcher::IOWatcher(bool isDeterministic)
+{
+    deterministic = isDeterministic;
+    numReady = 0;
+    for (int i = 0; i < MaxWatched; i++) {
+	files[i].fd = -1;
+	files[i].generation = 0;
+    }
+    log = kernel->inputLog;
+    point = 0;
+    generations = 0;
+    pthread_mutex_init(&mutex, NULL);
+    if (log != NULL && log->IsPlayingBack()) {
+	return;				// nothing to wait for on the host
+    }
+    epollFd = epoll_create(MaxWatched);
+    ASSERT(epollFd >= 0);
+    pthread_cond_init(&inputReady, NULL);
+    if (pthread_create(&helper, NULL, WaitLoop, this) != 0) {
+	ASSERT(FALSE);
+    }
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::~IOWatcher
+// 	Stop the helper thread (it is waiting in epoll_wait, which is a
+//	place it can be cancelled), and clean up.
+//----------------------------------------------------------------------
+
+IOWatcher::~IOWatcher()
+{
+    if (log != NULL && log->IsPlayingBack()) {
+	pthread_mutex_destroy(&mutex);
+	return;
+    }
+    pthread_cancel(helper);
+    pthread_join(helper, NULL);
+    for (int i = 0; i < MaxWatched; i++) {
+	if (files[i].fd != -1 && files[i].watchFd != files[i].fd) {
+	    close(files[i].watchFd);
+	}
+    }
+    close(epollFd);
+    pthread_cond_destroy(&inputReady);
+    pthread_mutex_destroy(&mutex);
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::WaitLoop
+// 	The helper thread: wait until some watched files are readable,
+//	note them, and wait again.  Each file is watched "one shot", so
+//	it is not reported again until the device asks to watch it again.
+//	Each event carries the slot, and the generation of the slot it was
+//	asked for in.
+//----------------------------------------------------------------------
+
+void *
+IOWatcher::WaitLoop(void *arg)
+{
+    IOWatcher *watcher = (IOWatcher *) arg;
+    struct epoll_event events[MaxWatched];
+    int n;
+
+    for (;;) {
+	n = epoll_wait(watcher->epollFd, events, MaxWatched, -1);
+	for (int i = 0; i < n; i++) {
+	    watcher->MarkReady((int) (events[i].data.u64 & 0xffffffff),
+			       (unsigned int) (events[i].data.u64 >> 32));
+	}
+    }
+    return NULL;	// not reached
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::MarkReady
+// 	Note that files[i] has input, and wake up the simulation if it
+//	is waiting for some.  Called by the helper thread, and by Watch.
+//	An event for a slot that has since been forgotten, and perhaps
+//	handed out again, is of a different "generation", and ignored.
+//----------------------------------------------------------------------
+
+void
+IOWatcher::MarkReady(int i, unsigned int generation)
+{
+    pthread_mutex_lock(&mutex);
+    if (files[i].generation == generation && files[i].watching) {
+	files[i].watching = FALSE;
+	files[i].ready = TRUE;
+	numReady++;
+	pthread_cond_broadcast(&inputReady);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::Find
+// 	Return the slot in which "toCall" watches "fd", or -1 if it has
+//	none.  Only the simulation changes which slots are in use, so it
+//	can look without the mutex.
+//----------------------------------------------------------------------
+
+int
+IOWatcher::Find(int fd, CallBackObj *toCall)
+{
+    for (int i = 0; i < MaxWatched; i++) {
+	if (files[i].fd == fd && files[i].toCall == toCall) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::Watch
+// 	Arrange for "toCall" to be interrupted once "fd" has input to be
+//	read.  This happens once; to hear about more input, the device
+//	has to call Watch again.
+//
+//	"type" is the kind of interrupt to cause
+//----------------------------------------------------------------------
+
+void
+IOWatcher::Watch(int fd, CallBackObj *toCall, IntType type)
+{
+    bool playingBack = (log != NULL && log->IsPlayingBack());
+    struct epoll_event event;
+    int i = Find(fd, toCall);
+    int watchFd = fd;
+
+    if (i == -1) {			// a new one
+	for (i = 0; i < MaxWatched && files[i].fd != -1; i++) {}
+	ASSERT(i < MaxWatched);
+	for (int j = 0; j < MaxWatched; j++) {
+	    if (files[j].fd == fd && !playingBack) {
+		watchFd = dup(fd);	// epoll only takes an fd once
+		ASSERT(watchFd >= 0);
+		break;
+	    }
+	}
+	pthread_mutex_lock(&mutex);
+	files[i].fd = fd;
+	files[i].watchFd = watchFd;
+	files[i].generation = ++generations;
+	files[i].toCall = toCall;
+	files[i].added = FALSE;
+	files[i].ready = FALSE;
+	pthread_mutex_unlock(&mutex);
+    }
+    pthread_mutex_lock(&mutex);
+    files[i].type = type;
+    files[i].watching = TRUE;
+    pthread_mutex_unlock(&mutex);
+    if (playingBack) {
+	return;
+    }
+
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = ((unsigned long long) files[i].generation << 32) | i;
+    if (epoll_ctl(epollFd, files[i].added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+		  files[i].watchFd, &event) == 0) {
+	files[i].added = TRUE;
+    } else {
+	// can't be watched: assume there is always something to read
+	MarkReady(i, files[i].generation);
+    }
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::Forget
+// 	"toCall" no longer wants to hear about input on "fd" -- whether
+//	or not it has had any -- so free its slot, and drop any input
+//	noted for it that has not been delivered yet.
+//----------------------------------------------------------------------
+
+void
+IOWatcher::Forget(int fd, CallBackObj *toCall)
+{
+    int i = Find(fd, toCall);
+
+    if (i == -1) {
+	return;
+    }
+    if (files[i].added) {
+	(void) epoll_ctl(epollFd, EPOLL_CTL_DEL, files[i].watchFd, NULL);
+    }
+    if (files[i].watchFd != fd) {
+	close(files[i].watchFd);
+    }
+    pthread_mutex_lock(&mutex);
+    if (files[i].ready) {
+	numReady--;
+    }
+    files[i].fd = -1;
+    files[i].toCall = NULL;
+    files[i].watching = files[i].ready = FALSE;
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::Deliver
+// 	Schedule an interrupt, right away, for each device whose file
+//	has input -- unless we are deterministic, and the simulation is
+//	not "idle" (with nothing else to do).
+//
+//	Called by the simulation with interrupts disabled.  This is done
+//	every time simulated time advances, so the usual case, where no
+//	input has come in, does not touch the mutex.
+//
+//	Playing back a log of input, schedule the interrupts the log
+//	says to, instead.
+//----------------------------------------------------------------------
+
+void
+IOWatcher::Deliver(bool idle)
+{
+    CallBackObj *toCall[MaxWatched];
+    IntType type[MaxWatched];
+    unsigned int mask = 0;
+    int n = 0;
+
+    point++;
+    if (log != NULL && log->IsPlayingBack()) {
+	if (log->PlayReady(point, &mask)) {
+	    for (int i = 0; i < MaxWatched; i++) {
+		if (mask & (1 << i)) {
+		    ASSERT(files[i].fd != -1);
+		    files[i].watching = FALSE;
+		    kernel->interrupt->Schedule(files[i].toCall, 1,
+						files[i].type);
+		}
+	    }
+	}
+	return;
+    }
+    if (numReady == 0 || (deterministic && !idle)) {
+	return;
+    }
+    pthread_mutex_lock(&mutex);
+    for (int i = 0; i < MaxWatched; i++) {
+	if (files[i].fd != -1 && files[i].ready) {
+	    files[i].ready = FALSE;
+	    toCall[n] = files[i].toCall;
+	    type[n++] = files[i].type;
+	    mask |= 1 << i;
+	}
+    }
+    numReady = 0;
+    pthread_mutex_unlock(&mutex);
+    if (log != NULL && n > 0) {
+	log->RecordReady(point, mask);
+    }
+    for (int i = 0; i < n; i++) {
+	kernel->interrupt->Schedule(toCall[i], 1, type[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// IOWatcher::WaitForInput
+// 	The simulation has nothing to do until some input comes in.
+//	Wait (on the host, without using any CPU) until it does.  Return
+//	FALSE, without waiting, if no device is waiting for input.
+//
+//	Playing back a log, there is no need to wait: the next input in
+//	the log is the input that came.  If the log has run out, none
+//	ever will.
+//----------------------------------------------------------------------
+
+bool
+IOWatcher::WaitForInput()
+{
+    bool any;
+
+    if (log != NULL && log->IsPlayingBack()) {
+	any = FALSE;
+	for (int i = 0; i < MaxWatched; i++) {
+	    any = any || (files[i].fd != -1 && files[i].watching);
+	}
+	return any && !log->AtEnd();
+    }
+    pthread_mutex_lock(&mutex);
+    any = (numReady > 0);
+    for (int i = 0; i < MaxWatched; i++) {
+	any = any || (files[i].fd != -1 && files[i].watching);
+    }
+    while (any && numReady == 0) {
+	pthread_cond_wait(&inputReady, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+    return any;
+}
@@ -0,0 +1,108 @@
+// iowatcher.h
+//	Data structures to find out when the host files and sockets that
+//	simulate the console and the network have input, without polling
+//	them.
+//
+//	A device that is waiting for input asks to be interrupted once
+//	its file is readable (Watch).  A helper thread on the host waits
+//	for any of the watched files at once (with epoll), and notes which
+//	are readable.  The simulation picks up the notes at a safe point
+//	-- when simulated time advances, or when the machine is idle --
+//	and turns each one into an interrupt for the device.  So when no
+//	input is coming, nothing is done at all; when the machine is idle
+//	with nothing else to do, the host waits for input, rather than
+//	spinning.
+//
+//	The helper thread touches nothing but the notes, which are
+//	protected by a host mutex.
+//
+//	If "deterministic" is set, the notes are only picked up when the
+//	simulation has nothing else left to do.  Then when input is seen,
+//	in simulated time, does not depend on how fast the host runs:
+//	only on when the simulation would otherwise have waited for it.
+//
+//	A file that can not be watched (a regular file, say) is always
+//	readable, so it is taken to have input straight away.
+//
+//	More than one device can watch the same file (the console and
+//	the Read system call both read the host's stdin, say); each gets
+//	a slot of its own, and epoll is given a duplicate of the file
+//	descriptor for each slot after the first.  A device that gives
+//	up waiting has to Forget its slot, so that it can be re-used.
+//
+//	When input is being recorded (see inputlog.h), the watcher notes
+//	which files it passed on input for, and at which point -- each
+//	time it looks counts as one.  When input is played back, there is
+//	no helper thread: the watcher passes on input at the points the
+//	log says, and the host files are never looked at.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IOWATCHER_H
+#define IOWATCHER_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "callback.h"
+#include "interrupt.h"
+#include "inputlog.h"
+#include <pthread.h>
+
+#define MaxWatched	8	// # of files that can be watched
+
+// One watched file.
+class WatchedFile {
+  public:
+    int fd;			// host file descriptor, or -1 if unused
+    int watchFd;		// what epoll watches: "fd", or a dup of it
+    unsigned int generation;	// bumped each time the slot is re-used,
+				// so stale epoll events are ignored
+    CallBackObj *toCall;	// device to interrupt when it has input
+    IntType type;		// which kind of interrupt, for debugging
+    bool added;			// has the helper thread been told of it?
+    bool watching;		// is the device waiting for input?
+    bool ready;			// has input, device not told yet
+};
+
+// The following class defines the watcher for host input.
+class IOWatcher {
+  public:
+    IOWatcher(bool deterministic);	// start the helper thread
+    ~IOWatcher();			// stop it
+
+    void Watch(int fd, CallBackObj *toCall, IntType type);
+				// interrupt "toCall" once "fd" has input
+    void Forget(int fd, CallBackObj *toCall);
+				// stop watching "fd" for "toCall"
+    void Deliver(bool idle);	// schedule an interrupt for each
+				// watched file that has input (if it is
+				// time to look)
+    bool WaitForInput();	// wait on the host until some watched
+				// file has input; FALSE if none are
+				// being watched
+
+  private:
+    bool deterministic;		// only look when nothing else to do?
+    int epollFd;		// what the helper thread waits on
+    pthread_t helper;		// the helper thread
+    pthread_mutex_t mutex;	// protects the "ready" notes and
+    pthread_cond_t inputReady;	// numReady; signalled when it goes up
+    volatile int numReady;	// # of files with undelivered input
+    WatchedFile files[MaxWatched];
+    InputLog *log;		// input being recorded or played back
+    unsigned long long point;	// # of times Deliver has been called
+    unsigned int generations;	// # of slots handed out so far
+
+    static void *WaitLoop(void *watcher);
+				// the helper thread's main loop
+    void MarkReady(int i, unsigned int generation);
+				// note that files[i] has input
+    int Find(int fd, CallBackObj *toCall);
+				// the slot "toCall" watches "fd" in, or -1
+};
+
+#endif // IOWATCHER_H
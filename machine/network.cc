@@ -11,6 +11,7 @@
 #include "copyright.h"
 #include "network.h"
 #include "main.h"
+#include "inputlog.h"
 
 //-----------------------------------------------------------------------
 // NetworkInput::NetworkInput
@@ -25,14 +26,15 @@ NetworkInput::NetworkInput(CallBackObj *toCall)
     callWhenAvail = toCall;
     packetAvail = FALSE;
     inHdr.length = 0;
+    arrived = 0;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", kernel->hostName);
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
-    // start polling for incoming packets
-    kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
+    // interrupt when a packet comes in
+    kernel->interrupt->WhenReadable(sock, this, NetworkRecvInt);
 }
 
 //-----------------------------------------------------------------------
@@ -52,25 +54,39 @@ NetworkInput::~NetworkInput()
 //	Simulator calls this when a packet may be available to
 //	be read in from the simulated network.
 //
-//      First check to make sure packet is available & there's space to
-//	pull it in.  Then invoke the "callBack" registered by whoever 
-//	wants the packet.
+//      First check to make sure packet is available.  Then pull it in,
+//	and invoke the "callBack" registered by whoever wants the packet.
+//
+//	There is nowhere to put another packet until this one has been
+//	received, so we stop watching the socket until then.
+//
+//	Packets are logged, or played back, like console input.
 //-----------------------------------------------------------------------
 
 void
 NetworkInput::CallBack()
 {
-    // schedule the next time to poll for a packet
-    kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
-
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
-
-    // otherwise, read packet in
+    InputLog *log = kernel->inputLog;
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    int result = -1;
+
+    ASSERT(inHdr.length == 0);
+    if (log != NULL && log->IsPlayingBack()) {
+	result = log->Play(InputPacket, buffer, MaxWireSize);
+    } else {
+	if (PollSocket(sock)) {		// read packet in
+	    ReadFromSocket(sock, buffer, MaxWireSize);
+	    result = MaxWireSize;
+	}
+	if (log != NULL) {
+	    log->Record(InputPacket, buffer, result);
+	}
+    }
+    if (result < 0) {		// interrupt again when there is one
+	delete [] buffer;
+	kernel->interrupt->WhenReadable(sock, this, NetworkRecvInt);
+	return;
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -80,6 +96,7 @@ NetworkInput::CallBack()
 
     DEBUG(dbgNet, "Network received packet from " << inHdr.from << ", length " << inHdr.length);
     kernel->stats->numPacketsRecvd++;
+    arrived = kernel->stats->totalTicks;
 
     // tell post office that the packet has arrived
     callWhenAvail->CallBack();
@@ -98,6 +115,10 @@ NetworkInput::Receive(char* data)
     inHdr.length = 0;
     if (hdr.length != 0) {
     	bcopy(inbox, data, hdr.length);
+	// room for the next packet: look for one
+	kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
+	kernel->stats->packetRecvLatency.Record(
+				kernel->stats->totalTicks - arrived);
     }
     return hdr;
 }
@@ -77,6 +77,7 @@ class NetworkInput : public CallBackObj{
     bool packetAvail;		// Packet has arrived, can be pulled off of
 				//   network
     PacketHeader inHdr;		// Information about arrived packet
+    long long arrived;		// when it arrived
     char inbox[MaxPacketSize];  // Data for arrived packet
 };
 
@@ -0,0 +1,143 @@
+// snapshot.cc
+//	Routines to save the state of the machine to a snapshot file, and
+//	to restore it from one.  See snapshot.h for what is saved, and
+//	when it can be.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "snapshot.h"
+#include "main.h"
+#include "synchdisk.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------
+// Snapshot::Save
+// 	Write the state of the machine, as it is now, to the host file
+//	"fileName".  The kernel must have finished setting up, and not
+//	yet started any user program.
+//----------------------------------------------------------------------
+
+void
+Snapshot::Save(char *fileName)
+{
+    SnapshotHeader header;
+    int page = HostPageSize();
+    char *disk = new char[NumSectors * SectorSize];
+    int fd;
+
+    ASSERT(Statistics::NumFields() <= SnapshotMaxStats);
+    bzero((char *) &header, sizeof(header));
+    header.magic = SnapshotMagic;
+    header.memorySize = MemorySize;
+    header.memoryOffset = divRoundUp(sizeof(header), page) * page;
+    header.diskSize = NumSectors * SectorSize;
+    header.diskOffset = header.memoryOffset +
+			divRoundUp(MemorySize, page) * page;
+    header.numStats = Statistics::NumFields();
+    for (int i = 0; i < header.numStats; i++) {
+	header.stats[i] = kernel->stats->Field(i);
+    }
+    for (int i = 0; i < NumTotalRegs; i++) {
+	header.registers[i] = kernel->machine->ReadRegister(i);
+    }
+    kernel->synchDisk->getDisk()->CopyOut(disk);
+
+    DEBUG(dbgDisk, "Saving snapshot in " << fileName);
+    fd = OpenForWrite(fileName);
+    WriteFile(fd, (char *) &header, sizeof(header));
+    Lseek(fd, header.memoryOffset, 0);
+    WriteFile(fd, kernel->machine->mainMemory, MemorySize);
+    Lseek(fd, header.diskOffset, 0);
+    WriteFile(fd, disk, header.diskSize);
+    Close(fd);
+    delete [] disk;
+}
+
+//----------------------------------------------------------------------
+// Snapshot::Snapshot
+// 	Map the snapshot in "fileName" into memory, privately, so that
+//	changes made to it are not written back.  Give up if it is not
+//	a snapshot of a machine like this one.
+//----------------------------------------------------------------------
+
+Snapshot::Snapshot(char *fileName)
+{
+    struct stat info;
+    int fd = open(fileName, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &info) < 0) {
+	cerr << "Unable to open snapshot " << fileName << "\n";
+	Abort();
+    }
+    length = info.st_size;
+    contents = (char *) mmap(NULL, length, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE, fd, 0);
+    close(fd);
+    header = (SnapshotHeader *) contents;
+    if (contents == (char *) MAP_FAILED ||
+		length < (int) sizeof(SnapshotHeader) ||
+		header->magic != SnapshotMagic ||
+		header->memorySize != MemorySize ||
+		header->diskSize != NumSectors * SectorSize ||
+		header->numStats != Statistics::NumFields() ||
+		length < header->diskOffset + header->diskSize) {
+	cerr << "Not a snapshot of this machine: " << fileName << "\n";
+	Abort();
+    }
+    DEBUG(dbgDisk, "Restoring from snapshot " << fileName);
+}
+
+//----------------------------------------------------------------------
+// Snapshot::~Snapshot
+// 	Unmap the snapshot.  Nothing should be using its disk by now.
+//----------------------------------------------------------------------
+
+Snapshot::~Snapshot()
+{
+    munmap(contents, length);
+}
+
+//----------------------------------------------------------------------
+// Snapshot::Restore
+// 	Put the statistics back as they were -- this must be done before
+//	anything is scheduled, since it turns the clock forward -- or put
+//	back the CPU registers and the contents of main memory.
+//----------------------------------------------------------------------
+
+void
+Snapshot::Restore(Statistics *stats)
+{
+    for (int i = 0; i < header->numStats; i++) {
+	stats->SetField(i, header->stats[i]);
+    }
+}
+
+void
+Snapshot::Restore(Machine *machine)
+{
+    for (int i = 0; i < NumTotalRegs; i++) {
+	machine->WriteRegister(i, header->registers[i]);
+    }
+    bcopy(contents + header->memoryOffset, machine->mainMemory, MemorySize);
+}
+
+//----------------------------------------------------------------------
+// Snapshot::DiskImage
+// 	Return the contents of the disk, for the disk to read and write
+//	in place.  Pages are only read in from the file when they are
+//	first touched, and only copied when they are first written.
+//----------------------------------------------------------------------
+
+char *
+Snapshot::DiskImage()
+{
+    return contents + header->diskOffset;
+}
@@ -0,0 +1,79 @@
+// snapshot.h
+//	Data structures to save the state of a booted Nachos machine in
+//	a file, and to start other runs from it.
+//
+//	Getting a machine ready to run a test -- formatting the disk,
+//	copying programs onto it -- costs the same every time.  Instead,
+//	do it once, and save a snapshot ("nachos -f -cp ... -ss snap");
+//	then start each run from the snapshot ("nachos -ls snap -x ...").
+//
+//	A snapshot is taken at the point where the kernel has finished
+//	setting up, before any user program has started: only the main
+//	thread is running, and nothing is waiting on a device.  So the
+//	kernel's own data structures -- threads, pending interrupts --
+//	are as they are in any freshly booted kernel, and are simply built
+//	again; what a snapshot holds is everything else: the statistics
+//	(including the time), the CPU registers, main memory, and the
+//	contents of the disk.
+//
+//	A restored run maps the snapshot file into memory, copy-on-write,
+//	and uses the disk contents right where they are, instead of
+//	opening the DISK_n file.  So starting from a snapshot reads only
+//	the parts of the disk that are used, many runs share one copy of
+//	it, and nothing a run writes gets back to the snapshot.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+#include "stats.h"
+
+#define SnapshotMagic	0x4e534e51	// marks a file as a snapshot (with
+					// 64-bit statistics)
+#define SnapshotMaxStats	32	// room for this many counters
+
+// The start of a snapshot file.  Main memory and the disk follow,
+// each starting on a host page boundary, so that they can be mapped.
+
+class SnapshotHeader {
+  public:
+    int magic;			// SnapshotMagic
+    int memorySize;		// # of bytes of main memory saved
+    int memoryOffset;		// where they are in the file
+    int diskSize;		// # of bytes of disk saved
+    int diskOffset;		// where they are in the file
+    int numStats;		// # of statistics counters saved
+    long long stats[SnapshotMaxStats];	// their values
+    int registers[NumTotalRegs];	// the CPU registers
+};
+
+// The following class defines a snapshot, mapped in to be restored.
+
+class Snapshot {
+  public:
+    Snapshot(char *fileName);	// Map in a snapshot, and check it
+    ~Snapshot();		// Unmap it
+
+    static void Save(char *fileName);
+				// Write a snapshot of the machine now
+
+    void Restore(Statistics *stats);	// Put back the statistics,
+    void Restore(Machine *machine);	// and the CPU and main memory
+    char *DiskImage();		// The disk's sectors, to be used in
+				// place (they are copy-on-write)
+
+  private:
+    char *contents;		// the mapped file
+    int length;			// # of bytes in it
+    SnapshotHeader *header;	// at the front of "contents"
+};
+
+#endif // SNAPSHOT_H
@@ -10,6 +10,10 @@
 #include "copyright.h"
 #include "debug.h"
 #include "stats.h"
+#include "slab.h"
+#include <fstream>
+
+volatile sig_atomic_t Statistics::dumpAsked = 0;
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -17,11 +21,316 @@
 //----------------------------------------------------------------------
 
 Statistics::Statistics()
+    : diskLatency("diskLatency"),
+      consoleReadLatency("consoleReadLatency"),
+      consoleWriteLatency("consoleWriteLatency"),
+      packetRecvLatency("packetRecvLatency"),
+      packetSendLatency("packetSendLatency"),
+      dispatchLatency("dispatchLatency")
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTimerInterrupts = numWastedTimerInterrupts = 0;
+    shares = new List<ShareRecord *>;
+    locks = new List<LockRecord *>;
+    threads = new List<ThreadRecord *>;
+    spaces = new List<SpaceRecord *>;
+    dumpFile = NULL;
+}
+
+//----------------------------------------------------------------------
+// Statistics::~Statistics
+// 	De-allocate the records of CPU shares, locks, threads and
+//	programs.
+//----------------------------------------------------------------------
+
+Statistics::~Statistics()
+{
+    while (!shares->IsEmpty()) {
+	ShareRecord *record = shares->RemoveFront();
+	delete [] record->name;
+	delete record;
+    }
+    delete shares;
+    while (!locks->IsEmpty()) {
+	LockRecord *record = locks->RemoveFront();
+	delete [] record->name;
+	delete record;
+    }
+    delete locks;
+    while (!threads->IsEmpty()) {
+	ThreadRecord *record = threads->RemoveFront();
+	delete [] record->name;
+	delete record;
+    }
+    delete threads;
+    while (!spaces->IsEmpty()) {
+	SpaceRecord *record = spaces->RemoveFront();
+	delete [] record->name;
+	delete record;
+    }
+    delete spaces;
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordShare
+// 	Remember how much CPU time a thread got for its tickets, to be
+//	printed at the end.
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordShare(char *name, int tickets, long long ticks)
+{
+    ShareRecord *record = new ShareRecord;
+
+    record->name = new char[strlen(name) + 1];
+    strcpy(record->name, name);
+    record->tickets = tickets;
+    record->ticks = ticks;
+    shares->Append(record);
+}
+
+//----------------------------------------------------------------------
+// Statistics::FindLock
+// 	Return the contention record for locks called "name", starting
+//	a new one if this is the first lock of that name.
+//----------------------------------------------------------------------
+
+LockRecord *
+Statistics::FindLock(char *name)
+{
+    ListIterator<LockRecord *> *iter;
+    LockRecord *record = NULL;
+
+    iter = new ListIterator<LockRecord *>(locks);
+    for (; !iter->IsDone(); iter->Next()) {
+	if (strcmp(iter->Item()->name, name) == 0) {
+	    record = iter->Item();
+	    break;
+	}
+    }
+    delete iter;
+    if (record != NULL) {
+	return record;
+    }
+    record = new LockRecord;
+    record->name = new char[strlen(name) + 1];
+    strcpy(record->name, name);
+    record->acquires = record->contended = 0;
+    record->waitTicks = record->maxWaitTicks = record->holdTicks = 0;
+    locks->Append(record);
+    return record;
+}
+
+//----------------------------------------------------------------------
+// Statistics::FindThread, FindSpace
+// 	Return the record for the threads called "name", or for the
+//	processes running the program "name", starting a new one if
+//	need be.  Threads (and processes) with the same name share a
+//	record, so a run that starts thousands of threads doesn't keep
+//	thousands of records.
+//----------------------------------------------------------------------
+
+ThreadRecord *
+Statistics::FindThread(char *name)
+{
+    ListIterator<ThreadRecord *> iter(threads);
+    ThreadRecord *record;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (strcmp(iter.Item()->name, name) == 0) {
+	    return iter.Item();
+	}
+    }
+    record = new ThreadRecord;
+    record->name = new char[strlen(name) + 1];
+    strcpy(record->name, name);
+    record->threads = record->cpuTicks = record->userTicks = 0;
+    record->readyTicks = record->dispatches = 0;
+    threads->Append(record);
+    return record;
+}
+
+SpaceRecord *
+Statistics::FindSpace(char *name)
+{
+    ListIterator<SpaceRecord *> iter(spaces);
+    SpaceRecord *record;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (strcmp(iter.Item()->name, name) == 0) {
+	    return iter.Item();
+	}
+    }
+    record = new SpaceRecord;
+    record->name = new char[strlen(name) + 1];
+    strcpy(record->name, name);
+    record->processes = record->threads = 0;
+    record->cpuTicks = record->userTicks = record->syscalls = 0;
+    spaces->Append(record);
+    return record;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Histogram
+// 	Start a histogram of the values of "histName", with none yet.
+//----------------------------------------------------------------------
+
+Histogram::Histogram(char *histName)
+{
+    name = histName;
+    count = sum = min = max = 0;
+    for (int i = 0; i < HistogramBuckets; i++) {
+	buckets[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Histogram::Record
+// 	Count "value" (which can't be negative) in its bucket: one more
+//	than the number of bits it takes.
+//----------------------------------------------------------------------
+
+void
+Histogram::Record(long long value)
+{
+    int bucket = 0;
+
+    ASSERT(value >= 0);
+    for (long long v = value; v > 0 && bucket < HistogramBuckets - 1;
+							v >>= 1) {
+	bucket++;
+    }
+    buckets[bucket]++;
+    if (count == 0 || value < min) {
+	min = value;
+    }
+    if (count == 0 || value > max) {
+	max = value;
+    }
+    count++;
+    sum += value;
+}
+
+//----------------------------------------------------------------------
+// Histogram::BucketLow, BucketHigh
+// 	The range of values counted in bucket "i".  (The last bucket
+//	also counts anything bigger.)
+//----------------------------------------------------------------------
+
+long long
+Histogram::BucketLow(int i)
+{
+    return (i == 0) ? 0 : (1LL << (i - 1));
+}
+
+long long
+Histogram::BucketHigh(int i)
+{
+    return (1LL << i) - 1;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Percentile
+// 	Return a bound on the "p"th percentile value: the most any value
+//	in its bucket can be (but no more than the biggest value seen).
+//----------------------------------------------------------------------
+
+long long
+Histogram::Percentile(int p)
+{
+    long long wanted = (count * p + 99) / 100, seen = 0;
+
+    for (int i = 0; i < HistogramBuckets; i++) {
+	seen += buckets[i];
+	if (seen >= wanted && seen > 0) {
+	    return (BucketHigh(i) < max) ? BucketHigh(i) : max;
+	}
+    }
+    return max;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NumFields, FieldName, Field, SetField
+// 	The counters, in the order they are saved in, with the names
+//	they are saved under.
+//----------------------------------------------------------------------
+
+static long long Statistics::*fields[] = {
+    &Statistics::totalTicks, &Statistics::idleTicks,
+    &Statistics::systemTicks, &Statistics::userTicks,
+    &Statistics::numDiskReads, &Statistics::numDiskWrites,
+    &Statistics::numConsoleCharsRead, &Statistics::numConsoleCharsWritten,
+    &Statistics::numPageFaults, &Statistics::numPacketsSent,
+    &Statistics::numPacketsRecvd, &Statistics::numTimerInterrupts,
+    &Statistics::numWastedTimerInterrupts
+};
+
+static char *fieldNames[] = {
+    "totalTicks", "idleTicks", "systemTicks", "userTicks",
+    "diskReads", "diskWrites", "consoleCharsRead", "consoleCharsWritten",
+    "pageFaults", "packetsSent", "packetsRecvd", "timerInterrupts",
+    "wastedTimerInterrupts"
+};
+
+// The histograms, in the order they are printed and written out in.
+
+static Histogram Statistics::*histograms[] = {
+    &Statistics::diskLatency, &Statistics::consoleReadLatency,
+    &Statistics::consoleWriteLatency, &Statistics::packetRecvLatency,
+    &Statistics::packetSendLatency, &Statistics::dispatchLatency
+};
+
+static const int NumHistograms = sizeof(histograms) / sizeof(histograms[0]);
+
+int
+Statistics::NumFields()
+{
+    return sizeof(fields) / sizeof(fields[0]);
+}
+
+char *
+Statistics::FieldName(int i)
+{
+    ASSERT(i >= 0 && i < NumFields());
+    return fieldNames[i];
+}
+
+long long
+Statistics::Field(int i)
+{
+    ASSERT(i >= 0 && i < NumFields());
+    return this->*fields[i];
+}
+
+void
+Statistics::SetField(int i, long long value)
+{
+    ASSERT(i >= 0 && i < NumFields());
+    this->*fields[i] = value;
+}
+
+//----------------------------------------------------------------------
+// Statistics::Save
+// 	Write the counters to the host file "fileName", as one line of
+//	numbers separated by commas, for another program to read.
+//----------------------------------------------------------------------
+
+void
+Statistics::Save(char *fileName)
+{
+    char line[sizeof(fields) / sizeof(fields[0]) * 21 + 1];
+    int fd, length = 0;
+
+    for (int i = 0; i < NumFields(); i++) {
+	length += sprintf(line + length, i == 0 ? "%lld" : ",%lld", Field(i));
+    }
+    line[length++] = '\n';
+    fd = OpenForWrite(fileName);
+    WriteFile(fd, line, length);
+    Close(fd);
 }
 
 //----------------------------------------------------------------------
@@ -42,4 +351,459 @@ Statistics::Print()
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    cout << "Timer interrupts: " << numTimerInterrupts;
+    cout << ", wasted " << numWastedTimerInterrupts << "\n";
+    PrintLatencies();
+    SlabCache::PrintAll();
+    if (!shares->IsEmpty()) {
+	PrintShares();
+    }
+    PrintLocks();
+    PrintThreads();
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintLatencies
+// 	Print a summary of each histogram that has anything in it.  The
+//	median and 99th percentile are only known to within a bucket, so
+//	what is printed is the top of the bucket.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintLatencies()
+{
+    bool header = FALSE;
+
+    for (int i = 0; i < NumHistograms; i++) {
+	Histogram *h = &(this->*histograms[i]);
+
+	if (h->count == 0) {
+	    continue;
+	}
+	if (!header) {
+	    cout << "Latencies: (name, count, mean, median <=, 99% <=, max)\n";
+	    header = TRUE;
+	}
+	cout << "    " << h->name << ", " << h->count << ", "
+	     << (h->sum / h->count) << ", " << h->Percentile(50) << ", "
+	     << h->Percentile(99) << ", " << h->max << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintShares
+// 	Print the share of the CPU each thread that had tickets asked
+//	for, and the share it got, as percentages of those threads' total.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintShares()
+{
+    ListIterator<ShareRecord *> *iter;
+    long long allTickets = 0, allTicks = 0;
+
+    iter = new ListIterator<ShareRecord *>(shares);
+    for (; !iter->IsDone(); iter->Next()) {
+	allTickets += iter->Item()->tickets;
+	allTicks += iter->Item()->ticks;
+    }
+    delete iter;
+
+    cout << "CPU shares: (name, tickets, ticks, wanted %, got %)\n";
+    iter = new ListIterator<ShareRecord *>(shares);
+    for (; !iter->IsDone(); iter->Next()) {
+	ShareRecord *record = iter->Item();
+
+	cout << "    " << record->name << ", " << record->tickets << ", "
+	     << record->ticks << ", "
+	     << (100.0 * record->tickets / allTickets) << ", "
+	     << (allTicks == 0 ? 0.0 : 100.0 * record->ticks / allTicks)
+	     << "\n";
+    }
+    delete iter;
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintLocks
+// 	Print the LockReportSize locks that threads most often had to
+//	wait for, most contended first.
+//----------------------------------------------------------------------
+
+static int
+MoreContended(LockRecord *x, LockRecord *y)
+{
+    return (y->contended > x->contended) - (y->contended < x->contended);
+}
+
+void
+Statistics::PrintLocks()
+{
+    SortedList<LockRecord *> sorted(MoreContended);
+    ListIterator<LockRecord *> *iter;
+    int n;
+
+    iter = new ListIterator<LockRecord *>(locks);
+    for (; !iter->IsDone(); iter->Next()) {
+	if (iter->Item()->contended > 0) {
+	    sorted.Insert(iter->Item());
+	}
+    }
+    delete iter;
+    if (sorted.IsEmpty()) {
+	return;
+    }
+
+    cout << "Contended locks: (name, acquires, contended, wait ticks, "
+	 << "max wait, hold ticks)\n";
+    iter = new ListIterator<LockRecord *>(&sorted);
+    for (n = 0; !iter->IsDone() && n < LockReportSize; iter->Next(), n++) {
+	LockRecord *record = iter->Item();
+
+	cout << "    " << record->name << ", " << record->acquires << ", "
+	     << record->contended << ", " << record->waitTicks << ", "
+	     << record->maxWaitTicks << ", " << record->holdTicks << "\n";
+    }
+    delete iter;
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintThreads
+// 	Print the ThreadReportSize thread names that ran the longest,
+//	and what each program's processes did.
+//----------------------------------------------------------------------
+
+static int
+MoreCpu(ThreadRecord *x, ThreadRecord *y)
+{
+    return (y->cpuTicks > x->cpuTicks) - (y->cpuTicks < x->cpuTicks);
+}
+
+void
+Statistics::PrintThreads()
+{
+    SortedList<ThreadRecord *> sorted(MoreCpu);
+    int n;
+
+    if (!threads->IsEmpty()) {
+	ListIterator<ThreadRecord *> all(threads);
+
+	for (; !all.IsDone(); all.Next()) {
+	    sorted.Insert(all.Item());
+	}
+	cout << "Threads: (name, threads, cpu ticks, user ticks, ready ticks, "
+	     << "dispatches)\n";
+	ListIterator<ThreadRecord *> iter(&sorted);
+	for (n = 0; !iter.IsDone() && n < ThreadReportSize; iter.Next(), n++) {
+	    ThreadRecord *record = iter.Item();
+
+	    cout << "    " << record->name << ", " << record->threads << ", "
+		 << record->cpuTicks << ", " << record->userTicks << ", "
+		 << record->readyTicks << ", " << record->dispatches << "\n";
+	}
+    }
+    if (!spaces->IsEmpty()) {
+	ListIterator<SpaceRecord *> iter(spaces);
+
+	cout << "Programs: (name, processes, threads, cpu ticks, user ticks, "
+	     << "syscalls)\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    SpaceRecord *record = iter.Item();
+
+	    cout << "    " << record->name << ", " << record->processes
+		 << ", " << record->threads << ", " << record->cpuTicks
+		 << ", " << record->userTicks << ", " << record->syscalls
+		 << "\n";
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// WriteCsvString, WriteJsonString
+// 	Write "s" as a CSV field, or a JSON string, quoting what needs
+//	quoting.  NULL (a setting left at its default, say) is an empty
+//	field, or null.
+//----------------------------------------------------------------------
+
+void
+WriteCsvString(ostream &out, char *s)
+{
+    if (s == NULL) {
+	return;
+    }
+    if (strpbrk(s, ",\"\n") == NULL) {
+	out << s;
+	return;
+    }
+    out << '"';
+    for (; *s != '\0'; s++) {
+	if (*s == '"') {
+	    out << '"';			// doubled, to quote it
+	}
+	out << *s;
+    }
+    out << '"';
+}
+
+void
+WriteJsonString(ostream &out, char *s)
+{
+    if (s == NULL) {
+	out << "null";
+	return;
+    }
+    out << '"';
+    for (; *s != '\0'; s++) {
+	if (*s == '"' || *s == '\\') {
+	    out << '\\' << *s;
+	} else if ((unsigned char) *s < ' ') {
+	    char escape[8];
+
+	    sprintf(escape, "\\u%04x", *s);
+	    out << escape;
+	} else {
+	    out << *s;
+	}
+    }
+    out << '"';
+}
+
+//----------------------------------------------------------------------
+// Statistics::WriteJson
+// 	Write all the statistics as one JSON object: the counters; the
+//	histograms, each with the buckets that have anything in them;
+//	and the records of threads, programs, locks and CPU shares.
+//----------------------------------------------------------------------
+
+void
+Statistics::WriteJson(ostream &out)
+{
+    char *separator;
+
+    out << "{\n  \"counters\": ";
+    for (int f = 0; f < NumFields(); f++) {
+	out << (f == 0 ? "{" : ", ") << "\"" << FieldName(f) << "\": "
+	    << Field(f);
+    }
+    out << "},\n  \"histograms\": {";
+    for (int i = 0; i < NumHistograms; i++) {
+	Histogram *h = &(this->*histograms[i]);
+
+	out << (i == 0 ? "\n" : ",\n") << "    \"" << h->name
+	    << "\": {\"count\": " << h->count << ", \"sum\": " << h->sum
+	    << ", \"min\": " << h->min << ", \"max\": " << h->max
+	    << ", \"buckets\": [";
+	separator = "";
+	for (int b = 0; b < HistogramBuckets; b++) {
+	    if (h->buckets[b] > 0) {
+		out << separator << "{\"low\": " << Histogram::BucketLow(b)
+		    << ", \"high\": " << Histogram::BucketHigh(b)
+		    << ", \"count\": " << h->buckets[b] << "}";
+		separator = ", ";
+	    }
+	}
+	out << "]}";
+    }
+
+    out << "\n  },\n  \"threads\": [";
+    separator = "\n";
+    ListIterator<ThreadRecord *> thread(threads);
+    for (; !thread.IsDone(); thread.Next(), separator = ",\n") {
+	ThreadRecord *r = thread.Item();
+
+	out << separator << "    {\"name\": ";
+	WriteJsonString(out, r->name);
+	out << ", \"threads\": " << r->threads << ", \"cpuTicks\": "
+	    << r->cpuTicks << ", \"userTicks\": " << r->userTicks
+	    << ", \"readyTicks\": " << r->readyTicks << ", \"dispatches\": "
+	    << r->dispatches << "}";
+    }
+
+    out << "\n  ],\n  \"programs\": [";
+    separator = "\n";
+    ListIterator<SpaceRecord *> space(spaces);
+    for (; !space.IsDone(); space.Next(), separator = ",\n") {
+	SpaceRecord *r = space.Item();
+
+	out << separator << "    {\"name\": ";
+	WriteJsonString(out, r->name);
+	out << ", \"processes\": " << r->processes << ", \"threads\": "
+	    << r->threads << ", \"cpuTicks\": " << r->cpuTicks
+	    << ", \"userTicks\": " << r->userTicks << ", \"syscalls\": "
+	    << r->syscalls << "}";
+    }
+
+    out << "\n  ],\n  \"locks\": [";
+    separator = "\n";
+    ListIterator<LockRecord *> lock(locks);
+    for (; !lock.IsDone(); lock.Next(), separator = ",\n") {
+	LockRecord *r = lock.Item();
+
+	out << separator << "    {\"name\": ";
+	WriteJsonString(out, r->name);
+	out << ", \"acquires\": " << r->acquires << ", \"contended\": "
+	    << r->contended << ", \"waitTicks\": " << r->waitTicks
+	    << ", \"maxWaitTicks\": " << r->maxWaitTicks
+	    << ", \"holdTicks\": " << r->holdTicks << "}";
+    }
+
+    out << "\n  ],\n  \"shares\": [";
+    separator = "\n";
+    ListIterator<ShareRecord *> share(shares);
+    for (; !share.IsDone(); share.Next(), separator = ",\n") {
+	ShareRecord *r = share.Item();
+
+	out << separator << "    {\"name\": ";
+	WriteJsonString(out, r->name);
+	out << ", \"tickets\": " << r->tickets << ", \"ticks\": "
+	    << r->ticks << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+//----------------------------------------------------------------------
+// Statistics::WriteCsv
+// 	Write the same statistics as WriteJson, as CSV with one value to
+//	a line: what kind of statistic it is, which one (for histograms
+//	and records), the field, and the value.  Histogram buckets are
+//	fields named for the top of the bucket ("le1023", say), for the
+//	buckets that have anything in them.
+//----------------------------------------------------------------------
+
+void
+Statistics::WriteCsv(ostream &out)
+{
+
+    out << "kind,name,field,value\n";
+    for (int f = 0; f < NumFields(); f++) {
+	out << "counter,," << FieldName(f) << "," << Field(f) << "\n";
+    }
+    for (int i = 0; i < NumHistograms; i++) {
+	Histogram *h = &(this->*histograms[i]);
+	char *name = h->name;
+
+	out << "histogram," << name << ",count," << h->count << "\n";
+	out << "histogram," << name << ",sum," << h->sum << "\n";
+	out << "histogram," << name << ",min," << h->min << "\n";
+	out << "histogram," << name << ",max," << h->max << "\n";
+	for (int b = 0; b < HistogramBuckets; b++) {
+	    if (h->buckets[b] > 0) {
+		out << "histogram," << name << ",le"
+		    << Histogram::BucketHigh(b) << "," << h->buckets[b] << "\n";
+	    }
+	}
+    }
+
+    ListIterator<ThreadRecord *> thread(threads);
+    for (; !thread.IsDone(); thread.Next()) {
+	ThreadRecord *r = thread.Item();
+	char *fieldNames[] = { "threads", "cpuTicks", "userTicks",
+			       "readyTicks", "dispatches" };
+	long long values[] = { r->threads, r->cpuTicks, r->userTicks,
+			       r->readyTicks, r->dispatches };
+
+	for (int f = 0; f < 5; f++) {
+	    out << "thread,";
+	    WriteCsvString(out, r->name);
+	    out << "," << fieldNames[f] << "," << values[f] << "\n";
+	}
+    }
+    ListIterator<SpaceRecord *> space(spaces);
+    for (; !space.IsDone(); space.Next()) {
+	SpaceRecord *r = space.Item();
+	char *fieldNames[] = { "processes", "threads", "cpuTicks",
+			       "userTicks", "syscalls" };
+	long long values[] = { r->processes, r->threads, r->cpuTicks,
+			       r->userTicks, r->syscalls };
+
+	for (int f = 0; f < 5; f++) {
+	    out << "program,";
+	    WriteCsvString(out, r->name);
+	    out << "," << fieldNames[f] << "," << values[f] << "\n";
+	}
+    }
+    ListIterator<LockRecord *> lock(locks);
+    for (; !lock.IsDone(); lock.Next()) {
+	LockRecord *r = lock.Item();
+	char *fieldNames[] = { "acquires", "contended", "waitTicks",
+			       "maxWaitTicks", "holdTicks" };
+	long long values[] = { r->acquires, r->contended, r->waitTicks,
+			       r->maxWaitTicks, r->holdTicks };
+
+	for (int f = 0; f < 5; f++) {
+	    out << "lock,";
+	    WriteCsvString(out, r->name);
+	    out << "," << fieldNames[f] << "," << values[f] << "\n";
+	}
+    }
+    ListIterator<ShareRecord *> share(shares);
+    for (; !share.IsDone(); share.Next()) {
+	ShareRecord *r = share.Item();
+
+	out << "share,";
+	WriteCsvString(out, r->name);
+	out << ",tickets," << r->tickets << "\n";
+	out << "share,";
+	WriteCsvString(out, r->name);
+	out << ",ticks," << r->ticks << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::Dump
+// 	Write all the statistics to the host file "fileName": as JSON,
+//	if its name ends in ".json", otherwise as CSV.  The file is
+//	written in full each time, so a program watching it sees the
+//	latest statistics.
+//----------------------------------------------------------------------
+
+void
+Statistics::Dump(char *fileName)
+{
+    ofstream out(fileName);
+    int length = strlen(fileName);
+
+    if (!out) {
+	cerr << "Unable to write statistics to " << fileName << "\n";
+	return;
+    }
+    if (length > 5 && strcmp(fileName + length - 5, ".json") == 0) {
+	WriteJson(out);
+    } else {
+	WriteCsv(out);
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::DumpOnSignal
+// 	Dump the statistics to "fileName" each time the host sends us
+//	SIGUSR1, so that a long run can be looked at while it goes.
+//
+//	The handler only notes that a dump was asked for; the dump itself
+//	is done at the next tick (see Interrupt::OneTick), when the
+//	statistics are not half way through being updated.  A machine
+//	that is idle, waiting for input from the host, does the dump
+//	when the input comes in.
+//----------------------------------------------------------------------
+
+void
+Statistics::DumpOnSignal(char *fileName)
+{
+    dumpFile = fileName;
+    RegisterSignalHandler(AskForDump, SIGUSR1);
+}
+
+void
+Statistics::AskForDump(int sig)
+{
+    dumpAsked = 1;
+}
+
+void
+Statistics::DumpAsked()
+{
+    dumpAsked = 0;
+    if (dumpFile != NULL) {
+	DEBUG(dbgInt, "Dumping statistics to " << dumpFile);
+	Dump(dumpFile);
+    }
 }
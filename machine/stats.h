@@ -12,35 +12,189 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "list.h"
+#include "sysdep.h"
+#include <signal.h>
+
+// CPU time used by a thread that had a share of the CPU set.
+
+class ShareRecord {
+  public:
+    char *name;			// the thread's name (a copy)
+    int tickets;		// its share
+    long long ticks;		// what it got
+};
+
+// Contention on the locks with one name (see Lock::Acquire).  All the
+// locks with the same name share a record.
+
+class LockRecord {
+  public:
+    char *name;			// the locks' name (a copy)
+    long long acquires;		// # of times acquired
+    long long contended;	// # of those that had to wait
+    long long waitTicks;	// total time spent waiting
+    long long maxWaitTicks;	// longest wait
+    long long holdTicks;	// total time held
+};
+
+// What the threads with one name did, between them, by the time they
+// finished (see Scheduler::ReportThread).
+
+class ThreadRecord {
+  public:
+    char *name;			// the threads' name (a copy)
+    long long threads;		// # of them
+    long long cpuTicks;		// time they spent running
+    long long userTicks;	// of that, time running user code
+    long long readyTicks;	// time they spent waiting for a CPU
+    long long dispatches;	// # of times they were switched to
+};
+
+// What the processes running one program did (see AddrSpace::Load,
+// Scheduler::ReportThread).
+
+class SpaceRecord {
+  public:
+    char *name;			// the program (a copy)
+    long long processes;	// # of address spaces it was loaded into
+    long long threads;		// # of their threads that finished
+    long long cpuTicks;		// time those threads spent running
+    long long userTicks;	// of that, time running user code
+    long long syscalls;		// # of system calls they made
+};
+
+const int LockReportSize = 5;	// # of locks to print at halt
+const int ThreadReportSize = 5;	// # of thread names to print at halt
+
+// The distribution of some latency, in ticks.  Bucket 0 counts the
+// zeroes; bucket i (i > 0) the values from 2^(i-1) up to 2^i - 1; the
+// last bucket, everything bigger than that as well.
+
+const int HistogramBuckets = 32;
+
+class Histogram {
+  public:
+    Histogram(char *histName);	// start empty
+
+    void Record(long long value);	// count one more value
+    long long Percentile(int p);	// upper end of the bucket holding
+					// the "p"th percentile
+
+    char *name;			// what is being measured
+    long long count;		// # of values
+    long long sum;		// their total
+    long long min, max;		// the smallest and the biggest
+    long long buckets[HistogramBuckets];	// # of values in each bucket
+
+    static long long BucketLow(int i);	// smallest value in bucket "i"
+    static long long BucketHigh(int i);	// biggest value in bucket "i"
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
 //
 // The fields in this class are public to make it easier to update.
+// They are 64 bits, so that a long run can not overflow them.
 
 class Statistics {
   public:
-    int totalTicks;      	// Total time running Nachos
-    int idleTicks;       	// Time spent idle (no threads to run)
-    int systemTicks;	 	// Time spent executing system code
-    int userTicks;       	// Time spent executing user code
+    long long totalTicks;      	// Total time running Nachos
+    long long idleTicks;       	// Time spent idle (no threads to run)
+    long long systemTicks;	// Time spent executing system code
+    long long userTicks;       	// Time spent executing user code
 				// (this is also equal to # of
 				// user instructions executed)
 
-    int numDiskReads;		// number of disk read requests
-    int numDiskWrites;		// number of disk write requests
-    int numConsoleCharsRead;	// number of characters read from the keyboard
-    int numConsoleCharsWritten; // number of characters written to the display
-    int numPageFaults;		// number of virtual memory page faults
-    int numPacketsSent;		// number of packets sent over the network
-    int numPacketsRecvd;	// number of packets received over the network
+    long long numDiskReads;	// number of disk read requests
+    long long numDiskWrites;	// number of disk write requests
+    long long numConsoleCharsRead;	// number of characters read from the keyboard
+    long long numConsoleCharsWritten;	// number of characters written to the display
+    long long numPageFaults;	// number of virtual memory page faults
+    long long numPacketsSent;	// number of packets sent over the network
+    long long numPacketsRecvd;	// number of packets received over the network
+    long long numTimerInterrupts;	// number of timer interrupts
+    long long numWastedTimerInterrupts;
+				// number of those that neither woke up
+				// a thread nor switched threads
+
+    // How long things took, from start to finish
+
+    Histogram diskLatency;	// a disk request, including waiting
+				// for the disk (see SynchDisk)
+    Histogram consoleReadLatency;	// a character, from coming in to
+				// being read (see ConsoleInput)
+    Histogram consoleWriteLatency;	// a character, from being written
+				// to reaching the display, including
+				// waiting (see SynchConsoleOutput)
+    Histogram packetRecvLatency;	// a packet, from coming in to being
+				// received (see NetworkInput)
+    Histogram packetSendLatency;	// a packet, from being sent to being
+				// on the wire, including waiting (see
+				// PostOfficeOutput)
+    Histogram dispatchLatency;	// a thread, from being ready to run to
+				// being switched to (see Scheduler)
 
     Statistics(); 		// initialize everything to zero
+    ~Statistics();
 
+    void RecordShare(char *name, int tickets, long long ticks);
+				// a thread with "tickets" finished, having
+				// run for "ticks"
+    LockRecord *FindLock(char *name);
+				// the record for locks called "name"
+    ThreadRecord *FindThread(char *name);
+				// the record for threads called "name"
+    SpaceRecord *FindSpace(char *name);
+				// the record for processes running "name"
     void Print();		// print collected statistics
+
+    // The counters above, by number, so that they can be written out
+    // and read back in a table (see batch.h), or saved in a snapshot
+    // (see snapshot.h).
+    static int NumFields();	// # of counters
+    static char *FieldName(int i);	// name of counter "i"
+    long long Field(int i);	// value of counter "i"
+    void SetField(int i, long long value);	// change counter "i"
+    void Save(char *fileName);	// write the counters to "fileName",
+				// on one line, separated by commas
+
+    // Everything above -- counters, histograms, and records -- for
+    // another program to read.
+    void WriteJson(ostream &out);	// as one JSON object
+    void WriteCsv(ostream &out);	// as CSV, one value to a line
+    void Dump(char *fileName);	// to "fileName": as JSON if it ends
+				// in ".json", otherwise as CSV
+    void DumpOnSignal(char *fileName);	// Dump whenever the host sends
+				// SIGUSR1 (and once more at Halt)
+    void CheckSignal() { if (dumpAsked) { DumpAsked(); } }
+				// called every tick: has SIGUSR1 come in?
+
+  private:
+    List<ShareRecord *> *shares;	// threads that have called RecordShare
+
+    void PrintShares();		// print the CPU shares threads got
+    List<LockRecord *> *locks;	// records returned by FindLock
+    void PrintLocks();		// print the most contended locks
+    List<ThreadRecord *> *threads;	// records returned by FindThread
+    List<SpaceRecord *> *spaces;	// records returned by FindSpace
+    void PrintThreads();	// print the busiest threads, and each
+				// program's processes
+    void PrintLatencies();	// summarize the histograms
+
+    char *dumpFile;		// where DumpOnSignal dumps to
+    static volatile sig_atomic_t dumpAsked;	// set by the signal handler
+    static void AskForDump(int sig);	// the handler
+    void DumpAsked();		// do the dump it asked for
 };
 
+// Write "s" as a CSV field, or a JSON string, quoting what needs quoting.
+// NULL is an empty field, or null.
+
+extern void WriteCsvString(ostream &out, char *s);
+extern void WriteJsonString(ostream &out, char *s);
+
 // Constants used to reflect the relative time an operation would
 // take in a real system.  A "tick" is a just a unit of time -- if you 
 // like, a microsecond.
@@ -33,14 +33,19 @@
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
 //      "toCall" is the interrupt handler to call when the timer expires.
+//	"isPeriodic" -- if false, only interrupt when asked to.
 //----------------------------------------------------------------------
 
-Timer::Timer(bool doRandom, CallBackObj *toCall)
+Timer::Timer(bool doRandom, CallBackObj *toCall, bool isPeriodic)
 {
     randomize = doRandom;
     callPeriodically = toCall;
     disable = FALSE;
-    SetInterrupt();
+    periodic = isPeriodic;
+    pending = NULL;
+    if (periodic) {
+	Tick();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -52,30 +57,66 @@ Timer::Timer(bool doRandom, CallBackObj *toCall)
 void 
 Timer::CallBack() 
 {
+    pending = NULL;		// this was it
+
     // invoke the Nachos interrupt handler for this device
     callPeriodically->CallBack();
     
-    SetInterrupt();	// do last, to let software interrupt handler
+    if (periodic) {
+	Tick();		// do last, to let software interrupt handler
     			// decide if it wants to disable future interrupts
+    }
 }
 
 //----------------------------------------------------------------------
-// Timer::SetInterrupt
+// Timer::Tick
 //      Cause a timer interrupt to occur in the future, unless
 //	future interrupts have been disabled.  The delay is either
 //	fixed or random.
 //----------------------------------------------------------------------
 
 void
-Timer::SetInterrupt() 
+Timer::Tick() 
 {
-    if (!disable) {
-       int delay = TimerTicks;
+    int delay = TimerTicks;
     
-       if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
-        }
-       // schedule the next timer device interrupt
-       kernel->interrupt->Schedule(this, delay, TimerInt);
+    if (randomize) {
+	delay = 1 + (RandomNumber() % (TimerTicks * 2));
+    }
+    Arm(delay);
+}
+
+//----------------------------------------------------------------------
+// Timer::Arm
+//      Make sure a timer interrupt occurs within "delay" ticks from
+//	now (unless future interrupts have been disabled).  If one is
+//	already due by then, there is nothing to do; if one is due later,
+//	it is moved up.
+//----------------------------------------------------------------------
+
+void
+Timer::Arm(int delay)
+{
+    if (disable) {
+	return;
+    }
+    if (pending == NULL) {	// schedule the next timer device interrupt
+	pending = kernel->interrupt->Schedule(this, delay, TimerInt);
+    } else if (pending->when > kernel->stats->totalTicks + delay) {
+	kernel->interrupt->Reschedule(pending, delay);
+    }
+}
+
+//----------------------------------------------------------------------
+// Timer::Disarm
+//      Call off the next timer interrupt, if there is one.
+//----------------------------------------------------------------------
+
+void
+Timer::Disarm()
+{
+    if (pending != NULL) {
+	kernel->interrupt->Cancel(pending);
+	pending = NULL;
     }
 }
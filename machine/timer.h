@@ -11,6 +11,11 @@
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	If "periodic" is not set, the timer does not interrupt on its own:
+//	software must ask for each interrupt, with Tick (for the next time
+//	slice) or Arm (for a given time), and can call it off with Disarm.
+//	Either way, the timer never has more than one interrupt pending.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -24,30 +29,34 @@
 #include "utility.h"
 #include "callback.h"
 
+class PendingInterrupt;
+
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
   public:
-    Timer(bool doRandom, CallBackObj *toCall);
+    Timer(bool doRandom, CallBackObj *toCall, bool periodic = TRUE);
 				// Initialize the timer, and callback to "toCall"
-				// every time slice.
+				// every time slice (or when asked to).
     virtual ~Timer() {}
     
     void Disable() { disable = TRUE; }
     				// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Tick();		// Interrupt after a time slice (fixed
+				// or random), if not sooner
+    void Arm(int delay);	// Interrupt within "delay" ticks
+    void Disarm();		// Cancel the next interrupt, if any
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
     CallBackObj *callPeriodically; // call this every TimerTicks time units 
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    bool periodic;		// interrupt every time slice, unasked
+    PendingInterrupt *pending;	// the next interrupt, or NULL
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
-
-    void SetInterrupt();  	// cause an interrupt to occur in the
-    				// the future after a fixed or random
-				// delay
 };
 
 #endif // TIMER_H
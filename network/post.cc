@@ -18,6 +18,27 @@
 
 #include "copyright.h"
 #include "post.h"
+#include "slab.h"
+
+//----------------------------------------------------------------------
+// Mail::operator new, operator delete
+// 	A message is allocated for every packet the post office
+//	receives, and freed once it has been delivered.
+//----------------------------------------------------------------------
+
+static SlabCache mailSlab("Mail", sizeof(Mail));
+
+void *
+Mail::operator new(size_t size)
+{
+    return mailSlab.Alloc(size);
+}
+
+void
+Mail::operator delete(void *p, size_t size)
+{
+    mailSlab.Free(p, size);
+}
 
 //----------------------------------------------------------------------
 // Mail::Mail
@@ -301,6 +322,7 @@ PostOfficeOutput::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
     char* buffer = new char[MaxPacketSize];	// space to hold concatenated
 						// mailHdr + data
+    long long start;
 
     if (debug->IsEnabled('n')) {
 	cout << "Post send: ";
@@ -317,12 +339,15 @@ PostOfficeOutput::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
     bcopy((char *)&mailHdr, buffer, sizeof(MailHeader));
     bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
+    start = kernel->stats->totalTicks;
     sendLock->Acquire();   		// only one message can be sent
 					// to the network at any one time
     network->Send(pktHdr, buffer);
     messageSent->P();			// wait for interrupt to tell us
 					// ok to send the next message
     sendLock->Release();
+    kernel->stats->packetSendLatency.Record(
+				kernel->stats->totalTicks - start);
 
     delete [] buffer;			// we've sent the message, so
 					// we can delete our buffer
@@ -71,6 +71,9 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     void *operator new(size_t size);	// messages come from a slab cache
+     void operator delete(void *p, size_t size);
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -0,0 +1,39 @@
+/* bchase.c 
+ *    Benchmark: chase pointers around a permutation, SCALE times.
+ *
+ *    Each load depends on the one before, and they jump all over
+ *    several pages, so this measures address translation rather than
+ *    arithmetic.
+ */
+
+#include "syscall.h"
+
+#ifndef SCALE
+#define SCALE	10	/* # of times around the permutation */
+#endif
+
+#define SIZE	2048	/* a power of two */
+#define STRIDE	1031	/* odd, so stepping by it visits every slot */
+
+int next[SIZE];
+
+int
+main()
+{
+    int i, p, round, steps = 0;
+
+    for (i = 0; i < SIZE; i++)		/* one cycle through every slot */
+	next[i] = (i + STRIDE) & (SIZE - 1);
+
+    for (round = 0; round < SCALE; round++) {
+	p = 0;
+	do {
+	    p = next[p];
+	    steps++;
+	} while (p != 0);
+    }
+
+    if (steps != SCALE * SIZE)
+	Exit(1);
+    Exit(0);
+}
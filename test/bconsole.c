@@ -0,0 +1,26 @@
+/* bconsole.c 
+ *    Benchmark: write to the console a character at a time.
+ *
+ *    Every character is a system call of its own, and a trip through
+ *    the console output path.
+ */
+
+#include "syscall.h"
+
+#ifndef SCALE
+#define SCALE	10	/* hundreds of lines to write */
+#endif
+
+char line[] = "the quick brown fox jumps over the lazy dog\n";
+
+int
+main()
+{
+    int i, j;
+
+    for (i = 0; i < SCALE * 100; i++)
+	for (j = 0; line[j] != '\0'; j++)
+	    if (Write(&line[j], 1, ConsoleOutput) != 1)
+		Exit(1);
+    Exit(0);
+}
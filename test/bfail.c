@@ -0,0 +1,15 @@
+/* bfail.c 
+ *    Not a benchmark: a program that always gets the wrong answer.
+ *
+ *    "make bench-check" runs it as a batch job, to make sure that a
+ *    benchmark failing its own check (by calling Exit(1)) is counted
+ *    as failed, rather than timed as if it had worked.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    Exit(1);
+}
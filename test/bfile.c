@@ -0,0 +1,30 @@
+/* bfile.c 
+ *    Benchmark: copy a file, a block at a time.
+ *
+ *    There are no Create or Open calls, so the file copied is the
+ *    one given as ConsoleInput (see bench.manifest), and the copy
+ *    goes to ConsoleOutput; each block is a Read and a Write that go
+ *    through the kernel's file table to the host.
+ */
+
+#include "syscall.h"
+
+#define BlockSize	128
+
+char buffer[BlockSize];
+
+int
+main()
+{
+    int n, total = 0;
+
+    while ((n = Read(buffer, BlockSize, ConsoleInput)) > 0) {
+	if (Write(buffer, n, ConsoleOutput) != n)
+	    Exit(1);
+	total += n;
+    }
+
+    if (n < 0 || total == 0)
+	Exit(1);
+    Exit(0);
+}
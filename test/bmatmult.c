@@ -0,0 +1,44 @@
+/* bmatmult.c 
+ *    Benchmark: matrix multiplication, repeated SCALE times.
+ *
+ *    Mostly arithmetic and array indexing -- a measure of how fast
+ *    the simulator runs plain user instructions.  The matrices are
+ *    small enough to stay in physical memory.
+ */
+
+#include "syscall.h"
+
+#ifndef SCALE
+#define SCALE	10	/* # of times to multiply */
+#endif
+
+#define Dim 	16
+
+int A[Dim][Dim];
+int B[Dim][Dim];
+int C[Dim][Dim];
+
+int
+main()
+{
+    int i, j, k, round;
+
+    for (i = 0; i < Dim; i++)		/* first initialize the matrices */
+	for (j = 0; j < Dim; j++) {
+	     A[i][j] = i;
+	     B[i][j] = j;
+	}
+
+    for (round = 0; round < SCALE; round++) {
+	for (i = 0; i < Dim; i++)	/* then multiply them together */
+	    for (j = 0; j < Dim; j++) {
+		C[i][j] = 0;
+		for (k = 0; k < Dim; k++)
+		    C[i][j] += A[i][k] * B[k][j];
+	    }
+    }
+
+    if (C[Dim-1][Dim-1] != Dim * (Dim-1) * (Dim-1))
+	Exit(1);
+    Exit(0);
+}
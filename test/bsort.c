@@ -0,0 +1,39 @@
+/* bsort.c 
+ *    Benchmark: bubble sort an array in reverse order, SCALE times.
+ *
+ *    Mostly loads, stores and branches over a few pages of data.
+ */
+
+#include "syscall.h"
+
+#ifndef SCALE
+#define SCALE	10	/* # of times to sort */
+#endif
+
+#define SIZE	512
+
+int A[SIZE];
+
+int
+main()
+{
+    int i, j, tmp, round;
+
+    for (round = 0; round < SCALE; round++) {
+	for (i = 0; i < SIZE; i++)	/* reverse sorted order */
+	    A[i] = (SIZE-1) - i;
+
+	for (i = 0; i < SIZE; i++)
+	    for (j = 0; j < (SIZE-1) - i; j++)
+		if (A[j] > A[j + 1]) {	/* out of order -> swap */
+		    tmp = A[j];
+		    A[j] = A[j + 1];
+		    A[j + 1] = tmp;
+		}
+    }
+
+    for (i = 0; i < SIZE; i++)
+	if (A[i] != i)
+	    Exit(1);
+    Exit(0);
+}
@@ -0,0 +1,29 @@
+/* bsyscall.c 
+ *    Benchmark: a storm of system calls that do next to nothing.
+ *
+ *    Measures the cost of getting into the kernel and back out --
+ *    the exception, decoding the call, and advancing the PC.
+ */
+
+#include "syscall.h"
+
+#ifndef SCALE
+#define SCALE	10	/* thousands of calls to make */
+#endif
+
+int
+main()
+{
+    int i, sum = 0;
+    SpaceId me = getSpaceID();
+
+    for (i = 0; i < SCALE * 1000; i++) {
+	sum = Add(sum, 1);
+	if (getSpaceID() != me)
+	    Exit(1);
+    }
+
+    if (sum != SCALE * 1000)
+	Exit(1);
+    Exit(0);
+}
@@ -1,11 +1,27 @@
 #include "syscall.h"
 
+/* Run "cmd" with the given console; return its SpaceId */
+static SpaceId Run(char *cmd, OpenFileId input, OpenFileId output)
+{
+    char *end;
+
+    while (*cmd == ' ')
+        cmd++;
+    for (end = cmd; *end != '\0'; end++)
+        ;
+    while (end > cmd && end[-1] == ' ')
+        *--end = '\0';
+    return ExecIO(cmd, input, output);
+}
+
 int main()
 {
-    SpaceId newProc;
+    SpaceId newProc, producer;
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
+    OpenFileId fds[2];
     char prompt[2], ch = '\n', buffer[60];
+    char *bar;
     int i;
     //for(i=0;i<60;++i)buffer[i]=0;
     prompt[0] = '-';
@@ -25,6 +41,21 @@ int main()
             buffer[i] = '\0';
             if (!Strncmp(buffer, "exit", 4))
                 Halt();
+
+            /* "a | b" runs a and b, with the output of a going to b */
+            for (bar = buffer; *bar != '\0' && *bar != '|'; bar++)
+                ;
+            if (*bar == '|' && Pipe(fds) == 0)
+            {
+                *bar = '\0';
+                producer = Run(buffer, input, fds[1]);
+                newProc = Run(bar + 1, fds[0], output);
+                Close(fds[0]);
+                Close(fds[1]);
+                Join(producer);
+                Join(newProc);
+                continue;
+            }
             newProc = Exec(buffer);
             Join(newProc);
         }
@@ -146,6 +146,62 @@ Close:
 	j	$31
 	.end Close
 
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl ExecIO
+	.ent	ExecIO
+ExecIO:
+	addiu $2,$0,SC_ExecIO
+	syscall
+	j	$31
+	.end ExecIO
+
+	.globl IoSetup
+	.ent	IoSetup
+IoSetup:
+	addiu $2,$0,SC_IoSetup
+	syscall
+	j	$31
+	.end IoSetup
+
+	.globl IoSubmit
+	.ent	IoSubmit
+IoSubmit:
+	addiu $2,$0,SC_IoSubmit
+	syscall
+	j	$31
+	.end IoSubmit
+
+	.globl IoWait
+	.ent	IoWait
+IoWait:
+	addiu $2,$0,SC_IoWait
+	syscall
+	j	$31
+	.end IoWait
+
+	.globl SetTickets
+	.ent	SetTickets
+SetTickets:
+	addiu $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end SetTickets
+
+	.globl Sleep
+	.ent	Sleep
+Sleep:
+	addiu $2,$0,SC_Sleep
+	syscall
+	j	$31
+	.end Sleep
+
 	.globl Seek
 	.ent	Seek
 Seek:
@@ -166,10 +222,18 @@ Delete:
         .ent    ThreadFork
 ThreadFork:
         addiu $2,$0,SC_ThreadFork
+        la      $5,__ThreadReturn	/* where "func" returns to */
         syscall
         j       $31
         .end ThreadFork
 
+/* a forked thread whose function returns ends up here */
+        .ent    __ThreadReturn
+__ThreadReturn:
+        move    $4,$0
+        jal     ThreadExit	 /* ThreadExit(0) */
+        .end __ThreadReturn
+
         .globl ThreadYield
         .ent    ThreadYield
 ThreadYield:
@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and putting threads to
+//	sleep for a while.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -11,6 +10,8 @@
 #include "copyright.h"
 #include "alarm.h"
 #include "main.h"
+#include "synch.h"
+#include "sysdep.h"
 
 //----------------------------------------------------------------------
 // Alarm::Alarm
@@ -18,11 +19,14 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"periodic" -- if true, interrupt every time slice, whether or
+//		not there is anything to do.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+Alarm::Alarm(bool doRandom, bool periodic)
 {
-    timer = new Timer(doRandom, this);
+    tickless = !periodic;
+    timer = new Timer(doRandom, this, periodic);
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +43,12 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	First, wake up the threads whose time has come.  Then time
+//	slice: only need to time slice if we're currently running
+//	something (in other words, not idle), and then only if the
+//	scheduling policy says so.  Any other CPUs time slice too.
+//	Finally, if tickless, ask for the next interrupt, if there will
+//	be anything for it to do.
 //----------------------------------------------------------------------
 
 void 
@@ -48,8 +56,126 @@ Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
-    
-    if (status != IdleMode) {
+    ThreadQueue expired;
+    bool wasted = TRUE;
+
+    kernel->stats->numTimerInterrupts++;
+    sleepers.Advance(kernel->stats->totalTicks / TimerTicks, &expired);
+    if (!expired.IsEmpty()) {
+	kernel->scheduler->ReadyToRunAll(&expired);
+	wasted = FALSE;
+    }
+    if (status != IdleMode && kernel->scheduler->Tick()) {
 	interrupt->YieldOnReturn();
+	wasted = wasted && kernel->scheduler->NumReady() == 0;
+    }
+    kernel->scheduler->TickOthers();	// (on a multiprocessor)
+    if (wasted) {
+	kernel->stats->numWastedTimerInterrupts++;
+    }
+    Reprogram();
+}
+
+//----------------------------------------------------------------------
+// Alarm::Reprogram
+// 	If tickless, make sure the timer will interrupt when we next need
+//	it: after a time slice, if there are threads waiting for the CPU;
+//	else at the next turn of the timer wheel, if any thread is
+//	sleeping; else not at all (so an interrupt that is already set
+//	is called off).
+//
+//	Called with interrupts disabled, whenever one of those might
+//	have changed for the sooner, or the last thread waiting for the
+//	CPU has got it.
+//----------------------------------------------------------------------
+
+void
+Alarm::Reprogram()
+{
+    long long next;
+
+    if (!tickless) {
+	return;
+    }
+    if (kernel->scheduler->NumReady() > 0) {
+	timer->Tick();
+    } else if ((next = sleepers.NextTurn()) != -1) {
+	timer->Arm((int) max(next * TimerTicks - kernel->stats->totalTicks, 1LL));
+    } else {
+	timer->Disarm();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep until the first timer interrupt
+//	after "x" ticks from now.
+//
+//	"x" -- how long to sleep, in ticks
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(x >= 0);
+    sleepers.Insert(currentThread,
+		    (kernel->stats->totalTicks + x) / TimerTicks + 1);
+    Reprogram();
+    currentThread->Sleep(FALSE);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::SelfTest
+// 	Put a lot of threads to sleep at once, for random times, and
+//	check that none of them wakes up early.  Report how late they
+//	were, on average (they have to wait for the next timer interrupt,
+//	and then for each other), and how much host time it all took.
+//----------------------------------------------------------------------
+
+static const int SleepTestThreads = 1000;
+static const int SleepTestMaxTicks = 200 * TimerTicks;
+
+static Semaphore *sleepTestDone;
+static int sleepTestLateness;
+
+static void
+SleepTestThread(void *arg)
+{
+    int ticks = (int) (long) arg;
+    long long wake = kernel->stats->totalTicks + ticks;
+
+    kernel->alarm->WaitUntil(ticks);
+    ASSERT(kernel->stats->totalTicks > wake);
+    sleepTestLateness += kernel->stats->totalTicks - wake;
+    sleepTestDone->V();
+}
+
+void
+Alarm::SelfTest()
+{
+    double start = HostMicroseconds();
+
+    sleepTestDone = new Semaphore("sleep test", 0);
+    sleepTestLateness = 0;
+    for (int i = 0; i < SleepTestThreads; i++) {
+	Thread *t = new Thread("sleeper");
+
+	t->Fork(SleepTestThread,
+		(void *) (long) (RandomNumber() % SleepTestMaxTicks));
     }
+    for (int i = 0; i < SleepTestThreads; i++) {
+	sleepTestDone->P();
+    }
+    ASSERT(sleepers.NumSleeping() == 0);
+    delete sleepTestDone;
+
+    cout << "Slept " << SleepTestThreads << " threads at once: mean "
+	 << "lateness " << sleepTestLateness / SleepTestThreads
+	 << " ticks, host time " << (int) (HostMicroseconds() - start)
+	 << " us\n";
 }
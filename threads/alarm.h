@@ -8,7 +8,15 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	Sleeping threads are kept on a timer wheel (see timerwheel.h),
+//	so a thread can only be woken at a timer interrupt: a thread
+//	sleeps until the first timer interrupt after its wakeup time.
+//
+//	Unless asked for a periodic timer, the alarm is "tickless": it
+//	only has the timer interrupt when there is something to do --
+//	time slicing, when some thread is waiting for the CPU, or waking
+//	up the next sleeping thread.  Otherwise the timer is left off, so
+//	that an idle machine with nothing pending can halt.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,19 +29,28 @@
 #include "utility.h"
 #include "callback.h"
 #include "timer.h"
+#include "timerwheel.h"
 
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
-				// to "toCall" every time slice.
+    Alarm(bool doRandomYield, bool periodic);
+				// Initialize the timer, and callback 
+				// to "toCall" every time slice (or only
+				// when needed, if not "periodic").
     ~Alarm() { delete timer; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
+    void Reprogram();		// Set the timer for the next interrupt
+				// we need, if any
+
+    void Print() { sleepers.Print(); }	// Print the sleeping threads
+    void SelfTest();		// put lots of threads to sleep at once
 
   private:
     Timer *timer;		// the hardware timer device
+    TimerWheel sleepers;	// threads in WaitUntil
+    bool tickless;		// only interrupt when there is work?
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
@@ -0,0 +1,825 @@
+// batch.cc
+//	Routines to run a batch of Nachos jobs, each in a host process
+//	of its own, and to gather up their statistics.
+//
+//	None of this runs inside a kernel: the runner only starts the
+//	jobs, and each job builds its kernel from scratch, as "main"
+//	always does.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "batch.h"
+#include "addrspace.h"
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <math.h>
+
+//----------------------------------------------------------------------
+// CopyString
+// 	Return a copy of "s", or NULL if it is "-" (leave the default).
+//----------------------------------------------------------------------
+
+static char *
+CopyString(const char *s)
+{
+    char *copy;
+
+    if (strcmp(s, "-") == 0) {
+	return NULL;
+    }
+    copy = new char[strlen(s) + 1];
+    strcpy(copy, s);
+    return copy;
+}
+
+//----------------------------------------------------------------------
+// JobFailed
+// 	Did "job" go wrong?  It failed if it exited with a non-zero
+//	status, or if it saved no statistics (it never got to halt).
+//----------------------------------------------------------------------
+
+static bool
+JobFailed(BatchJob *job)
+{
+    return job->status != 0 || job->fields == NULL;
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::BatchRunner
+// 	Pick out the batch flags from the command line, keep the rest to
+//	pass on to the jobs, and read the manifest.
+//
+//	"-B manifest" is the file listing the jobs
+//	"-bj #" is the most jobs to run at once (default: one per CPU)
+//	"-bo file" is where to write the results (default: stdout)
+//	"-br #" is the # of times to run each job (default: once)
+//	"-bs file" is where to write a summary of the runs of each job
+//	"-bb file" is a summary written earlier, to compare with
+//----------------------------------------------------------------------
+
+BatchRunner::BatchRunner(int argc, char **argv)
+{
+    manifest = NULL;
+    outputFile = NULL;
+    summaryFile = NULL;
+    baselineFile = NULL;
+    numRuns = 1;
+    numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    args = new char *[argc];
+    numArgs = 0;
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-B") == 0) {
+	    ASSERT(i + 1 < argc);
+	    manifest = argv[++i];
+	} else if (strcmp(argv[i], "-bj") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is int
+	    numWorkers = atoi(argv[++i]);
+	} else if (strcmp(argv[i], "-bo") == 0) {
+	    ASSERT(i + 1 < argc);
+	    outputFile = argv[++i];
+	} else if (strcmp(argv[i], "-br") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is int
+	    numRuns = atoi(argv[++i]);
+	    ASSERT(numRuns >= 1);
+	} else if (strcmp(argv[i], "-bs") == 0) {
+	    ASSERT(i + 1 < argc);
+	    summaryFile = argv[++i];
+	} else if (strcmp(argv[i], "-bb") == 0) {
+	    ASSERT(i + 1 < argc);
+	    baselineFile = argv[++i];
+	} else {
+	    args[numArgs++] = argv[i];
+	}
+    }
+    ASSERT(manifest != NULL);
+    if (numWorkers < 1) {
+	numWorkers = 1;
+    }
+    wallTime = 0;
+    ReadManifest();
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::~BatchRunner
+// 	De-allocate the jobs.
+//----------------------------------------------------------------------
+
+BatchRunner::~BatchRunner()
+{
+    for (int i = 0; i < numJobs; i++) {
+	delete [] jobs[i].program;
+	delete [] jobs[i].consoleIn;
+	delete [] jobs[i].memoryPages;
+	delete [] jobs[i].seed;
+	delete [] jobs[i].fields;
+    }
+    delete [] jobs;
+    delete [] args;
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::ReadManifest
+// 	Read the jobs from the manifest, one per line (see batch.h for
+//	the format).  Blank lines and comments are skipped.  Each line
+//	becomes "numRuns" jobs, one after another.
+//----------------------------------------------------------------------
+
+void
+BatchRunner::ReadManifest()
+{
+    ifstream in(manifest);
+    char line[1024];
+    int size = 16;
+
+    if (!in) {
+	cerr << "Unable to open batch manifest " << manifest << "\n";
+	Exit(1);
+    }
+    jobs = new BatchJob[size];
+    numJobs = numEntries = 0;
+    while (in.getline(line, sizeof(line))) {
+	char *words[4] = { NULL, NULL, NULL, NULL };
+	char *comment = strchr(line, '#');
+	int n = 0;
+
+	if (comment != NULL) {
+	    *comment = '\0';
+	}
+	for (char *word = strtok(line, " \t\r"); word != NULL && n < 4;
+		word = strtok(NULL, " \t\r")) {
+	    words[n++] = word;
+	}
+	if (n == 0) {
+	    continue;
+	}
+	if (strcmp(words[0], "-") == 0) {
+	    cerr << manifest << ": job " << (numEntries + 1)
+		 << " has no program\n";
+	    Exit(1);
+	}
+	for (int run = 0; run < numRuns; run++) {
+	    if (numJobs == size) {	// out of room: double the array
+		BatchJob *bigger = new BatchJob[2 * size];
+		for (int i = 0; i < numJobs; i++) {
+		    bigger[i] = jobs[i];
+		}
+		delete [] jobs;
+		jobs = bigger;
+		size *= 2;
+	    }
+	    BatchJob *job = &jobs[numJobs++];
+	    job->program = CopyString(words[0]);
+	    job->consoleIn = (n > 1) ? CopyString(words[1]) : NULL;
+	    job->memoryPages = (n > 2) ? CopyString(words[2]) : NULL;
+	    job->seed = (n > 3) ? CopyString(words[3]) : NULL;
+	    job->entry = numEntries;
+	    job->pid = 0;
+	    job->worker = -1;
+	    job->status = -1;
+	    job->wallTime = 0;
+	    job->fields = NULL;
+	}
+	numEntries++;
+    }
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::Run
+// 	Run all the jobs, at most "numWorkers" at a time, starting the
+//	next one whenever one finishes; then write out what they did.
+//
+//	"nachosMain" is what each job runs, in its own process, with a
+//	command line made up for it (it never returns).
+//
+//	Returns the # of jobs that failed, plus, when benchmarking, the
+//	# of jobs that got slower than the baseline.
+//----------------------------------------------------------------------
+
+int
+BatchRunner::Run(int (*nachosMain)(int argc, char **argv))
+{
+    bool *busy = new bool[numWorkers];
+    int next = 0, running = 0, failed = 0, slower = 0;
+    double start = HostMicroseconds();
+
+    for (int i = 0; i < numWorkers; i++) {
+	busy[i] = FALSE;
+    }
+    for (int i = 0; i < numJobs; i++) {
+	if (!AddrSpace::CacheProgram(jobs[i].program)) {
+	    cerr << "Unable to open file " << jobs[i].program << "\n";
+	    jobs[i].status = NoProgramStatus;	// not worth starting
+	}
+    }
+    while (next < numJobs || running > 0) {
+	if (next < numJobs && jobs[next].status == NoProgramStatus) {
+	    next++;
+	} else if (next < numJobs && running < numWorkers) {
+	    int worker = 0;
+
+	    while (busy[worker]) {
+		worker++;
+	    }
+	    busy[worker] = TRUE;
+	    Start(next++, worker, nachosMain);
+	    running++;
+	} else {
+	    int hostStatus, job;
+	    int pid = waitpid(-1, &hostStatus, 0);
+
+	    ASSERT(pid > 0);
+	    for (job = 0; job < numJobs && jobs[job].pid != pid; job++) {
+		continue;
+	    }
+	    ASSERT(job < numJobs);
+	    busy[jobs[job].worker] = FALSE;
+	    Finish(job, hostStatus);
+	    running--;
+	}
+    }
+    wallTime = HostMicroseconds() - start;
+    delete [] busy;
+
+    for (int i = 0; i < numJobs; i++) {
+	if (JobFailed(&jobs[i])) {
+	    failed++;
+	}
+    }
+    if (outputFile == NULL) {
+	WriteCsv(cout);
+    } else {
+	ofstream out(outputFile);
+	int length = strlen(outputFile);
+
+	if (!out) {
+	    cerr << "Unable to write " << outputFile << "\n";
+	    return numJobs;
+	}
+	if (length > 5 && strcmp(outputFile + length - 5, ".json") == 0) {
+	    WriteJson(out);
+	} else {
+	    WriteCsv(out);
+	}
+    }
+    if (numRuns > 1 || summaryFile != NULL || baselineFile != NULL) {
+	slower = Summarize();
+    }
+    cerr << "Batch: " << numJobs << " jobs, " << failed << " failed, ";
+    if (baselineFile != NULL) {
+	cerr << slower << " slower, ";
+    }
+    cerr << numWorkers << " workers, " << (wallTime / 1000000.0)
+	 << " seconds\n";
+    return failed + slower;
+}
+
+//----------------------------------------------------------------------
+// JobFile
+// 	Put the name of a file job "job" leaves behind in "name": the
+//	manifest's name, then the job # (from 1), then "suffix".
+//----------------------------------------------------------------------
+
+static void
+JobFile(char *name, char *manifest, int job, char *suffix)
+{
+    sprintf(name, "%s.%d.%s", manifest, job + 1, suffix);
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::Start
+// 	Fork a host process to run "job", as worker "worker".  The new
+//	process reads its console input from the job's file (or from
+//	nowhere), writes its output to a file of its own, and runs the
+//	program with the flags the batch was given, plus:
+//
+//		-m <host id>	(a different one for each worker)
+//		-so <file>	(to save its statistics in)
+//		-mem <#>, -rs <#>	(if the job sets them)
+//		-x <program>
+//----------------------------------------------------------------------
+
+void
+BatchRunner::Start(int job, int worker, int (*nachosMain)(int, char **))
+{
+    BatchJob *j = &jobs[job];
+    int length = strlen(manifest) + 20;
+    char *outName = new char[length];
+    char *statsName = new char[length];
+    char hostId[12];
+    char **jobArgv;
+    int jobArgc = 0, fd, pid;
+
+    JobFile(outName, manifest, job, "out");
+    JobFile(statsName, manifest, job, "stats");
+    Unlink(statsName);			// in case of an earlier batch
+    cout.flush();			// or the child will print whatever
+    fflush(stdout);			// is still buffered, too
+
+    j->wallTime = HostMicroseconds();
+    j->worker = worker;
+    pid = fork();
+    ASSERT(pid >= 0);
+    if (pid > 0) {
+	j->pid = pid;
+	delete [] outName;
+	delete [] statsName;
+	return;
+    }
+
+    // in the child: set up the console, and become the job
+    fd = open(j->consoleIn != NULL ? j->consoleIn : "/dev/null", O_RDONLY);
+    if (fd < 0) {
+	cerr << "Unable to open console input " << j->consoleIn << "\n";
+	_exit(1);
+    }
+    dup2(fd, 0);
+    close(fd);
+    fd = OpenForWrite(outName);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    close(fd);
+
+    sprintf(hostId, "%d", BatchHostBase + worker);
+    jobArgv = new char *[numArgs + 12];
+    jobArgv[jobArgc++] = "nachos";
+    for (int i = 0; i < numArgs; i++) {
+	jobArgv[jobArgc++] = args[i];
+    }
+    jobArgv[jobArgc++] = "-m";
+    jobArgv[jobArgc++] = hostId;
+    jobArgv[jobArgc++] = "-so";
+    jobArgv[jobArgc++] = statsName;
+    if (j->memoryPages != NULL) {
+	jobArgv[jobArgc++] = "-mem";
+	jobArgv[jobArgc++] = j->memoryPages;
+    }
+    if (j->seed != NULL) {
+	jobArgv[jobArgc++] = "-rs";
+	jobArgv[jobArgc++] = j->seed;
+    }
+    jobArgv[jobArgc++] = "-x";
+    jobArgv[jobArgc++] = j->program;
+    jobArgv[jobArgc] = NULL;
+    exit((*nachosMain)(jobArgc, jobArgv));
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::Finish
+// 	"job" has exited, with "hostStatus" (from waitpid).  Note how it
+//	ended and how long it took, and read in the statistics it saved.
+//----------------------------------------------------------------------
+
+void
+BatchRunner::Finish(int job, int hostStatus)
+{
+    BatchJob *j = &jobs[job];
+    char *statsName = new char[strlen(manifest) + 20];
+
+    j->wallTime = HostMicroseconds() - j->wallTime;
+    j->pid = 0;
+    if (WIFEXITED(hostStatus)) {
+	j->status = WEXITSTATUS(hostStatus);
+    } else {
+	j->status = 128 + WTERMSIG(hostStatus);
+    }
+
+    JobFile(statsName, manifest, job, "stats");
+    ifstream in(statsName);
+    if (in) {
+	long long *fields = new long long[Statistics::NumFields()];
+	char comma;
+	int i;
+
+	for (i = 0; i < Statistics::NumFields(); i++) {
+	    if ((i > 0 && !(in >> comma)) || !(in >> fields[i])) {
+		break;
+	    }
+	}
+	if (i == Statistics::NumFields()) {
+	    j->fields = fields;
+	} else {
+	    delete [] fields;
+	}
+	in.close();
+	Unlink(statsName);
+    }
+    delete [] statsName;
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::WriteCsv
+// 	Write a header line, a line for each job, and a line of totals.
+//	A job that saved no statistics (because it crashed) has empty
+//	fields for them.  On the "total" line, the status is the # of
+//	jobs that failed, and the time is for the whole batch.
+//----------------------------------------------------------------------
+
+void
+BatchRunner::WriteCsv(ostream &out)
+{
+    long long *total = new long long[Statistics::NumFields()];
+    int failed = 0;
+
+    out << "job,program,consoleIn,memoryPages,seed,status,wallMicroseconds";
+    for (int f = 0; f < Statistics::NumFields(); f++) {
+	out << "," << Statistics::FieldName(f);
+	total[f] = 0;
+    }
+    out << "\n";
+    for (int i = 0; i < numJobs; i++) {
+	BatchJob *j = &jobs[i];
+
+	out << (i + 1) << ",";
+	WriteCsvString(out, j->program);
+	out << ",";
+	WriteCsvString(out, j->consoleIn);
+	out << ",";
+	WriteCsvString(out, j->memoryPages);
+	out << ",";
+	WriteCsvString(out, j->seed);
+	out << "," << j->status << "," << (long long) j->wallTime;
+	for (int f = 0; f < Statistics::NumFields(); f++) {
+	    out << ",";
+	    if (j->fields != NULL) {
+		out << j->fields[f];
+		total[f] += j->fields[f];
+	    }
+	}
+	out << "\n";
+	if (JobFailed(j)) {
+	    failed++;
+	}
+    }
+    out << "total,,,,," << failed << "," << (long long) wallTime;
+    for (int f = 0; f < Statistics::NumFields(); f++) {
+	out << "," << total[f];
+    }
+    out << "\n";
+    delete [] total;
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::WriteJson
+// 	Write the same results as WriteCsv, as one JSON object: the
+//	batch as a whole, an array of jobs, and the totals.
+//----------------------------------------------------------------------
+
+void
+BatchRunner::WriteJson(ostream &out)
+{
+    long long *total = new long long[Statistics::NumFields()];
+    int failed = 0;
+
+    for (int f = 0; f < Statistics::NumFields(); f++) {
+	total[f] = 0;
+    }
+    out << "{\n  \"workers\": " << numWorkers << ",\n  \"wallMicroseconds\": "
+	<< (long long) wallTime << ",\n  \"jobs\": [";
+    for (int i = 0; i < numJobs; i++) {
+	BatchJob *j = &jobs[i];
+
+	out << (i == 0 ? "\n" : ",\n") << "    {\"job\": " << (i + 1)
+	    << ", \"program\": ";
+	WriteJsonString(out, j->program);
+	out << ", \"consoleIn\": ";
+	WriteJsonString(out, j->consoleIn);
+	out << ", \"memoryPages\": ";
+	WriteJsonString(out, j->memoryPages);
+	out << ", \"seed\": ";
+	WriteJsonString(out, j->seed);
+	out << ", \"status\": " << j->status << ", \"wallMicroseconds\": "
+	    << (long long) j->wallTime << ", \"stats\": ";
+	if (j->fields == NULL) {
+	    out << "null}";
+	} else {
+	    for (int f = 0; f < Statistics::NumFields(); f++) {
+		out << (f == 0 ? "{" : ", ") << "\""
+		    << Statistics::FieldName(f) << "\": " << j->fields[f];
+		total[f] += j->fields[f];
+	    }
+	    out << "}}";
+	}
+	if (JobFailed(j)) {
+	    failed++;
+	}
+    }
+    out << "\n  ],\n  \"failed\": " << failed << ",\n  \"total\": ";
+    for (int f = 0; f < Statistics::NumFields(); f++) {
+	out << (f == 0 ? "{" : ", ") << "\"" << Statistics::FieldName(f)
+	    << "\": " << total[f];
+    }
+    out << "}\n}\n";
+    delete [] total;
+}
+
+//----------------------------------------------------------------------
+// BenchSummary
+// 	What the runs of one line of the manifest came to -- or, read
+//	back from a baseline, what they came to before.  Only the runs
+//	that succeeded count.
+//----------------------------------------------------------------------
+
+class BenchSummary {
+  public:
+    char *program;		// as in the manifest
+    char *consoleIn;		// or NULL
+    int runs;			// # of runs that succeeded
+    double seconds;		// host seconds per run: the mean,
+    double secondsDev;		// and the standard deviation
+    long long totalTicks;	// simulated time per run (the mean)
+    long long instructions;	// simulated instructions per run (ditto)
+    double speed;		// simulated instructions per host second:
+    double speedDev;		// the mean, and the standard deviation
+};
+
+//----------------------------------------------------------------------
+// FieldNumber
+// 	Return the number of the statistics counter called "name".
+//----------------------------------------------------------------------
+
+static int
+FieldNumber(char *name)
+{
+    for (int f = 0; f < Statistics::NumFields(); f++) {
+	if (strcmp(Statistics::FieldName(f), name) == 0) {
+	    return f;
+	}
+    }
+    ASSERTNOTREACHED();
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Deviation
+// 	Return the sample standard deviation of "n" values, given their
+//	"sum" and the sum of their "squares".
+//----------------------------------------------------------------------
+
+static double
+Deviation(double sum, double squares, int n)
+{
+    double variance;
+
+    if (n < 2) {
+	return 0;
+    }
+    variance = (squares - sum * sum / n) / (n - 1);
+    return (variance > 0) ? sqrt(variance) : 0;
+}
+
+//----------------------------------------------------------------------
+// SameString
+// 	Are "a" and "b" the same, counting NULL the same as empty?
+//----------------------------------------------------------------------
+
+static bool
+SameString(char *a, char *b)
+{
+    return strcmp(a != NULL ? a : "", b != NULL ? b : "") == 0;
+}
+
+//----------------------------------------------------------------------
+// SplitCsv
+// 	Split a "line" written by WriteCsvString and friends into at most
+//	"max" fields, in place, undoing any quoting.  Return the number
+//	of fields.
+//----------------------------------------------------------------------
+
+static int
+SplitCsv(char *line, char **fields, int max)
+{
+    char *from = line, *to = line;
+    int n = 0;
+
+    while (n < max) {
+	fields[n++] = to;
+	if (*from == '"') {		// quoted, with "" for a quote
+	    from++;
+	    while (*from != '\0' && !(*from == '"' && from[1] != '"')) {
+		if (*from == '"') {
+		    from++;
+		}
+		*to++ = *from++;
+	    }
+	    if (*from == '"') {
+		from++;
+	    }
+	}
+	while (*from != '\0' && *from != ',' && *from != '\r') {
+	    *to++ = *from++;
+	}
+	if (*from != ',') {
+	    *to = '\0';
+	    break;
+	}
+	from++;
+	*to++ = '\0';
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// ReadSummary
+// 	Read a summary written by "-bs" from "fileName" into "summary",
+//	which has room for "max" lines.  Return the # of lines read, or
+//	-1 if the file can't be read.  The strings are copies, for the
+//	caller to delete.
+//----------------------------------------------------------------------
+
+static const int SummaryFields = 9;	// # of fields on a summary line
+
+static int
+ReadSummary(char *fileName, BenchSummary *summary, int max)
+{
+    ifstream in(fileName);
+    char line[1024];
+    int n = 0;
+
+    if (!in || !in.getline(line, sizeof(line))) {	// skip the header
+	return -1;
+    }
+    while (n < max && in.getline(line, sizeof(line))) {
+	char *fields[SummaryFields];
+	BenchSummary *s = &summary[n];
+
+	if (SplitCsv(line, fields, SummaryFields) < SummaryFields) {
+	    continue;
+	}
+	s->program = new char[strlen(fields[0]) + 1];
+	strcpy(s->program, fields[0]);
+	s->consoleIn = new char[strlen(fields[1]) + 1];
+	strcpy(s->consoleIn, fields[1]);
+	s->runs = atoi(fields[2]);
+	s->seconds = atof(fields[3]);
+	s->secondsDev = atof(fields[4]);
+	s->totalTicks = atoll(fields[5]);
+	s->instructions = atoll(fields[6]);
+	s->speed = atof(fields[7]);
+	s->speedDev = atof(fields[8]);
+	n++;
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// BatchRunner::Summarize
+// 	Sum up the runs of each line of the manifest: how long they took
+//	on the host, and how many simulated instructions they got through
+//	per host second.  Print the summary, write it to "summaryFile",
+//	if there is one, and compare it with the one in "baselineFile",
+//	if there is one.
+//
+//	A line is reported as slower if it ran fewer instructions per
+//	second than in the baseline -- by more than BenchTolerance, or
+//	by more than twice what the runs varied, whichever is more, so
+//	that a noisy host does not raise false alarms.  A line whose
+//	simulated time changed did different work, and is not compared.
+//
+//	Returns the # of lines that were slower.
+//----------------------------------------------------------------------
+
+int
+BatchRunner::Summarize()
+{
+    BenchSummary *summary = new BenchSummary[numEntries];
+    BenchSummary *baseline = NULL;
+    int totalField = FieldNumber("totalTicks");
+    int userField = FieldNumber("userTicks");
+    int numBaseline = 0, slower = 0;
+
+    for (int e = 0; e < numEntries; e++) {
+	BenchSummary *s = &summary[e];
+	double sum = 0, squares = 0, speedSum = 0, speedSquares = 0;
+	long long ticks = 0, instructions = 0;
+
+	s->runs = 0;
+	for (int i = 0; i < numJobs; i++) {
+	    BatchJob *j = &jobs[i];
+	    double seconds = max(j->wallTime, 1.0) / 1000000.0;
+	    double speed;
+
+	    if (j->entry != e) {
+		continue;
+	    }
+	    s->program = j->program;
+	    s->consoleIn = j->consoleIn;
+	    if (JobFailed(j)) {
+		continue;
+	    }
+	    speed = j->fields[userField] / seconds;
+	    s->runs++;
+	    sum += seconds;
+	    squares += seconds * seconds;
+	    speedSum += speed;
+	    speedSquares += speed * speed;
+	    ticks += j->fields[totalField];
+	    instructions += j->fields[userField];
+	}
+	if (s->runs == 0) {
+	    s->seconds = s->secondsDev = s->speed = s->speedDev = 0;
+	    s->totalTicks = s->instructions = 0;
+	    continue;
+	}
+	s->seconds = sum / s->runs;
+	s->secondsDev = Deviation(sum, squares, s->runs);
+	s->speed = speedSum / s->runs;
+	s->speedDev = Deviation(speedSum, speedSquares, s->runs);
+	s->totalTicks = ticks / s->runs;
+	s->instructions = instructions / s->runs;
+    }
+
+    if (summaryFile != NULL) {
+	ofstream out(summaryFile);
+
+	if (!out) {
+	    cerr << "Unable to write " << summaryFile << "\n";
+	} else {
+	    out << "program,consoleIn,runs,hostSeconds,hostSecondsStddev,"
+		<< "totalTicks,instructions,instructionsPerSecond,"
+		<< "instructionsPerSecondStddev\n";
+	    for (int e = 0; e < numEntries; e++) {
+		BenchSummary *s = &summary[e];
+
+		WriteCsvString(out, s->program);
+		out << ",";
+		WriteCsvString(out, s->consoleIn);
+		out << "," << s->runs << "," << s->seconds << ","
+		    << s->secondsDev << "," << s->totalTicks << ","
+		    << s->instructions << "," << (long long) s->speed << ","
+		    << (long long) s->speedDev << "\n";
+	    }
+	}
+    }
+    if (baselineFile != NULL) {
+	baseline = new BenchSummary[numEntries + 64];
+	numBaseline = ReadSummary(baselineFile, baseline, numEntries + 64);
+	if (numBaseline < 0) {
+	    cerr << "Unable to read baseline " << baselineFile << "\n";
+	    numBaseline = 0;
+	}
+    }
+
+    cerr << "Benchmark: (program, runs, host seconds, +-%, ticks, "
+	 << "instructions, instructions per host second, +-%";
+    if (baselineFile != NULL) {
+	cerr << ", change from baseline %";
+    }
+    cerr << ")\n";
+    for (int e = 0; e < numEntries; e++) {
+	BenchSummary *s = &summary[e];
+	BenchSummary *base = NULL;
+
+	cerr << "    " << s->program;
+	if (s->consoleIn != NULL) {
+	    cerr << " < " << s->consoleIn;
+	}
+	cerr << ", " << s->runs << "/" << numRuns;
+	if (s->runs == 0) {
+	    cerr << ", failed\n";
+	    continue;
+	}
+	cerr << ", " << s->seconds << ", "
+	     << (100.0 * s->secondsDev / s->seconds) << ", " << s->totalTicks
+	     << ", " << s->instructions << ", " << (long long) s->speed << ", "
+	     << (s->speed > 0 ? 100.0 * s->speedDev / s->speed : 0.0);
+	for (int b = 0; b < numBaseline && base == NULL; b++) {
+	    if (SameString(baseline[b].program, s->program)
+		    && SameString(baseline[b].consoleIn, s->consoleIn)) {
+		base = &baseline[b];
+	    }
+	}
+	if (baselineFile == NULL) {
+	    cerr << "\n";
+	} else if (base == NULL || base->speed <= 0) {
+	    cerr << ", not in baseline\n";
+	} else if (base->totalTicks != s->totalTicks) {
+	    cerr << ", simulated time changed (was " << base->totalTicks
+		 << ")\n";
+	} else {
+	    double change = (s->speed - base->speed) / base->speed;
+	    double noise = sqrt(pow(s->speedDev / s->speed, 2)
+				+ pow(base->speedDev / base->speed, 2));
+
+	    cerr << ", " << (100.0 * change);
+	    if (change < -max(BenchTolerance, 2 * noise)) {
+		cerr << ", SLOWER";
+		slower++;
+	    }
+	    cerr << "\n";
+	}
+    }
+
+    for (int b = 0; b < numBaseline; b++) {
+	delete [] baseline[b].program;
+	delete [] baseline[b].consoleIn;
+    }
+    delete [] baseline;
+    delete [] summary;
+    return slower;
+}
@@ -0,0 +1,113 @@
+// batch.h
+//	Data structures for running a batch of independent Nachos jobs.
+//
+//	A job is one user program, run as if by "nachos -x", with console
+//	input of its own, an amount of physical memory and a random seed.
+//	The jobs are listed in a manifest file, one to a line:
+//
+//		program [consoleIn [memoryPages [seed]]]
+//
+//	where "-" leaves a setting at its default (no console input, all
+//	of memory, no random time slicing), and "#" starts a comment.
+//
+//	The kernel is a global, so each job gets a kernel of its own by
+//	running in a host process of its own, forked from the batch
+//	runner; up to one job per host CPU runs at once.  Before any job
+//	starts, the runner reads each program into memory (see
+//	AddrSpace::CacheProgram), so that the jobs share one read-only
+//	copy, instead of each of them reading the file again.
+//
+//	A job's console output goes to "<manifest>.<job #>.out".  When it
+//	halts, it saves its statistics (Statistics::Save); the runner
+//	collects them, with the host time the job took, and at the end
+//	writes them all out, one row per job and a row of totals, as CSV
+//	(or JSON, if the output file's name ends in ".json").
+//
+//	For benchmarking, each job in the manifest can be run several
+//	times over ("-br #").  The runner then summarizes the runs of each
+//	job: the host time they took and how much it varied, the simulated
+//	time, and the simulated instructions executed per host second --
+//	how fast Nachos is.  The summary can be saved ("-bs file") and a
+//	later batch compared against it ("-bb file"), to catch a change
+//	that makes Nachos slower.  (See "make bench" in test/Makefile.)
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "sysdep.h"
+
+#define BatchHostBase	100	// host id of the first worker (each
+				// worker gets its own DISK_n, SOCKET_n)
+#define NoProgramStatus	127	// status of a job whose program isn't
+				// there (as the shell has it)
+#define BenchTolerance	0.05	// how much slower than the baseline a
+				// job can be, before it is reported,
+				// if its runs vary less than that
+
+// One job in the manifest, and what became of it.
+
+class BatchJob {
+  public:
+    char *program;		// user program to run
+    char *consoleIn;		// file to use as console input, or NULL
+    char *memoryPages;		// physical pages, or NULL for all
+    char *seed;			// random seed, or NULL for none
+    int entry;			// the manifest line it came from (each
+				// line is run "numRuns" times)
+    int pid;			// host process running it, or 0
+    int worker;			// which worker it ran on
+    int status;			// its exit code (128 + signal # if it
+				// was killed), or -1 if not run yet
+    double wallTime;		// host microseconds it took
+    long long *fields;		// its statistics, or NULL if it saved
+				// none
+};
+
+// The following class defines a batch of jobs, and the pool of host
+// processes that runs them.
+
+class BatchRunner {
+  public:
+    BatchRunner(int argc, char **argv);
+				// Read the batch flags, and the manifest;
+				// other flags are passed on to every job
+    ~BatchRunner();
+
+    int Run(int (*nachosMain)(int argc, char **argv));
+				// Run every job, with "nachosMain", and
+				// write out the results; return the #
+				// of jobs that failed
+
+  private:
+    char *manifest;		// file the jobs were read from
+    char *outputFile;		// file to write results to, or NULL
+    char *summaryFile;		// file to write the summary to, or NULL
+    char *baselineFile;		// summary to compare with, or NULL
+    int numRuns;		// # of times to run each line
+    int numEntries;		// # of lines in the manifest
+    int numWorkers;		// most jobs to run at once
+    int numArgs;		// the rest of the command line, to
+    char **args;		// pass on to each job
+    BatchJob *jobs;		// the jobs, in manifest order
+    int numJobs;
+    double wallTime;		// host microseconds the batch took
+
+    void ReadManifest();	// fill in "jobs"
+    void Start(int job, int worker, int (*nachosMain)(int, char **));
+				// fork a process to run "job"
+    void Finish(int job, int hostStatus);
+				// collect what "job" left behind
+    void WriteCsv(ostream &out);	// write the results, as CSV
+    void WriteJson(ostream &out);	// or as JSON
+    int Summarize();		// print a summary of each line's runs,
+				// and compare it with the baseline;
+				// return the # of lines that got slower
+};
+
+#endif // BATCH_H
@@ -0,0 +1,130 @@
+// boundedbuffer.cc
+//	Routines for synchronized access to a buffer of fixed size.
+//
+// 	Implemented in "monitor"-style, like SynchList, with one
+//	condition for each way of having to wait.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "boundedbuffer.h"
+
+//----------------------------------------------------------------------
+// BoundedBuffer<T>::BoundedBuffer
+//	Allocate and initialize the data structures needed for a 
+//	bounded buffer, empty to start with.
+//
+//	"size" is the most items the buffer will hold.
+//----------------------------------------------------------------------
+
+template <class T>
+BoundedBuffer<T>::BoundedBuffer(int size)
+{
+    ASSERT(size > 0);
+    items = new T[size];
+    capacity = size;
+    front = count = 0;
+    lock = new Lock("buffer lock");
+    notFull = new Condition("buffer not full");
+    notEmpty = new Condition("buffer not empty");
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer<T>::~BoundedBuffer
+//	De-allocate the data structures created for a bounded buffer.
+//----------------------------------------------------------------------
+
+template <class T>
+BoundedBuffer<T>::~BoundedBuffer()
+{
+    delete notEmpty;
+    delete notFull;
+    delete lock;
+    delete [] items;
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer<T>::Put
+//      Add "item" at the end of the buffer, waiting until there is
+//	room for it.  Wake up anyone waiting for an item.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+BoundedBuffer<T>::Put(T item)
+{
+    lock->Acquire();
+    while (count == capacity) {
+	notFull->Wait(lock);		// wait until there is room
+    }
+    items[(front + count) % capacity] = item;
+    count++;
+    notEmpty->Signal(lock);		// wake up a getter, if any
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer<T>::Get
+//      Remove the item at the front of the buffer, waiting until
+//	there is one.  Wake up anyone waiting for room.
+// Returns:
+//	The removed item. 
+//----------------------------------------------------------------------
+
+template <class T>
+T
+BoundedBuffer<T>::Get()
+{
+    T item;
+
+    lock->Acquire();
+    while (count == 0) {
+	notEmpty->Wait(lock);		// wait until there is an item
+    }
+    item = items[front];
+    front = (front + 1) % capacity;
+    count--;
+    notFull->Signal(lock);		// wake up a putter, if any
+    lock->Release();
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer<T>::SelfTest, SelfTestHelper
+//	Test whether the BoundedBuffer implementation is working, by
+//	having a helper thread put "numItems" items through the buffer
+//	as fast as it can, while we take them out.  The items should
+//	come out in order, even though the buffer cannot hold them all.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+BoundedBuffer<T>::SelfTestHelper (void* data) 
+{
+    BoundedBuffer<T>* _this = (BoundedBuffer<T>*)data;
+    T *items = _this->selfTestItems;	// the buffer may be gone after
+    int numItems = _this->selfTestNumItems;	// the last Put
+
+    for (int i = 0; i < numItems; i++) {
+	_this->Put(items[i]);
+    }
+}
+
+template <class T>
+void
+BoundedBuffer<T>::SelfTest(T *p, int numItems)
+{
+    Thread *helper = new Thread("producer");
+
+    ASSERT(count == 0 && numItems > capacity);
+    selfTestItems = p;
+    selfTestNumItems = numItems;
+    helper->Fork(BoundedBuffer<T>::SelfTestHelper, this);
+    kernel->currentThread->Yield();	// let the producer fill the buffer
+    for (int i = 0; i < numItems; i++) {
+	ASSERT(p[i] == this->Get());
+    }
+    ASSERT(count == 0);
+}
@@ -0,0 +1,59 @@
+// boundedbuffer.h 
+//	Data structures for a synchronized buffer of fixed size.
+//
+//	Like a SynchList, except that the buffer holds at most a fixed
+//	number of items: a thread putting an item into a full buffer
+//	waits until some other thread takes one out.  So a producer that
+//	gets ahead of its consumer is held back, rather than piling up
+//	items without limit.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BOUNDEDBUFFER_H
+#define BOUNDEDBUFFER_H
+
+#include "copyright.h"
+#include "synch.h"
+
+// The following class defines a "bounded buffer" -- a ring of
+// "capacity" items for which these constraints hold:
+//	1. Threads trying to take an item out will wait until the
+//	buffer has an item in it.
+//	2. Threads trying to put an item in will wait until the
+//	buffer has room for it.
+//	3. One thread at a time can access the buffer
+
+template <class T>
+class BoundedBuffer {
+  public:
+    BoundedBuffer(int capacity);// initialize an empty buffer
+    ~BoundedBuffer();		// de-allocate the buffer
+
+    void Put(T item);		// add item at the end, waiting if the
+				// buffer is full
+    T Get();			// remove the item at the front, waiting
+				// if the buffer is empty
+
+    void SelfTest(T *items, int numItems);
+				// test the BoundedBuffer implementation
+
+  private:
+    T *items;			// the ring of items
+    int capacity;		// # of items the ring can hold
+    int front;			// index of the first item
+    int count;			// # of items in the ring
+    Lock *lock;			// enforce mutual exclusive access
+    Condition *notFull;		// wait in Put if the buffer is full
+    Condition *notEmpty;	// wait in Get if the buffer is empty
+
+    // these are only to assist SelfTest()
+    T *selfTestItems;
+    int selfTestNumItems;
+    static void SelfTestHelper(void* data);
+};
+
+#include "boundedbuffer.cc"
+
+#endif // BOUNDEDBUFFER_H
@@ -12,11 +12,21 @@
 #include "sysdep.h"
 #include "synch.h"
 #include "synchlist.h"
+#include "boundedbuffer.h"
 #include "libtest.h"
 #include "string.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
 #include "post.h"
+#include "bitmap.h"
+#include "proctable.h"
+#include "ipc.h"
+#include "pipe.h"
+#include "stackpool.h"
+#include "slab.h"
+#include "snapshot.h"
+#include "inputlog.h"
+#include "hostprofile.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -27,9 +37,25 @@
 Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
+    randomSeed = 0;
+    periodicTimer = FALSE;
+    deterministicInput = FALSE;
+    numCpus = 1;
+    schedPolicy = "mlfq";      // see schedpolicy.h for the choices
+    stackHighWater = DefaultStackHighWater;
     debugUserProg = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
+    userPages = NumPhysPages;  // default is all of memory
+    statsFile = NULL;
+    dumpFile = NULL;
+    profileHost = FALSE;
+    hostProfile = NULL;
+    exitStatus = 0;
+    snapshotFile = NULL;       // default is to boot from scratch
+    snapshot = NULL;
+    recordFile = playFile = NULL;
+    inputLog = NULL;
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
@@ -39,10 +65,28 @@ Kernel::Kernel(int argc, char **argv)
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    ASSERT(i + 1 < argc);
-	    RandomInit(atoi(argv[i + 1]));// initialize pseudo-random
+	    randomSeed = atoi(argv[i + 1]);
+	    RandomInit(randomSeed);	// initialize pseudo-random
 					// number generator
 	    randomSlice = TRUE;
 	    i++;
+        } else if (strcmp(argv[i], "-sp") == 0) {
+	    ASSERT(i + 1 < argc);
+	    schedPolicy = argv[i + 1];
+	    i++;
+        } else if (strcmp(argv[i], "-sh") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is int
+	    stackHighWater = atoi(argv[i + 1]);
+	    i++;
+        } else if (strcmp(argv[i], "-pt") == 0) {
+	    periodicTimer = TRUE;
+        } else if (strcmp(argv[i], "-mp") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is int
+	    numCpus = atoi(argv[i + 1]);
+	    ASSERT(numCpus >= 1 && numCpus <= MaxCpus);
+	    i++;
+        } else if (strcmp(argv[i], "-di") == 0) {
+	    deterministicInput = TRUE;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
 	} else if (strcmp(argv[i], "-ci") == 0) {
@@ -53,6 +97,33 @@ Kernel::Kernel(int argc, char **argv)
 	    ASSERT(i + 1 < argc);
 	    consoleOut = argv[i + 1];
 	    i++;
+	} else if (strcmp(argv[i], "-mem") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is int
+	    userPages = atoi(argv[i + 1]);
+	    ASSERT(userPages >= 1 && userPages <= NumPhysPages);
+	    i++;
+	} else if (strcmp(argv[i], "-so") == 0) {
+	    ASSERT(i + 1 < argc);
+	    statsFile = argv[i + 1];
+	    i++;
+	} else if (strcmp(argv[i], "-sd") == 0) {
+	    ASSERT(i + 1 < argc);
+	    dumpFile = argv[i + 1];
+	    i++;
+	} else if (strcmp(argv[i], "-hp") == 0) {
+	    profileHost = TRUE;
+	} else if (strcmp(argv[i], "-ls") == 0) {
+	    ASSERT(i + 1 < argc);
+	    snapshotFile = argv[i + 1];
+	    i++;
+	} else if (strcmp(argv[i], "-rec") == 0) {
+	    ASSERT(i + 1 < argc);
+	    recordFile = argv[i + 1];
+	    i++;
+	} else if (strcmp(argv[i], "-play") == 0) {
+	    ASSERT(i + 1 < argc);
+	    playFile = argv[i + 1];
+	    i++;
 #ifndef FILESYS_STUB
 	} else if (strcmp(argv[i], "-f") == 0) {
 	    formatFlag = TRUE;
@@ -68,7 +139,17 @@ Kernel::Kernel(int argc, char **argv)
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
 	    cout << "Partial usage: nachos [-s]\n";
+	    cout << "Partial usage: nachos [-sp fifo|mlfq|stride|lottery]\n";
+	    cout << "Partial usage: nachos [-sh #]\n";
+	    cout << "Partial usage: nachos [-pt]\n";
+	    cout << "Partial usage: nachos [-di]\n";
+	    cout << "Partial usage: nachos [-mp #]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
+	    cout << "Partial usage: nachos [-mem #] [-so statsFile]\n";
+	    cout << "Partial usage: nachos [-sd statsFile.json|statsFile.csv]\n";
+	    cout << "Partial usage: nachos [-hp]\n";
+	    cout << "Partial usage: nachos [-ls snapshotFile]\n";
+	    cout << "Partial usage: nachos [-rec inputLog] [-play inputLog]\n";
 #ifndef FILESYS_STUB
 	    cout << "Partial usage: nachos [-nf]\n";
 #endif
@@ -90,14 +171,44 @@ Kernel::Initialize()
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state. 
+    if (profileHost) {			// before anything is timed
+	hostProfile = new HostProfile();
+    }
+    stackPool = new StackPool(stackHighWater);
     currentThread = new Thread("main");		
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();		// collect statistics
-    interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
+    if (snapshotFile != NULL) {		// carry on from the snapshot
+	snapshot = new Snapshot(snapshotFile);
+	snapshot->Restore(stats);
+    }
+    if (dumpFile != NULL) {
+	stats->DumpOnSignal(dumpFile);
+    }
+    if (recordFile != NULL) {
+	inputLog = new InputLog(recordFile, FALSE,
+				randomSlice ? randomSeed : NoSeed);
+    } else if (playFile != NULL) {	// the log decides the random seed
+	inputLog = new InputLog(playFile, TRUE, NoSeed);
+	randomSlice = (inputLog->Seed() != NoSeed);
+	RandomInit(randomSlice ? inputLog->Seed() : 1);	// 1 is the
+							// host's default
+    }
+    interrupt = new Interrupt(deterministicInput);
+					// start up interrupt handling
+    SchedPolicy *policy = SchedPolicy::Create(schedPolicy);
+    if (policy == NULL) {
+	cerr << "Unknown scheduling policy: " << schedPolicy << "\n";
+	Abort();
+    }
+    scheduler = new Scheduler(policy, numCpus);
+					// initialize the ready queues
+    alarm = new Alarm(randomSlice, periodicTimer);	// start up time slicing
     machine = new Machine(debugUserProg);
+    if (snapshot != NULL) {
+	snapshot->Restore(machine);
+    }
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
@@ -108,17 +219,34 @@ Kernel::Initialize()
 #endif // FILESYS_STUB
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
+    frameMap = new Bitmap(NumPhysPages);
+    for (int i = userPages; i < NumPhysPages; i++) {
+	frameMap->Mark(i);		// memory the machine doesn't have
+    }
+    processTable = new ProcessTable(MaxProcesses);
 
     interrupt->Enable();
 }
 
 //----------------------------------------------------------------------
 // Kernel::~Kernel
-// 	Nachos is halting.  De-allocate global data structures.
+// 	Nachos is halting.  De-allocate global data structures, and
+//	exit with the status of the last user program (so a batch run,
+//	or a shell script, can tell whether it worked).
 //----------------------------------------------------------------------
 
 Kernel::~Kernel()
 {
+    int status = exitStatus;
+
+    if (statsFile != NULL) {
+	stats->Save(statsFile);
+    }
+    if (dumpFile != NULL) {
+	stats->Dump(dumpFile);
+    }
+    delete inputLog;			// while there is still a clock
+    delete hostProfile;
     delete stats;
     delete interrupt;
     delete scheduler;
@@ -128,30 +256,58 @@ Kernel::~Kernel()
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+    delete snapshot;
     delete postOfficeIn;
     delete postOfficeOut;
+    delete frameMap;
+    delete processTable;
+    delete stackPool;
     
-    Exit(0);
+    Exit(status);
 }
 
+static int bufferTestVector[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
 //----------------------------------------------------------------------
 // Kernel::ThreadSelfTest
-//      Test threads, semaphores, synchlists
+//      Test threads, stack allocation, scheduling policies, sleeping,
+//      semaphores, priority inheritance, synchlists, reader-writer
+//      locks, bounded buffers, the process table, Ipc mailboxes, pipes
 //----------------------------------------------------------------------
 
 void
 Kernel::ThreadSelfTest() {
    Semaphore *semaphore;
+   Lock *lock;
+   RWLock *rwLock;
+   BoundedBuffer<int> *buffer;
    SynchList<int> *synchList;
+   ProcessTable *table;
+   Mailbox *mailbox;
+   PipeBuffer *pipe;
+   int slabs;
    
    LibSelfTest();		// test library routines
    
    currentThread->SelfTest();	// test thread switching
+
+   stackPool->SelfTest();	// test stack re-use
+
+   scheduler->SelfTest();	// test scheduling policies
+
+   alarm->SelfTest();		// test sleeping
+
+   interrupt->SelfTest();	// test pending interrupts
    
    				// test semaphore operation
    semaphore = new Semaphore("test", 0);
    semaphore->SelfTest();
    delete semaphore;
+
+   				// test priority inheritance
+   lock = new Lock("test");
+   lock->SelfTest();
+   delete lock;
    
    				// test locks, condition variables
 				// using synchronized lists
@@ -159,6 +315,41 @@ Kernel::ThreadSelfTest() {
    synchList->SelfTest(9);
    delete synchList;
 
+   				// the same again should be served
+				// entirely from the slab caches
+   slabs = SlabCache::TotalSlabs();
+   synchList = new SynchList<int>;
+   synchList->SelfTest(9);
+   delete synchList;
+   ASSERT(SlabCache::TotalSlabs() == slabs);
+
+   				// test reader-writer locks
+   rwLock = new RWLock("test");
+   rwLock->SelfTest();
+   delete rwLock;
+
+   				// test bounded buffers
+   buffer = new BoundedBuffer<int>(3);
+   buffer->SelfTest(bufferTestVector,
+		    sizeof(bufferTestVector) / sizeof(int));
+   delete buffer;
+
+   				// test the process table, using
+				// kernel threads as processes
+   table = new ProcessTable(MaxProcesses);
+   table->SelfTest();
+   delete table;
+
+   				// test Ipc message passing
+   mailbox = new Mailbox("test");
+   mailbox->SelfTest();
+   delete mailbox;
+
+   				// test pipes
+   pipe = new PipeBuffer();
+   pipe->SelfTest();
+   delete pipe;
+
 }
 
 //----------------------------------------------------------------------
@@ -24,6 +24,12 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class Bitmap;
+class ProcessTable;
+class StackPool;
+class Snapshot;
+class InputLog;
+class HostProfile;
 
 class Kernel {
   public:
@@ -45,6 +51,7 @@ class Kernel {
 // they're global variables used everywhere.
 
     Thread *currentThread;	// the thread holding the CPU
+    StackPool *stackPool;	// execution stacks for threads
     Scheduler *scheduler;	// the ready list
     Interrupt *interrupt;	// interrupt status
     Statistics *stats;		// performance metrics
@@ -56,15 +63,40 @@ class Kernel {
     FileSystem *fileSystem;     
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
+    Bitmap *frameMap;		// physical page frames in use
+    ProcessTable *processTable;	// user programs Nachos is running
 
     int hostName;               // machine identifier
+    Snapshot *snapshot;		// what we were started from, or NULL
+    InputLog *inputLog;		// input being recorded or played back,
+				// or NULL
+    HostProfile *hostProfile;	// where the host's time goes, or NULL
+    int exitStatus;		// what Nachos exits with, at halt: the
+				// exit status of the last program to end
 
   private:
     bool randomSlice;		// enable pseudo-random time slicing
+    int randomSeed;		// and the seed for it
+    bool periodicTimer;		// interrupt every time slice, even if
+				// there is nothing to do
+    bool deterministicInput;	// only take console and network input
+				// when there is nothing else to do
+    char *schedPolicy;		// name of the scheduling policy
+    int numCpus;		// # of CPUs to simulate
+    int stackHighWater;		// most free thread stacks to keep
     bool debugUserProg;         // single step user program
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
+    int userPages;		// # of physical pages user programs
+				// may use
+    char *statsFile;		// file to save statistics in, at halt
+    char *dumpFile;		// file to dump all the statistics in,
+				// at halt and on SIGUSR1
+    bool profileHost;		// charge host time to parts of Nachos?
+    char *snapshotFile;		// snapshot to start from, or NULL
+    char *recordFile;		// file to record input in, or NULL
+    char *playFile;		// file to play input back from, or NULL
 #ifndef FILESYS_STUB
     bool formatFlag;          // format the disk if this is true
 #endif
@@ -2,18 +2,54 @@
 //	Driver code to initialize, selftest, and run the 
 //	operating system kernel.  
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -sp <policy> -sh <#> -pt -di
+//              -mp <# of CPUs> -mem <# of pages> -so <stats file>
+//              -sd <stats file> -hp
+//              -ss <snapshot file> -ls <snapshot file>
+//              -rec <input log> -play <input log>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
 //              -z -K -C -N
+//              -B <manifest> -bj <# of workers> -bo <results file>
+//              -br <# of runs> -bs <summary file> -bb <baseline file>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp picks the scheduling policy: fifo, mlfq (the default), stride
+//	or lottery
+//    -sh sets how many free thread stacks of each size to keep for re-use
+//    -pt makes the timer interrupt every time slice, even when there is
+//	nothing for it to do (by default, it is only set when needed)
+//    -di only passes console and network input on to the kernel when
+//	it has nothing else to do, so that runs with the same input are
+//	the same, however fast the input comes in
+//    -mp simulates an interleaved multiprocessor, with the given number
+//	of CPUs, in simulated time only; they take turns on the one host
+//	thread, so this shows how threads are scheduled across CPUs, not
+//	Nachos running in parallel
+//    -mem limits user programs to the given number of physical pages
+//    -so saves the statistics in a file, as one line of CSV, at halt
+//    -sd dumps all the statistics -- counters, latency histograms, and
+//	the per-thread and per-program records -- in a file, as JSON if
+//	its name ends in .json and as CSV otherwise, at halt and whenever
+//	Nachos gets SIGUSR1
+//    -hp profiles Nachos itself: prints, at halt, how much host time went
+//	to executing user instructions, interrupts, exceptions, context
+//	switches and disk emulation (see hostprofile.h)
+//    -ss saves a snapshot of the machine in a file, once the kernel is
+//	set up (after any file system flags), before running a program
+//    -ls starts from a snapshot saved by -ss, rather than from scratch
+//	(see snapshot.h)
+//    -rec records the input that comes in from the host (console,
+//	network, random seed) in a log
+//    -play plays back a log made by -rec, instead of taking input from
+//	the host, to repeat the recorded run exactly (see inputlog.h)
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
-//    -x runs a user program
+//    -x runs a user program; when the last program exits, Nachos
+//	exits with the same status
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
@@ -22,6 +58,18 @@
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
 //
+//    Batch flags (see batch.h):
+//    -B runs each job listed in the manifest, in a kernel of its own;
+//	any other flags are passed on to every job
+//    -bj sets how many jobs run at once (default: one per host CPU)
+//    -bo writes the jobs' statistics to a file (".json" for JSON,
+//	otherwise CSV), rather than stdout
+//    -br runs each job that many times, and prints a summary of how
+//	fast the runs went (see "make bench" in test/Makefile)
+//    -bs writes that summary to a file, as CSV
+//    -bb compares the summary with one written earlier by -bs, and
+//	counts any job that got slower as failed
+//
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
 //    -cp copies a file from UNIX to Nachos
@@ -45,6 +93,10 @@
 #include "filesys.h"
 #include "openfile.h"
 #include "sysdep.h"
+#include "proctable.h"
+#include "filetable.h"
+#include "batch.h"
+#include "snapshot.h"
 
 #ifdef TUT
 
@@ -162,7 +214,7 @@ Print(char *name)
 
 
 //----------------------------------------------------------------------
-// main
+// RunKernel
 // 	Bootstrap the operating system kernel.  
 //	
 //	Initialize kernel data structures
@@ -175,8 +227,8 @@ Print(char *name)
 //		ex: "nachos -d +" -> argv = {"nachos", "-d", "+"}
 //----------------------------------------------------------------------
 
-int
-main(int argc, char **argv)
+static int
+RunKernel(int argc, char **argv)
 {
     int i;
     char *debugArg = "";
@@ -184,6 +236,7 @@ main(int argc, char **argv)
     bool threadTestFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    char *snapshotName = NULL;        // where to save a snapshot
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
@@ -219,6 +272,11 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-N") == 0) {
 	    networkTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-ss") == 0) {
+	    ASSERT(i + 1 < argc);
+	    snapshotName = argv[i + 1];
+	    i++;
+	}
 #ifndef FILESYS_STUB
 	else if (strcmp(argv[i], "-cp") == 0) {
 	    ASSERT(i + 2 < argc);
@@ -247,6 +305,9 @@ main(int argc, char **argv)
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
 	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+	    cout << "Partial usage: nachos [-ss snapshotFile]\n";
+	    cout << "Partial usage: nachos [-B manifest [-bj #] [-bo file]]\n";
+	    cout << "Partial usage: nachos [-B manifest [-br #] [-bs file] [-bb file]]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
@@ -301,11 +362,20 @@ main(int argc, char **argv)
     }
 #endif // FILESYS_STUB
 
+    // the kernel is set up: save it, if asked, to start other runs from
+    if (snapshotName != NULL) {
+      Snapshot::Save(snapshotName);
+    }
+
     // finally, run an initial user program if requested to do so
     if (userProgName != NULL) {
       AddrSpace *space = new AddrSpace;
       ASSERT(space != (AddrSpace *)NULL);
       if (space->Load(userProgName)) {  // load the program into the space
+	Process *process = kernel->processTable->Create(NULL, space);
+	space->setSpaceId(process->id);
+	process->files = new FileTable();
+	kernel->processTable->AddThread(process, kernel->currentThread);
 	space->Execute();              // run the program
 	ASSERTNOTREACHED();            // Execute never returns
       }
@@ -320,3 +390,23 @@ main(int argc, char **argv)
     ASSERTNOTREACHED();
 }
 
+//----------------------------------------------------------------------
+// main
+// 	Run the kernel -- or, given a batch of jobs ("-B"), run the
+//	kernel once for each of them, in a process of its own.
+//----------------------------------------------------------------------
+
+int
+main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-B") == 0) {
+	    BatchRunner *batch = new BatchRunner(argc, argv);
+	    int failed = batch->Run(RunKernel);
+
+	    delete batch;
+	    return (failed == 0) ? 0 : 1;
+	}
+    }
+    return RunKernel(argc, argv);
+}
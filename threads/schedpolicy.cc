@@ -0,0 +1,432 @@
+// schedpolicy.cc
+//	Routines for the scheduling policies: which ready thread runs
+//	next, and when the running thread should give up the CPU.
+//
+//	These routines assume that interrupts are already disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "schedpolicy.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// SchedPolicy::Create
+// 	Make a new scheduling policy, by name (see schedpolicy.h for
+//	the choices).  Return NULL if "name" is not a policy we know.
+//----------------------------------------------------------------------
+
+SchedPolicy *
+SchedPolicy::Create(char *name)
+{
+    if (strcmp(name, "fifo") == 0) {
+	return new FifoPolicy();
+    } else if (strcmp(name, "mlfq") == 0) {
+	return new MlfqPolicy();
+    } else if (strcmp(name, "stride") == 0) {
+	return new StridePolicy(FALSE);
+    } else if (strcmp(name, "lottery") == 0) {
+	return new StridePolicy(TRUE);
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SchedPolicy::InsertAll
+// 	Make a whole queue of threads ready, in order.  A policy that
+//	keeps its ready threads in one FIFO queue can do this by splicing
+//	the queues together; others have to put each thread in its place.
+//----------------------------------------------------------------------
+
+void
+SchedPolicy::InsertAll(ThreadQueue *threads)
+{
+    Thread *thread;
+
+    while ((thread = threads->RemoveFront()) != NULL) {
+	Insert(thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// Quantum
+// 	The number of timer interrupts a thread at "level" may run for,
+//	before it is moved down: one at the top, doubling at each level.
+//----------------------------------------------------------------------
+
+static int
+Quantum(int level)
+{
+    return 1 << level;
+}
+
+//----------------------------------------------------------------------
+// Level
+// 	The level "thread" runs at: its own, or that of the best thread
+//	waiting for a lock it holds, if that is higher.
+//----------------------------------------------------------------------
+
+static int
+Level(Thread *thread)
+{
+    return min(thread->schedLevel, thread->inheritedLevel);
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::MlfqPolicy
+// 	Initialize a multi-level feedback queue, with no ready threads.
+//----------------------------------------------------------------------
+
+MlfqPolicy::MlfqPolicy()
+{
+    nonEmpty = 0;
+    ticksToBoost = MlfqBoostPeriod;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Insert
+// 	Put "thread" at the end of the queue for its level.
+//----------------------------------------------------------------------
+
+void
+MlfqPolicy::Insert(Thread *thread)
+{
+    int level = Level(thread);
+
+    ASSERT(level >= 0 && level < MlfqLevels);
+    ready[level].Append(thread);
+    nonEmpty |= 1 << level;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Remove
+// 	Take the first thread off the highest level that has one.
+//----------------------------------------------------------------------
+
+Thread *
+MlfqPolicy::Remove()
+{
+    int level;
+    Thread *thread;
+
+    if (nonEmpty == 0) {
+	return NULL;
+    }
+    level = __builtin_ffs(nonEmpty) - 1;	// lowest bit set
+    thread = ready[level].RemoveFront();
+    if (ready[level].IsEmpty()) {
+	nonEmpty &= ~(1 << level);
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Preempts
+// 	A thread woken up at a higher level than the running thread
+//	should not have to wait for the running thread's quantum.
+//----------------------------------------------------------------------
+
+bool
+MlfqPolicy::Preempts(Thread *thread, Thread *running)
+{
+    return Level(thread) < Level(running);
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Tick
+// 	Charge the running thread for a timer interrupt.  It gives up
+//	the CPU when its quantum is used up (and moves down a level),
+//	or when a thread at a higher level is ready.
+//
+//	Also, every MlfqBoostPeriod interrupts, move everything back
+//	to the top level, so that a thread that has sunk to the bottom
+//	can not be starved by a steady stream of threads above it.
+//----------------------------------------------------------------------
+
+bool
+MlfqPolicy::Tick(Thread *running, int ticks)
+{
+    if (--ticksToBoost == 0) {
+	Boost(running);
+	ticksToBoost = MlfqBoostPeriod;
+    }
+    if (++running->schedTicks >= Quantum(running->schedLevel)) {
+	running->schedTicks = 0;
+	if (running->schedLevel < MlfqLevels - 1) {
+	    running->schedLevel++;
+	}
+	DEBUG(dbgThread, "Quantum expired: " << running->getName() <<
+			 " now at level " << running->schedLevel);
+	return TRUE;
+    }
+    return (nonEmpty & ((1 << Level(running)) - 1)) != 0;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Blocked
+// 	"thread" is going to sleep before using up its quantum, so it is
+//	behaving like an I/O bound thread: move it up a level, with a
+//	fresh quantum.
+//----------------------------------------------------------------------
+
+void
+MlfqPolicy::Blocked(Thread *thread)
+{
+    if (thread->schedLevel > 0) {
+	thread->schedLevel--;
+    }
+    thread->schedTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Inherited
+// 	"thread" has inherited a new level through a lock.  If it is
+//	ready, move it to the queue for that level.
+//----------------------------------------------------------------------
+
+void
+MlfqPolicy::Inherited(Thread *thread)
+{
+    for (int level = 0; level < MlfqLevels; level++) {
+	if (ready[level].Remove(thread)) {
+	    if (ready[level].IsEmpty()) {
+		nonEmpty &= ~(1 << level);
+	    }
+	    Insert(thread);
+	    return;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Boost
+// 	Move the running thread and all the ready threads to level 0,
+//	keeping the ready threads in priority order.
+//----------------------------------------------------------------------
+
+static void
+MoveToTop(Thread *thread)
+{
+    thread->schedLevel = 0;
+    thread->schedTicks = 0;
+}
+
+void
+MlfqPolicy::Boost(Thread *running)
+{
+    DEBUG(dbgThread, "Moving all threads to the top level");
+    MoveToTop(running);
+    for (int level = 1; level < MlfqLevels; level++) {
+	ready[level].Apply(MoveToTop);
+	ready[0].Concatenate(&ready[level]);
+    }
+    nonEmpty = ready[0].IsEmpty() ? 0 : 1;
+}
+
+//----------------------------------------------------------------------
+// MlfqPolicy::Apply
+// 	Call "f" on each ready thread, highest level first.
+//----------------------------------------------------------------------
+
+void
+MlfqPolicy::Apply(void (*f)(Thread *))
+{
+    for (int level = 0; level < MlfqLevels; level++) {
+	ready[level].Apply(f);
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadTickets
+// 	Return the number of tickets "thread" holds, for proportional
+//	share scheduling.
+//----------------------------------------------------------------------
+
+int
+ThreadTickets(Thread *thread)
+{
+    if (thread->getTickets() > 0) {
+	return thread->getTickets();
+    }
+    if (thread->space != NULL && thread->space->getTickets() > 0) {
+	return thread->space->getTickets();
+    }
+    return DefaultTickets;
+}
+
+//----------------------------------------------------------------------
+// PassBefore
+// 	Is pass value "a" earlier than "b"?  Pass values are allowed to
+//	wrap around, so compare the difference, not the values.
+//----------------------------------------------------------------------
+
+static bool
+PassBefore(unsigned int a, unsigned int b)
+{
+    return (int) (a - b) < 0;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::StridePolicy
+// 	Initialize a proportional share policy, with no ready threads.
+//----------------------------------------------------------------------
+
+StridePolicy::StridePolicy(bool drawLots)
+{
+    lottery = drawLots;
+    size = 8;
+    ready = new Thread *[size];
+    numReady = 0;
+    passNow = 0;
+}
+
+StridePolicy::~StridePolicy()
+{
+    delete [] ready;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::SiftUp, SiftDown
+// 	The usual binary heap routines: move ready[i] up or down the
+//	heap until it is in order by pass.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::SiftUp(int i)
+{
+    Thread *thread = ready[i];
+
+    while (i > 0 && PassBefore(thread->pass, ready[(i - 1) / 2]->pass)) {
+	ready[i] = ready[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    ready[i] = thread;
+}
+
+void
+StridePolicy::SiftDown(int i)
+{
+    Thread *thread = ready[i];
+    int child;
+
+    while ((child = 2 * i + 1) < numReady) {
+	if (child + 1 < numReady &&
+		PassBefore(ready[child + 1]->pass, ready[child]->pass)) {
+	    child++;
+	}
+	if (!PassBefore(ready[child]->pass, thread->pass)) {
+	    break;
+	}
+	ready[i] = ready[child];
+	i = child;
+    }
+    ready[i] = thread;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Insert
+// 	Add "thread" to the ready threads.  If it fell behind while it
+//	was asleep (or is new), it starts again from the current pass,
+//	rather than getting the CPU to itself until it has caught up.
+//
+//	A thread can only get a little way ahead of the current pass by
+//	running; one that is further ahead got its pass under another
+//	policy (see Scheduler::SetPolicy), and it starts again from the
+//	current pass too, rather than waiting for everyone else to catch
+//	up with it.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Insert(Thread *thread)
+{
+    unsigned int stride = StrideOne / ThreadTickets(thread);
+
+    if (numReady == size) {		// out of room: double the array
+	Thread **bigger = new Thread *[2 * size];
+	for (int i = 0; i < numReady; i++) {
+	    bigger[i] = ready[i];
+	}
+	delete [] ready;
+	ready = bigger;
+	size *= 2;
+    }
+    if (PassBefore(thread->pass, passNow) ||
+	    PassBefore(passNow + StrideMaxAhead * stride, thread->pass)) {
+	thread->pass = passNow;
+    }
+    ready[numReady++] = thread;
+    if (!lottery) {
+	SiftUp(numReady - 1);
+    }
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Remove
+// 	Take the next thread to run off the ready threads: for stride,
+//	the one with the lowest pass; for lottery, the holder of a
+//	ticket drawn at random.
+//----------------------------------------------------------------------
+
+Thread *
+StridePolicy::Remove()
+{
+    Thread *thread;
+    int i = 0;
+
+    if (numReady == 0) {
+	return NULL;
+    }
+    if (lottery) {
+	int total = 0, ticket;
+
+	for (i = 0; i < numReady; i++) {
+	    total += ThreadTickets(ready[i]);
+	}
+	ticket = RandomNumber() % total;
+	for (i = 0; ticket >= ThreadTickets(ready[i]); i++) {
+	    ticket -= ThreadTickets(ready[i]);
+	}
+    }
+    thread = ready[i];
+    ready[i] = ready[--numReady];
+    if (!lottery && numReady > 0) {
+	SiftDown(0);
+    }
+    passNow = thread->pass;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Ran
+// 	Charge a thread for the "ticks" it just ran, whether it was cut
+//	short by a timer interrupt (after which Tick picks again) or gave
+//	up the CPU itself.  A stride pays for TimerTicks of time: quanta
+//	vary in length, and charging a whole stride for each, however
+//	short, would skew the shares -- while charging nothing would let
+//	a thread that yields often run ahead of its share.  The product
+//	of stride and ticks is taken in 64 bits: a thread with few
+//	tickets that ran a few thousand ticks would overflow an int.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Ran(Thread *thread, int ticks)
+{
+    long long stride = StrideOne / ThreadTickets(thread);
+
+    thread->pass += (unsigned int) (stride * ticks / TimerTicks);
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Apply
+// 	Call "f" on each ready thread (in no particular order).
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Apply(void (*f)(Thread *))
+{
+    for (int i = 0; i < numReady; i++) {
+	(*f)(ready[i]);
+    }
+}
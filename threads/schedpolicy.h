@@ -0,0 +1,175 @@
+// schedpolicy.h
+//	Data structures for the policies the scheduler can use to decide
+//	which ready thread runs next.
+//
+//	The Scheduler does the mechanics of dispatching -- context
+//	switches, deleting finished threads -- and leaves the choice of
+//	thread to a SchedPolicy.  A policy keeps the ready threads however
+//	it likes, and is told about the events it might care about: a
+//	timer interrupt while a thread is running, the time a thread ran
+//	before it gave up the CPU, and a thread blocking.
+//
+//	Four policies are provided:
+//	  "fifo" -- the original Nachos policy: one queue, round robin.
+//	  "mlfq" -- a multi-level feedback queue.  A thread that uses up
+//		its quantum moves down a level, and gets a longer quantum
+//		next time; a thread that blocks moves up a level.  So I/O
+//		bound threads stay near the top, and run as soon as they
+//		are woken, ahead of CPU bound threads.  Every so often all
+//		threads are moved back to the top, so that no thread starves.
+//		A thread holding a lock that a higher thread is waiting for
+//		runs at the waiter's level (priority inheritance; see
+//		Lock::Acquire) until it releases the lock.
+//	  "stride" -- proportional share: each thread gets a share of the
+//		CPU in proportion to its tickets.  Each thread has a pass
+//		value, advanced by a stride inversely proportional to its
+//		tickets for every TimerTicks it runs (whether or not it
+//		lasts until a timer interrupt); the thread with the lowest
+//		pass runs next.
+//	  "lottery" -- proportional share, by drawing a ticket at random
+//		for each quantum.  Shares are only right on average, but
+//		there is no state to get stale.
+//
+//	A thread's tickets are its own, if set (Thread::setTickets), or
+//	else those of its address space (the SetTickets system call), or
+//	else DefaultTickets.
+//
+//	All of these routines are called with interrupts disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SCHEDPOLICY_H
+#define SCHEDPOLICY_H
+
+#include "copyright.h"
+#include "thread.h"
+
+#define MlfqLevels	4	// # of priority levels
+#define MlfqBoostPeriod	50	// # of timer interrupts between moving
+				// every thread back to the top level
+
+#define DefaultTickets	100	// tickets of a thread nobody set any for
+#define MaxTickets	10000	// most tickets a thread may have
+#define StrideOne	(1 << 20)	// stride of a thread with one ticket
+#define StrideMaxAhead	4	// # of strides a ready thread can be
+				// ahead of the current pass
+
+// The following class defines the interface every scheduling policy
+// provides to the Scheduler.
+
+class SchedPolicy {
+  public:
+    static SchedPolicy *Create(char *name);
+				// Return a new policy called "name",
+				// or NULL if there is no such policy
+    virtual ~SchedPolicy() {}
+    virtual SchedPolicy *Clone() = 0;
+				// Return a new policy of the same kind,
+				// with no ready threads (one for each CPU)
+
+    virtual void Insert(Thread *thread) = 0;
+				// "thread" is ready to run
+    virtual void InsertAll(ThreadQueue *threads);
+				// All of "threads" are ready to run;
+				// leaves "threads" empty
+    virtual Thread *Remove() = 0;
+				// Take the thread that should run next
+				// off the ready threads; NULL if none
+    virtual bool Preempts(Thread *thread, Thread *running) {
+	return FALSE; }		// Should "thread", which just became ready,
+				// run right away instead of "running"?
+    virtual bool Tick(Thread *running, int ticks) { return TRUE; }
+				// A timer interrupt went off while
+				// "running" was running, "ticks" after
+				// it started or was last interrupted;
+				// return TRUE if it should give up the CPU
+    virtual void Ran(Thread *thread, int ticks) {}
+				// "thread" has run for another "ticks"
+				// (called before Tick, and before the
+				// thread yields or blocks)
+    virtual void Blocked(Thread *thread) {}
+				// "thread" is going to sleep
+    virtual void Inherited(Thread *thread) {}
+				// "thread"'s inheritedLevel has changed
+    virtual void Apply(void (*f)(Thread *)) = 0;
+				// Call "f" on each ready thread
+};
+
+// The original Nachos policy: round robin, on every timer interrupt.
+
+class FifoPolicy : public SchedPolicy {
+  public:
+    SchedPolicy *Clone() { return new FifoPolicy(); }
+    void Insert(Thread *thread) { ready.Append(thread); }
+    void InsertAll(ThreadQueue *threads) { ready.Concatenate(threads); }
+    Thread *Remove() { return ready.RemoveFront(); }
+    void Apply(void (*f)(Thread *)) { ready.Apply(f); }
+
+  private:
+    ThreadQueue ready;		// ready threads, in the order they
+				// became ready
+};
+
+// A multi-level feedback queue.  Finding the thread to run takes the
+// same time however many threads are ready: "nonEmpty" has a bit set
+// for each level with a ready thread, and the lowest bit set gives
+// the level to take from.
+
+class MlfqPolicy : public SchedPolicy {
+  public:
+    MlfqPolicy();
+    SchedPolicy *Clone() { return new MlfqPolicy(); }
+
+    void Insert(Thread *thread);
+    Thread *Remove();
+    bool Preempts(Thread *thread, Thread *running);
+    bool Tick(Thread *running, int ticks);
+    void Blocked(Thread *thread);
+    void Inherited(Thread *thread);
+    void Apply(void (*f)(Thread *));
+
+  private:
+    ThreadQueue ready[MlfqLevels];	// ready threads at each level
+    unsigned int nonEmpty;		// bit i set iff ready[i] is not empty
+    int ticksToBoost;			// timer interrupts until the next
+					// move back to the top
+
+    void Boost(Thread *running);	// Move every thread to level 0
+};
+
+// Stride scheduling, or lottery scheduling.  For stride, the ready
+// threads are kept in a heap, ordered by pass; for lottery, the same
+// array is just a set, searched for the winning ticket.
+
+class StridePolicy : public SchedPolicy {
+  public:
+    StridePolicy(bool lottery);	// "lottery" -- draw lots, instead of
+				// using strides
+    ~StridePolicy();
+    SchedPolicy *Clone() { return new StridePolicy(lottery); }
+
+    void Insert(Thread *thread);
+    Thread *Remove();
+    bool Tick(Thread *running, int ticks) { return TRUE; }
+    void Ran(Thread *thread, int ticks);
+    void Apply(void (*f)(Thread *));
+
+  private:
+    bool lottery;		// draw lots?
+    Thread **ready;		// the ready threads (a heap, for stride)
+    int numReady;		// # of entries in use
+    int size;			// # of entries allocated
+    unsigned int passNow;	// pass of the thread picked most recently;
+				// a thread that has been asleep catches up
+				// to here, so it can not bank CPU time
+
+    void SiftUp(int i);		// restore the heap after ready[i] moved
+    void SiftDown(int i);
+};
+
+extern int ThreadTickets(Thread *thread);
+				// # of tickets "thread" has
+
+#endif // SCHEDPOLICY_H
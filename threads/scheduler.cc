@@ -4,15 +4,16 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor, or a simulated multiprocessor
+//	that never switches CPUs while interrupts are disabled).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	The choice of which ready thread to run is left to a SchedPolicy
+//	(see schedpolicy.h); the scheduler just does the dispatching.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,51 +23,282 @@
 #include "debug.h"
 #include "scheduler.h"
 #include "main.h"
+#include "synch.h"
+#include "hostprofile.h"
+
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Initialize a CPU, idle, with no ready threads.
+//
+//	"cpuId" is its number.
+//	"readyPolicy" is the policy to pick its threads with; the CPU
+//		deletes it.
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int cpuId, SchedPolicy *readyPolicy)
+{
+    id = cpuId;
+    running = NULL;
+    policy = readyPolicy;
+    numReady = 0;
+    idle = TRUE;
+    clock = idleTicks = 0;
+    lastSwitch = lastIdle = 0;
+    pendingIpis = 0;
+    numIpis = numSteals = 0;
+}
+
+Cpu::~Cpu()
+{
+    delete policy;
+}
+
+//----------------------------------------------------------------------
+// Cpu::CatchUp
+// 	An idle CPU has been given something to do.  It has been idle
+//	from when it stopped (by its own clock) until "now".  (If it is
+//	ahead of "now" already, leave it be.)
+//----------------------------------------------------------------------
+
+void
+Cpu::CatchUp(long long now)
+{
+    if (clock < now) {
+	idleTicks += now - clock;
+	clock = now;
+    }
+}
+
+//----------------------------------------------------------------------
+// Cpu::Print
+// 	Print how busy the CPU was, and how much it had to do with the
+//	other CPUs.
+//----------------------------------------------------------------------
+
+void
+Cpu::Print()
+{
+    cout << "CPU " << id << ": busy " << clock - idleTicks
+	 << ", idle " << idleTicks << ", steals " << numSteals
+	 << ", IPIs " << numIpis << "\n";
+}
 
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
-//	Initially, no ready threads.
+//	Initially, no ready threads, and the current thread is running
+//	on the first CPU.
+//
+//	"p" is the policy to pick threads with; the scheduler deletes it.
+//	"n" is how many CPUs to simulate.  Each gets a policy of the
+//		same kind as "p".
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedPolicy *p, int n)
 { 
-    readyList = new List<Thread *>; 
+    ASSERT(n >= 1 && n <= MaxCpus);
+    numCpus = n;
+    for (int i = 0; i < numCpus; i++) {
+	cpus[i] = new Cpu(i, (i == 0) ? p : p->Clone());
+    }
+    current = cpus[0];
+    current->running = kernel->currentThread;
+    current->idle = FALSE;
+    kernel->currentThread->cpu = 0;
     toBeDestroyed = NULL;
+    numReady = 0;
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < numCpus; i++) {
+	delete cpus[i];
+    }
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::Place
+// 	Choose the CPU "thread" should wait on for its turn: the one it
+//	last ran on (or, if it is new, the one that made it), unless
+//	that one is busy and another CPU has nothing to do.
+//----------------------------------------------------------------------
+
+Cpu *
+Scheduler::Place(Thread *thread)
+{
+    Cpu *home = (thread->cpu >= 0) ? cpus[thread->cpu] : current;
+
+    if (home->idle || thread == kernel->currentThread) {
+	return home;		// a yielding thread stays put
+    }
+    for (int i = 0; i < numCpus; i++) {
+	if (cpus[i]->idle) {
+	    return cpus[i];
+	}
+    }
+    return home;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	If an interrupt handler (a device finishing, say) wakes up a
+//	thread the policy would rather run than the interrupted one,
+//	switch to it as soon as the handler returns.
+//
+//	If "thread" is the one running (it is yielding), it is charged
+//	for the time it ran first, so the policy files it under the
+//	right pass (or whatever else the policy goes by).
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
-    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    Interrupt *interrupt = kernel->interrupt;
+    Cpu *cpu;
+
+    if (thread == kernel->currentThread) {	// yielding: settle up
+	Charge(thread);				// before the policy sees it
+    }
+    cpu = Place(thread);
+
+    ASSERT(interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append(thread);
+    thread->waitingIn = NULL;		// it is no longer on a wait queue
+    thread->readySince = kernel->stats->totalTicks;
+    thread->cpu = cpu->id;
+    cpu->policy->Insert(thread);
+    cpu->numReady++;
+    if (cpu->idle) {			// give it something to do
+	cpu->idle = FALSE;
+	cpu->CatchUp(kernel->stats->totalTicks);
+	if (cpu != current) {
+	    cpu->numIpis++;		// (a wakeup IPI)
+	}
+    }
+    if (numReady++ == 0) {
+	kernel->alarm->Reprogram();	// time slicing may be needed now
+    }
+    if (cpu != current) {
+	if (cpu->running != NULL
+		&& cpu->policy->Preempts(thread, cpu->running)) {
+	    SendIpi(cpu, IpiReschedule);
+	}
+    } else if (interrupt->inInterruptHandler()
+		&& interrupt->getStatus() != IdleMode
+		&& cpu->policy->Preempts(thread, kernel->currentThread)) {
+	interrupt->YieldOnReturn();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ReadyToRunAll
+// 	Mark a whole queue of threads (everyone waiting on a condition,
+//	say) as ready, and hand them to the policy in one go, rather than
+//	one at a time.
+//
+//	"threads" is the queue to empty onto the ready list.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ReadyToRunAll(ThreadQueue *threads)
+{
+    Interrupt *interrupt = kernel->interrupt;
+    bool mayPreempt = interrupt->inInterruptHandler()
+			&& interrupt->getStatus() != IdleMode;
+    bool wasEmpty = (numReady == 0);
+    Thread *t;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (numCpus > 1) {			// each goes to its own CPU
+	while ((t = threads->RemoveFront()) != NULL) {
+	    ReadyToRun(t);
+	}
+	return;
+    }
+    for (t = threads->Front(); t != NULL; t = t->queueNext) {
+	DEBUG(dbgThread, "Putting thread on ready list: " << t->getName());
+	t->setStatus(READY);
+	t->waitingIn = NULL;
+	t->readySince = kernel->stats->totalTicks;
+	t->cpu = current->id;
+	numReady++;
+	current->numReady++;
+	if (mayPreempt && current->policy->Preempts(t, kernel->currentThread)) {
+	    interrupt->YieldOnReturn();
+	    mayPreempt = FALSE;
+	}
+    }
+    if (current->idle && !threads->IsEmpty()) {
+	current->idle = FALSE;
+	current->CatchUp(kernel->stats->totalTicks);
+    }
+    current->policy->InsertAll(threads);
+    if (wasEmpty && numReady > 0) {
+	kernel->alarm->Reprogram();	// time slicing may be needed now
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TakeReady
+// 	Take the next thread for "cpu" to run off its ready list.  If it
+//	has none, steal one from the CPU with the most (work stealing).
+//	Return NULL if no CPU has a ready thread.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::TakeReady(Cpu *cpu)
+{
+    Cpu *victim = cpu;
+    Thread *thread;
+
+    for (int i = 0; i < numCpus && cpu->numReady == 0; i++) {
+	if (cpus[i]->numReady > 0 && (victim == cpu
+			|| cpus[i]->numReady > victim->numReady)) {
+	    victim = cpus[i];
+	}
+    }
+    thread = victim->policy->Remove();
+    if (thread == NULL) {
+	return NULL;
+    }
+    if (victim != cpu) {
+	DEBUG(dbgThread, "CPU " << cpu->id << " stealing "
+			 << thread->getName() << " from CPU " << victim->id);
+	cpu->numSteals++;
+    }
+    victim->numReady--;
+    numReady--;
+    if (victim != current && victim->running == NULL
+				&& victim->numReady == 0) {
+	victim->idle = TRUE;		// it was woken up for nothing
+    }
+    if (cpu->idle) {
+	cpu->idle = FALSE;
+	cpu->CatchUp(kernel->stats->totalTicks);
+    }
+    return thread;
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 // 	Return the next thread to be scheduled onto the CPU.
 //	If there are no ready threads, return NULL.
+//
+//	On a multiprocessor, if there is nothing for this CPU to run,
+//	it goes idle, and we return the thread to run on some other CPU
+//	that has something to do (which becomes the current CPU).
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -74,15 +306,131 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
+    Thread *thread;
+    Cpu *cpu;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-	return NULL;
-    } else {
-    	return readyList->RemoveFront();
+    thread = TakeReady(current);
+    if (thread != NULL) {
+	return thread;
+    }
+    current->idle = TRUE;
+    current->running = NULL;
+    while ((cpu = Laggard()) != NULL) {
+	thread = (cpu->running != NULL) ? cpu->running : TakeReady(cpu);
+	if (thread != NULL) {
+	    DEBUG(dbgThread, "CPU " << current->id << " idle, running CPU "
+			     << cpu->id);
+	    current = cpu;
+	    return thread;
+	}
+	cpu->idle = TRUE;		// another CPU stole its thread
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Tick
+// 	Called by the timer interrupt handler, while a thread is running.
+//	Let the policy charge the thread for the time it has run since
+//	the last context switch or timer interrupt, and decide whether
+//	it is time for a context switch.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Tick()
+{
+    Thread *running = kernel->currentThread;
+    long long before = running->cpuTicks;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    Charge(running);
+    return current->policy->Tick(running, running->cpuTicks - before);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Blocked
+// 	Tell the policy that "thread" is going to sleep, waiting for
+//	something other than the CPU -- after charging it for the time
+//	it ran.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Blocked(Thread *thread)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    Charge(thread);
+    cpus[thread->cpu]->policy->Blocked(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Inherited
+// 	Tell the policy that "thread" has inherited a new priority from
+//	the threads waiting for its locks (or lost it, by releasing one).
+//----------------------------------------------------------------------
+
+void
+Scheduler::Inherited(Thread *thread)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (thread->cpu >= 0) {		// (not, if it has never run)
+	cpus[thread->cpu]->policy->Inherited(thread);
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::Preempts
+// 	Return TRUE if "thread", which is ready, should run instead of
+//	the current thread.  (If it is waiting for another CPU, it is
+//	up to that one.)
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Preempts(Thread *thread)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    return thread->cpu == current->id
+		&& current->policy->Preempts(thread, kernel->currentThread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetPolicy
+// 	Start using "newPolicy" to pick threads, handing it the threads
+//	that are ready now.  Return the old policy, so the caller can
+//	delete it, or put it back later.
+//
+//	The first CPU gets "newPolicy" itself; any others get one of
+//	the same kind, and their old ones are deleted here.
+//----------------------------------------------------------------------
+
+SchedPolicy *
+Scheduler::SetPolicy(SchedPolicy *newPolicy)
+{
+    SchedPolicy *oldPolicy = cpus[0]->policy;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *thread;
+
+    for (int i = 0; i < numCpus; i++) {
+	SchedPolicy *from = cpus[i]->policy;
+	SchedPolicy *to = (i == 0) ? newPolicy : newPolicy->Clone();
+
+	while ((thread = from->Remove()) != NULL) {
+	    to->Insert(thread);
+	}
+	cpus[i]->policy = to;
+	if (i > 0) {
+	    delete from;
+	}
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return oldPolicy;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Run
 // 	Dispatch the CPU to nextThread.  Save the state of the old thread,
@@ -104,6 +452,7 @@ void
 Scheduler::Run (Thread *nextThread, bool finishing)
 {
     Thread *oldThread = kernel->currentThread;
+    long long waited;
     
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
@@ -119,18 +468,32 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
+    Charge(oldThread);
+    if (numReady == 0) {		// no one left to time slice with
+	kernel->alarm->Reprogram();
+    }
 
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
+    waited = max(kernel->stats->totalTicks - nextThread->readySince, 0LL);
+    kernel->stats->dispatchLatency.Record(waited);
+    nextThread->readyTicks += waited;
+    nextThread->dispatches++;
+    nextThread->cpu = current->id;
+    current->running = nextThread;
     
-    DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
+    DEBUG(dbgThread, "Switching from: " << oldThread->getName()
+	  << " to: " << nextThread->getName());
     
     // This is a machine-dependent assembly language routine defined 
     // in switch.s.  You may have to think
     // a bit to figure out what happens after this, both from the point
     // of view of the thread and from the perspective of the "outside world".
 
-    SWITCH(oldThread, nextThread);
+    {
+	HostTimer timer(HostSwitch);	// until oldThread runs again
+	SWITCH(oldThread, nextThread);
+    }
 
     // we're back, running oldThread
       
@@ -166,6 +529,63 @@ Scheduler::CheckToBeDestroyed()
     }
 }
  
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Add the time since the last context switch to the time "thread"
+//	has spent running, not counting any time the CPU was idle, and
+//	tell the policy.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    Cpu *cpu = cpus[thread->cpu];
+    int ticks = (int) ((cpu->clock - cpu->lastSwitch)
+				- (cpu->idleTicks - cpu->lastIdle));
+
+    thread->cpuTicks += ticks;
+    cpu->lastSwitch = cpu->clock;
+    cpu->lastIdle = cpu->idleTicks;
+    cpu->policy->Ran(thread, ticks);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ReportThread
+// 	The current thread is about to finish (or the machine is about
+//	to halt under it).  Add the time it spent running and waiting
+//	to run to the statistics printed at Halt, under its name and
+//	under the program it ran, if any.  If someone gave it tickets,
+//	also record the share of the CPU it actually achieved.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ReportThread(Thread *thread)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    ThreadRecord *record;
+    SpaceRecord *program = thread->programStats;
+
+    ASSERT(thread == kernel->currentThread);
+    Charge(thread);
+    if (thread->getTickets() > 0) {
+	kernel->stats->RecordShare(thread->getName(), thread->getTickets(),
+				   thread->cpuTicks);
+    }
+    record = kernel->stats->FindThread(thread->getName());
+    record->threads++;
+    record->cpuTicks += thread->cpuTicks;
+    record->userTicks += thread->userTicks;
+    record->readyTicks += thread->readyTicks;
+    record->dispatches += thread->dispatches;
+    if (program != NULL) {
+	program->threads++;
+	program->cpuTicks += thread->cpuTicks;
+	program->userTicks += thread->userTicks;
+	program->syscalls += thread->syscalls;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
@@ -175,5 +595,395 @@ void
 Scheduler::Print()
 {
     cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    for (int i = 0; i < numCpus; i++) {
+	if (numCpus > 1) {
+	    cout << "CPU " << i << ": ";
+	}
+	cpus[i]->policy->Apply(ThreadPrint);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Advance
+// 	The current CPU has run for another "ticks" ticks.  Simulated
+//	time is the clock of the CPU that is furthest behind, of those
+//	that have something to do (idle CPUs catch up when they are
+//	given something).
+//
+//	Time can also be moved on by Interrupt::CheckIfDue, as if the
+//	machine had been idle; a CPU left behind by that catches up too.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Advance(int ticks)
+{
+    Statistics *stats = kernel->stats;
+    long long now;
+
+    if (numCpus == 1) {
+	stats->totalTicks += ticks;
+	current->clock = stats->totalTicks;
+	return;
+    }
+    current->CatchUp(stats->totalTicks);
+    current->clock += ticks;
+    now = current->clock;
+    for (int i = 0; i < numCpus; i++) {
+	if (!cpus[i]->idle) {
+	    cpus[i]->CatchUp(stats->totalTicks);
+	    now = min(now, cpus[i]->clock);
+	}
+    }
+    stats->totalTicks = now;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Laggard
+// 	Return the CPU, other than the current one, that has something
+//	to do and has got least far, or NULL if there isn't one.
+//----------------------------------------------------------------------
+
+Cpu *
+Scheduler::Laggard()
+{
+    Cpu *laggard = NULL;
+
+    for (int i = 0; i < numCpus; i++) {
+	if (cpus[i] != current && !cpus[i]->idle
+		&& (laggard == NULL || cpus[i]->clock < laggard->clock)) {
+	    laggard = cpus[i];
+	}
+    }
+    return laggard;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SwitchCpus
+// 	Called by Interrupt::OneTick on a multiprocessor, with interrupts
+//	disabled.  If the current CPU has got too far ahead, leave its
+//	thread where it is, and go run the CPU furthest behind.
+//
+//	Either way, by the time we return, the current thread's CPU is
+//	running again: handle the IPIs it has been sent.  Return TRUE if
+//	the current thread should give up the CPU.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::SwitchCpus()
+{
+    Cpu *cpu;
+    Thread *thread;
+    int ipis;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    while ((cpu = Laggard()) != NULL && current->clock - cpu->clock > MpSkew) {
+	thread = (cpu->running != NULL) ? cpu->running : TakeReady(cpu);
+	if (thread != NULL) {
+	    current = cpu;
+	    Run(thread, FALSE);		// returns when we are run again
+	    break;
+	}
+	cpu->idle = TRUE;		// another CPU stole its thread
+    }
+
+    ipis = current->pendingIpis;
+    current->pendingIpis = 0;
+    if ((ipis & IpiTick) && Tick()) {
+	return TRUE;
+    }
+    return (ipis & IpiReschedule) != 0;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SendIpi
+// 	Interrupt another CPU: it will do what "type" says the next
+//	time it runs.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SendIpi(Cpu *cpu, IpiType type)
+{
+    ASSERT(cpu != current);
+    DEBUG(dbgThread, "IPI " << type << " to CPU " << cpu->id);
+    cpu->pendingIpis |= type;
+    cpu->numIpis++;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TickOthers
+// 	There is only one timer, so when it interrupts the current CPU,
+//	pass the interrupt on to the other CPUs that are running threads,
+//	so that they time slice too.
+//----------------------------------------------------------------------
+
+void
+Scheduler::TickOthers()
+{
+    for (int i = 0; i < numCpus; i++) {
+	if (cpus[i] != current && cpus[i]->running != NULL) {
+	    SendIpi(cpus[i], IpiTick);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintCpus
+// 	Print how each CPU spent its time, at Halt.  (System and user
+//	time, in the machine statistics, are added up over all CPUs.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintCpus()
+{
+    for (int i = 0; i < numCpus; i++) {
+	if (cpus[i]->idle) {		// idle ever since it stopped
+	    cpus[i]->CatchUp(kernel->stats->totalTicks);
+	}
+	cpus[i]->Print();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SelfTest
+// 	Test the scheduling policies, under a load of CPU bound threads.
+//
+//	First, measure how long an I/O bound thread waits to run after it
+//	is woken up, with the FIFO policy and then with the MLFQ policy.
+//	The I/O bound thread repeatedly asks for a (simulated) device
+//	interrupt some time in the future, and sleeps until it comes; the
+//	latency is the time from the interrupt to when the thread runs
+//	again.  With FIFO, it waits behind every CPU bound thread; with
+//	MLFQ, it should run almost at once.
+//
+//	Then, give the CPU bound threads tickets in the ratio 1:2:3, and
+//	check that the shares of the CPU they get under the stride and
+//	lottery policies converge to that ratio.  (Lottery only gets
+//	close: over 400 draws, of quanta that vary in length with -rs,
+//	it can be off by several percent.)  Also check stride with two
+//	threads with the same tickets, one CPU bound and one that keeps
+//	yielding long before its quantum is up: each should get half.
+//
+//	Those tests assume one CPU.  On an interleaved multiprocessor,
+//	instead give the CPUs more threads than there are CPUs, each with
+//	the same work to do, and check that the work overlaps in simulated
+//	time (with stealing to keep them all busy once the work starts to
+//	run out).  The host still does it all, one CPU at a time.
+//----------------------------------------------------------------------
+
+static const int TestHogs = 3;		// # of CPU bound threads
+static const int YielderWork = 4;	// # of times round TestYielder's
+					// loop (SystemTicks) between Yields
+static const int LatencyWakeups = 20;	// # of times to wake up
+static const int ShareTime = 400 * TimerTicks;	// time to measure shares over
+static const int SpeedupWork = 2000;	// # of ticks of work for each
+					// thread, in SystemTicks
+
+// Stands in for a device: "interrupts" at a given time, and wakes
+// up the thread waiting for it.
+
+class TestDevice : public CallBackObj {
+  public:
+    TestDevice() { done = new Semaphore("test device", 0); }
+    ~TestDevice() { delete done; }
+
+    void Start(int delay) {		// "Interrupt" "delay" ticks from now
+	kernel->interrupt->Schedule(this, delay, TimerInt); }
+    void CallBack() {			// Interrupt handler
+	when = kernel->stats->totalTicks;
+	done->V(); }
+
+    Semaphore *done;			// V'ed by each interrupt
+    long long when;			// time of the last interrupt
+};
+
+static bool testStop;			// TRUE when the hogs should finish
+static Semaphore *testFinished;		// V'ed by each thread as it finishes
+static int latencyTotal;		// sum of the wakeup latencies
+
+static void
+TestHog(void *arg)
+{
+    while (!testStop) {			// each time round advances the clock
+	(void) kernel->interrupt->SetLevel(IntOff);
+	(void) kernel->interrupt->SetLevel(IntOn);
+    }
+    testFinished->V();
+}
+
+static void
+TestYielder(void *arg)
+{
+    while (!testStop) {
+	for (int i = 0; i < YielderWork; i++) {
+	    (void) kernel->interrupt->SetLevel(IntOff);
+	    (void) kernel->interrupt->SetLevel(IntOn);
+	}
+	kernel->currentThread->Yield();
+    }
+    testFinished->V();
+}
+
+static void
+WaitForTestThreads(int numThreads)
+{
+    for (int i = 0; i < numThreads; i++) {
+	testFinished->P();
+    }
+    delete testFinished;
+}
+
+static void
+LatencyWaiter(void *arg)
+{
+    TestDevice *device = new TestDevice();
+
+    for (int i = 0; i < LatencyWakeups; i++) {
+	device->Start(150 + (i * 37) % 100);
+	device->done->P();
+	latencyTotal += kernel->stats->totalTicks - device->when;
+    }
+    delete device;
+    testStop = TRUE;
+    testFinished->V();
+}
+
+static int
+MeasureLatency()
+{
+    testStop = FALSE;
+    testFinished = new Semaphore("test finished", 0);
+    latencyTotal = 0;
+    for (int i = 0; i < TestHogs; i++) {
+	Thread *t = new Thread("cpu bound");
+	t->Fork(TestHog, NULL);
+    }
+    Thread *t = new Thread("io bound");
+    t->Fork(LatencyWaiter, NULL);
+    WaitForTestThreads(TestHogs + 1);
+    return latencyTotal / LatencyWakeups;
+}
+
+static double
+MeasureShares()
+{
+    Thread *hogs[TestHogs];
+    TestDevice *device = new TestDevice();
+    int allTickets = 0, allTicks = 0;
+    double worst = 0;
+
+    testStop = FALSE;
+    testFinished = new Semaphore("test finished", 0);
+    for (int i = 0; i < TestHogs; i++) {
+	hogs[i] = new Thread("share test");
+	hogs[i]->setTickets(100 * (i + 1));
+	allTickets += hogs[i]->getTickets();
+	hogs[i]->Fork(TestHog, NULL);
+    }
+    device->Start(ShareTime);		// let them run for a while
+    device->done->P();
+    delete device;
+
+    for (int i = 0; i < TestHogs; i++) {
+	allTicks += hogs[i]->cpuTicks;
+    }
+    for (int i = 0; i < TestHogs; i++) {
+	double wanted = 100.0 * hogs[i]->getTickets() / allTickets;
+	double got = 100.0 * hogs[i]->cpuTicks / allTicks;
+
+	worst = max(worst, got > wanted ? got - wanted : wanted - got);
+    }
+    testStop = TRUE;
+    WaitForTestThreads(TestHogs);
+    return worst;
+}
+
+static double
+MeasureYielderShare()
+{
+    Thread *hog = new Thread("share test");
+    Thread *yielder = new Thread("yield test");
+    TestDevice *device = new TestDevice();
+    double got;
+
+    testStop = FALSE;
+    testFinished = new Semaphore("test finished", 0);
+    hog->setTickets(100);
+    yielder->setTickets(100);
+    hog->Fork(TestHog, NULL);
+    yielder->Fork(TestYielder, NULL);
+    device->Start(ShareTime);
+    device->done->P();
+    delete device;
+
+    got = 100.0 * yielder->cpuTicks / (hog->cpuTicks + yielder->cpuTicks);
+    testStop = TRUE;
+    WaitForTestThreads(2);
+    return got > 50.0 ? got - 50.0 : 50.0 - got;
+}
+
+static void
+SpeedupWorker(void *arg)
+{
+    for (int i = 0; i < SpeedupWork; i++) {
+	(void) kernel->interrupt->SetLevel(IntOff);
+	(void) kernel->interrupt->SetLevel(IntOn);
+    }
+    testFinished->V();
+}
+
+static double
+MeasureSpeedup(int numCpus)
+{
+    int numThreads = 3 * numCpus + 1;	// so some CPUs run out first
+    long long start = kernel->stats->totalTicks;
+
+    testFinished = new Semaphore("test finished", 0);
+    for (int i = 0; i < numThreads; i++) {
+	Thread *t = new Thread("speedup test");
+	t->Fork(SpeedupWorker, NULL);
+    }
+    WaitForTestThreads(numThreads);
+    return (double) numThreads * SpeedupWork * SystemTick
+			/ (kernel->stats->totalTicks - start);
+}
+
+void
+Scheduler::SelfTest()
+{
+    SchedPolicy *saved;
+    int fifo, mlfq;
+    double stride, yielder, lottery, speedup;
+
+    if (numCpus > 1) {
+	int steals = 0;
+
+	speedup = MeasureSpeedup(numCpus);
+	for (int i = 0; i < numCpus; i++) {
+	    steals += cpus[i]->numSteals;
+	}
+	cout << "Simulated speedup on " << numCpus << " interleaved CPUs: "
+	     << speedup << " (" << steals << " threads stolen)\n";
+	ASSERT(speedup > 0.8 * numCpus);
+	return;
+    }
+
+    saved = SetPolicy(new FifoPolicy());
+    fifo = MeasureLatency();
+    delete SetPolicy(new MlfqPolicy());
+    mlfq = MeasureLatency();
+    delete SetPolicy(new StridePolicy(FALSE));
+    stride = MeasureShares();
+    yielder = MeasureYielderShare();
+    delete SetPolicy(new StridePolicy(TRUE));
+    lottery = MeasureShares();
+    delete SetPolicy(saved);
+
+    cout << "Mean wakeup latency under load: fifo " << fifo
+	 << " ticks, mlfq " << mlfq << " ticks\n";
+    cout << "Worst CPU share error: stride " << stride
+	 << "%, stride with a yielder " << yielder
+	 << "%, lottery " << lottery << "%\n";
+    ASSERT(mlfq < fifo);
+    ASSERT(stride < 2.0 && yielder < 5.0 && lottery < 12.0);
 }
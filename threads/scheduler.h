@@ -2,6 +2,25 @@
 //	Data structures for the thread dispatcher and scheduler.
 //	Primarily, the list of threads that are ready to run.
 //
+//	The scheduler can also simulate an interleaved multiprocessor
+//	(-mp): several CPUs, each with its own running thread, its own
+//	ready list and its own clock.  It is a model in simulated time
+//	only.  The CPUs all run on the one host thread, one at a time:
+//	whenever the CPU it is running gets more than MpSkew ticks ahead
+//	of another one that has something to do, it switches to the one
+//	furthest behind.  Simulated time is the clock of the CPU furthest
+//	behind, so work done on different CPUs over the same stretch of
+//	time overlaps, as it would on real hardware.  The host does all
+//	of the work, one CPU after another, however many CPUs it has
+//	itself; the CPUs share the one set of machine registers, which
+//	are saved and restored with the thread on every switch.
+//
+//	The host only switches CPUs in Interrupt::OneTick, or when a CPU
+//	has nothing left to run -- never while interrupts are disabled.
+//	So disabling interrupts keeps out the other CPUs as well, like
+//	one big kernel lock, and the kernel's mutual exclusion works on
+//	a multiprocessor unchanged.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -10,35 +29,115 @@
 #define SCHEDULER_H
 
 #include "copyright.h"
-#include "list.h"
 #include "thread.h"
+#include "schedpolicy.h"
+
+#define MaxCpus		16	// most CPUs we can simulate
+#define MpSkew		10	// most ticks one CPU may get ahead of
+				// the others
+
+// Inter-processor interrupts: one CPU asking another to do something,
+// which it does the next time it runs.  They are bits, so that several
+// can be pending at once.
+enum IpiType { IpiTick = 1, IpiReschedule = 2 };
+
+// The following class defines one simulated CPU.  While the host is
+// running a CPU, its running thread is kernel->currentThread, and the
+// machine's registers are its registers; otherwise, they are saved
+// in its running thread, as for any thread that is not running.
+
+class Cpu {
+  public:
+    Cpu(int cpuId, SchedPolicy *readyPolicy);
+    ~Cpu();
+
+    void CatchUp(long long now);	// It has been idle until "now"
+    void Print();		// Print how it spent its time
+
+    int id;			// which CPU this is, from 0
+    Thread *running;		// its thread, or NULL if it is idle
+    SchedPolicy *policy;	// keeps its ready threads
+    int numReady;		// # of threads on its ready list
+    bool idle;			// has it nothing to run?
+    long long clock;		// ticks since it started, by its own clock
+    long long idleTicks;	// how many of those it was idle
+    long long lastSwitch;	// clock at the last context switch
+    long long lastIdle;		// idleTicks as of then
+    int pendingIpis;		// IPIs sent it, not yet handled
+    int numIpis;		// # of IPIs it has been sent
+    int numSteals;		// # of threads it took from other CPUs
+};
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+// Which ready thread runs next is up to a SchedPolicy.
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(SchedPolicy *policy, int numCpus = 1);
+    				// Initialize list of ready threads, to
+				// be kept by "policy", for "numCpus" CPUs
     ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
     				// Thread can be dispatched.
-    Thread* FindNextToRun();	// Dequeue first thread on the ready 
-				// list, if any, and return thread.
+    void ReadyToRunAll(ThreadQueue *threads);
+    				// All of "threads" can be dispatched;
+				// leaves "threads" empty
+    Thread* FindNextToRun();	// Dequeue the thread the policy picks
+				// from the ready list, if any, and
+				// return thread.
+    int NumReady() { return numReady; }
+    				// # of threads on the ready lists
+    int NumCpus() { return numCpus; }
+				// # of CPUs we are simulating
+    bool Tick();		// Timer interrupt: return TRUE if the
+				// current thread should give up the CPU
+    void Blocked(Thread *thread);	// "thread" is going to sleep
+    void Inherited(Thread *thread);	// "thread"'s inheritedLevel changed
+    bool Preempts(Thread *thread);	// Should ready "thread" run instead
+    				// of the current thread?
+    SchedPolicy *SetPolicy(SchedPolicy *newPolicy);
+    				// Switch to "newPolicy", moving the
+				// ready threads over; return the old one
+    void ReportThread(Thread *thread);
+    				// "thread" is finishing: report the CPU
+				// time it got, and how long it waited
     void Run(Thread* nextThread, bool finishing);
     				// Cause nextThread to start running
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
+
+    void Advance(int ticks);	// The current CPU has run for "ticks"
+				// more: update simulated time
+    bool SwitchCpus();		// Handle this CPU's IPIs, and run
+				// another if this one is too far ahead;
+				// TRUE if the current thread should yield
+    void TickOthers();		// Timer interrupt: pass it on to the
+				// other CPUs that are running something
+    void PrintCpus();		// Print how each CPU spent its time
     
-    // SelfTest for scheduler is implemented in class Thread
+    void SelfTest();		// compare the policies, under load
     
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
+    Cpu *cpus[MaxCpus];		// each keeps its own ready threads
+    int numCpus;		// # of CPUs we are simulating
+    Cpu *current;		// the CPU the host is running
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+    int numReady;		// # of threads on all the ready lists
+
+    Cpu *Place(Thread *thread);	// Which CPU should "thread" be ready on?
+    Thread *TakeReady(Cpu *cpu);
+				// Next thread for "cpu" to run, from its
+				// own ready list or another CPU's
+    Cpu *Laggard();		// The busy CPU furthest behind, if any
+    void SendIpi(Cpu *cpu, IpiType type);
+				// Ask "cpu" to do something
+    void Charge(Thread *thread);	// Charge "thread" for the time
+    				// since the last context switch
 };
 
 #endif // SCHEDULER_H
@@ -0,0 +1,336 @@
+// stackpool.cc
+//	Routines to allocate thread stacks with guard pages, and keep
+//	them for re-use.
+//
+//	Sizes are rounded up to whole pages.  A stack of a size the pool
+//	has no bucket for (or any stack, if "highWater" is 0) is mapped on
+//	its own, guard pages and all, when it is needed, and unmapped as
+//	soon as it is freed.  A stack in an arena never is: unmapping it
+//	would take a guard page away from a neighbour still in use.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "stackpool.h"
+#include "main.h"
+#include "sysdep.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// StackPool::StackPool
+// 	Initialize an empty pool of stacks.
+//
+//	"highWater" is the most free stacks of any one size to keep.
+//----------------------------------------------------------------------
+
+StackPool::StackPool(int maxFree)
+{
+    highWater = maxFree;
+    pageSize = HostPageSize();
+    numMapped = numReused = 0;
+    for (int i = 0; i < MaxStackSizes; i++) {
+	buckets[i].size = 0;
+	buckets[i].free = NULL;
+	buckets[i].numFree = 0;
+	buckets[i].released = NULL;
+	buckets[i].numReleased = buckets[i].maxReleased = 0;
+	buckets[i].arenas = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// StackPool::~StackPool
+// 	Give back every arena whose stacks are all free.  Stacks still in
+//	use are not ours to give back, and neither are the arenas they
+//	are in (Nachos is halting, in any case).
+//----------------------------------------------------------------------
+
+StackPool::~StackPool()
+{
+    for (int i = 0; i < MaxStackSizes; i++) {
+	StackBucket *bucket = &buckets[i];
+	int slotSize = pageSize + bucket->size;
+	StackArena *unused = NULL;
+
+	// find them all first: the free list runs through every arena
+	while (bucket->arenas != NULL) {
+	    StackArena *arena = bucket->arenas;
+	    bool free = TRUE;
+
+	    for (int j = 0; j < arena->slots && free; j++) {
+		free = IsFree(bucket, arena->base + j * slotSize + pageSize);
+	    }
+	    bucket->arenas = arena->next;
+	    if (free) {
+		arena->next = unused;
+		unused = arena;
+	    } else {
+		delete arena;
+	    }
+	}
+	while (unused != NULL) {
+	    StackArena *arena = unused;
+
+	    UnmapPages(arena->base, arena->slots * slotSize + pageSize);
+	    unused = arena->next;
+	    delete arena;
+	}
+	delete [] bucket->released;
+    }
+}
+
+//----------------------------------------------------------------------
+// StackPool::IsFree
+// 	Is "stack" on the free list of "bucket", or released?
+//----------------------------------------------------------------------
+
+bool
+StackPool::IsFree(StackBucket *bucket, char *stack)
+{
+    for (char *s = bucket->free; s != NULL; s = *(char **) s) {
+	if (s == stack) {
+	    return TRUE;
+	}
+    }
+    for (int i = 0; i < bucket->numReleased; i++) {
+	if (bucket->released[i] == stack) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// StackPool::FindBucket
+// 	Return the bucket for stacks of "size" bytes, starting a new one
+//	if need be.  Return NULL if we are not keeping stacks, or all the
+//	buckets are in use for other sizes.
+//----------------------------------------------------------------------
+
+StackBucket *
+StackPool::FindBucket(int size)
+{
+    if (highWater == 0) {
+	return NULL;
+    }
+    for (int i = 0; i < MaxStackSizes; i++) {
+	if (buckets[i].size == size) {
+	    return &buckets[i];
+	}
+    }
+    for (int i = 0; i < MaxStackSizes; i++) {
+	if (buckets[i].size == 0) {
+	    buckets[i].size = size;
+	    return &buckets[i];
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// StackPool::MapArena
+// 	Map some new stacks of "size" bytes side by side, with a guard
+//	page below each one, and one above the last.  Return the first
+//	stack, and put the others on the free list of "bucket" (if there
+//	is one; otherwise, map just the one stack, and don't keep track
+//	of it).
+//----------------------------------------------------------------------
+
+char *
+StackPool::MapArena(StackBucket *bucket, int size)
+{
+    int slots = (bucket == NULL) ? 1 : min(StackArenaSlots, highWater + 1);
+    int slotSize = pageSize + size;
+    char *arena = MapPages(slots * slotSize + pageSize);
+
+    for (int i = 0; i <= slots; i++) {
+	GuardPages(arena + i * slotSize, pageSize);
+    }
+    for (int i = slots - 1; i > 0; i--) {
+	char *stack = arena + i * slotSize + pageSize;
+
+	*(char **) stack = bucket->free;
+	bucket->free = stack;
+	bucket->numFree++;
+    }
+    if (bucket != NULL) {
+	StackArena *record = new StackArena;
+
+	record->base = arena;
+	record->slots = slots;
+	record->next = bucket->arenas;
+	bucket->arenas = record;
+    }
+    numMapped += slots;
+    DEBUG(dbgThread, "Mapped " << slots << " stacks of " << size << " bytes");
+    return arena + pageSize;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Allocate
+// 	Return a stack of (at least) "size" bytes, with guard pages
+//	around it: a free one if we have one -- one kept ready, else one
+//	whose memory we gave back -- else a new one.
+//----------------------------------------------------------------------
+
+int *
+StackPool::Allocate(int size)
+{
+    StackBucket *bucket;
+    char *stack;
+
+    size = divRoundUp(size, pageSize) * pageSize;
+    bucket = FindBucket(size);
+    if (bucket != NULL && bucket->free != NULL) {
+	stack = bucket->free;
+	bucket->free = *(char **) stack;
+	bucket->numFree--;
+    } else if (bucket != NULL && bucket->numReleased > 0) {
+	stack = bucket->released[--bucket->numReleased];
+	UnguardPages(stack, size);
+    } else {
+	return (int *) MapArena(bucket, size);
+    }
+    numReused++;
+    return (int *) stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Free
+// 	Put "stack", of "size" bytes, back on its free list; or if the
+//	free list is full, give its memory back to the host (see
+//	Release).  A stack mapped on its own is unmapped, along with both
+//	of its guard pages.
+//----------------------------------------------------------------------
+
+void
+StackPool::Free(int *stack, int size)
+{
+    StackBucket *bucket;
+
+    size = divRoundUp(size, pageSize) * pageSize;
+    bucket = FindBucket(size);
+    if (bucket == NULL) {
+	UnmapPages((char *) stack - pageSize, size + 2 * pageSize);
+	return;
+    }
+    if (bucket->numFree >= highWater) {
+	Release(bucket, (char *) stack);
+	return;
+    }
+    *(char **) stack = bucket->free;
+    bucket->free = (char *) stack;
+    bucket->numFree++;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Release
+// 	Give the memory of a free stack back to the host.  Its pages stay
+//	mapped, but inaccessible, so the stacks on either side of it keep
+//	their guard pages; Allocate makes them usable again if it runs
+//	out of stacks kept ready.
+//----------------------------------------------------------------------
+
+void
+StackPool::Release(StackBucket *bucket, char *stack)
+{
+    if (bucket->numReleased == bucket->maxReleased) {
+	int bigger = max(2 * bucket->maxReleased, StackArenaSlots);
+	char **array = new char *[bigger];
+
+	for (int i = 0; i < bucket->numReleased; i++) {
+	    array[i] = bucket->released[i];
+	}
+	delete [] bucket->released;
+	bucket->released = array;
+	bucket->maxReleased = bigger;
+    }
+    ReleasePages(stack, bucket->size);
+    bucket->released[bucket->numReleased++] = stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::SelfTest
+// 	Check that freed stacks are re-used -- including, in a pool that
+//	keeps only one ready, one whose memory was given back -- then time
+//	creating and destroying a lot of threads, with the kernel's pool,
+//	and then with a pool that keeps nothing (so every thread maps and
+//	unmaps its own stack).
+//----------------------------------------------------------------------
+
+static const int SelfTestThreads = 2000;
+
+static Semaphore *testFinished;		// V'ed by each thread as it finishes
+
+static void
+DoNothing(void *arg)
+{
+    (void) kernel->interrupt->SetLevel(IntOff);	// finish before anyone
+    testFinished->V();				// else gets to run
+}
+
+static double
+ThreadsPerSecond()
+{
+    double start = HostMicroseconds();
+
+    testFinished = new Semaphore("stack test finished", 0);
+    for (int i = 0; i < SelfTestThreads; i++) {
+	Thread *t = new Thread("stack test");
+	t->Fork(DoNothing, NULL);
+	testFinished->P();		// by the time we run again, it is
+					// gone (Yield might not let it run,
+					// under some scheduling policies)
+    }
+    delete testFinished;
+    return SelfTestThreads * 1000000.0 / (HostMicroseconds() - start);
+}
+
+void
+StackPool::SelfTest()
+{
+    int *a, *b, *c, *d;
+    int reused, mapped;
+    int size = StackSize * sizeof(int);
+    double pooled, unpooled;
+    StackPool *saved, *pool;
+
+    if (highWater > 0) {		// (not if told to keep nothing)
+	a = Allocate(size);
+	reused = numReused;
+	Free(a, size);
+	b = Allocate(size);
+	ASSERT(a == b && numReused == reused + 1);
+	Free(b, size);
+    }
+
+    pool = new StackPool(1);		// both in one arena of two
+    a = pool->Allocate(size);
+    b = pool->Allocate(size);
+    mapped = pool->numMapped;
+    memset(b, 1, size);
+    pool->Free(a, size);
+    pool->Free(b, size);		// released
+    c = pool->Allocate(size);
+    d = pool->Allocate(size);
+    ASSERT(c == a && d == b && pool->numMapped == mapped);
+    ASSERT(d[0] == 0 && d[size / sizeof(int) - 1] == 0);
+    memset(d, 1, size);			// usable again, all of it
+    pool->Free(c, size);
+    pool->Free(d, size);
+    delete pool;			// unmaps the arena
+
+    reused = numReused;
+    pooled = ThreadsPerSecond();
+    ASSERT(highWater == 0 || numReused >= reused + SelfTestThreads);
+    saved = kernel->stackPool;
+    kernel->stackPool = new StackPool(0);
+    unpooled = ThreadsPerSecond();
+    delete kernel->stackPool;
+    kernel->stackPool = saved;
+
+    cout << "Threads created and destroyed per second: pooled stacks "
+	 << (int) pooled << ", unpooled " << (int) unpooled << "\n";
+}
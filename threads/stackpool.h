@@ -0,0 +1,92 @@
+// stackpool.h
+//	Data structures for allocating thread execution stacks.
+//
+//	Every stack has an inaccessible guard page just below it and just
+//	above it, so that running off either end of the stack causes a
+//	fault, rather than silently corrupting something else.  Setting up
+//	the guard pages takes system calls, so when a thread is destroyed
+//	its stack is kept, guard pages and all, for the next thread that
+//	needs one of the same size.
+//
+//	Stacks are mapped StackArenaSlots at a time, side by side, each
+//	stack's upper guard page doubling as the next one's lower guard
+//	page.  At most "highWater" free stacks of each size are kept
+//	ready; beyond that, a freed stack's memory is given back to the
+//	host, but its pages stay in the arena, as one big guard between
+//	its neighbours, until a thread needs a stack again.  An arena is
+//	only unmapped as a whole.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef STACKPOOL_H
+#define STACKPOOL_H
+
+#include "copyright.h"
+
+#define StackArenaSlots		8	// most stacks to map at once
+#define MaxStackSizes		8	// # of different stack sizes kept
+#define DefaultStackHighWater	32	// free stacks kept, of each size
+
+// A group of stacks mapped together: a guard page, then each stack
+// with a guard page above it.
+
+class StackArena {
+  public:
+    char *base;			// first page mapped
+    int slots;			// # of stacks in it
+    StackArena *next;		// next arena of the same size
+};
+
+// The free stacks of one size.  The ones kept ready are linked together
+// through their first word; the ones whose memory has been given back
+// can not be touched, so they are kept in an array.
+
+class StackBucket {
+  public:
+    int size;			// bytes in each stack (0 if unused)
+    char *free;			// first free stack, or NULL
+    int numFree;		// # of stacks on the free list
+    char **released;		// free stacks with no memory behind them
+    int numReleased;		// # of entries in use
+    int maxReleased;		// # of entries allocated
+    StackArena *arenas;		// every arena of stacks this size
+};
+
+// The following class defines a pool of thread stacks.
+
+class StackPool {
+  public:
+    StackPool(int highWater);	// Keep up to "highWater" free stacks
+				// of each size
+    ~StackPool();		// Give back all the free stacks
+
+    int *Allocate(int size);	// Return a stack of "size" bytes
+    void Free(int *stack, int size);
+				// Return "stack" to the pool
+
+    int numMapped;		// # of stacks mapped from the host
+    int numReused;		// # of allocations from the free list
+
+    void SelfTest();		// time thread creation, with and without
+				// keeping stacks
+
+  private:
+    int highWater;		// most free stacks to keep of each size
+    int pageSize;		// the host's page size
+    StackBucket buckets[MaxStackSizes];
+
+    StackBucket *FindBucket(int size);
+				// bucket for "size" byte stacks, or NULL
+				// if there is no room for another size
+    char *MapArena(StackBucket *bucket, int size);
+				// map some new stacks, return one, and
+				// put the rest on the free list
+    void Release(StackBucket *bucket, char *stack);
+				// give back the memory of a free stack
+    bool IsFree(StackBucket *bucket, char *stack);
+				// is "stack" free (for ~StackPool)?
+};
+
+#endif // STACKPOOL_H
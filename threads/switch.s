@@ -375,6 +375,71 @@ SWITCH:
 #endif // x86
 
 
+#ifdef x86_64
+
+        .text
+        .align  16
+
+        .globl  ThreadRoot
+
+/* void ThreadRoot( void )
+**
+** expects the following registers to be initialized:
+**      r15     points to startup function (interrupt enable)
+**      r13     contains inital argument to thread function
+**      r12     points to thread function
+**      r14     point to Thread::Finish()
+**
+** These are all callee-saved, so they survive the calls.
+*/
+ThreadRoot:
+        pushq   %rbp                    # also aligns the stack for calls
+        movq    %rsp,%rbp
+        call    *StartupPC
+        movq    InitialArg,%rdi         # first argument goes in rdi
+        call    *InitialPC
+        call    *WhenDonePC
+
+ /*       # NOT REACHED */
+        movq    %rbp,%rsp
+        popq    %rbp
+        ret
+
+
+
+/* void SWITCH( thread *t1, thread *t2 )
+**
+** t1 is in rdi, t2 in rsi, and the return address is at (rsp).
+** The caller has already saved whatever it needs of the other
+** registers, so we only save and restore the callee-saved ones.
+*/
+        .globl  SWITCH
+SWITCH:
+        movq    %rsp,_RSP(%rdi)         # save stack pointer
+        movq    %rbx,_RBX(%rdi)         # save registers
+        movq    %rbp,_RBP(%rdi)
+        movq    %r12,_R12(%rdi)
+        movq    %r13,_R13(%rdi)
+        movq    %r14,_R14(%rdi)
+        movq    %r15,_R15(%rdi)
+        movq    0(%rsp),%rax            # get return address from stack
+        movq    %rax,_PC(%rdi)          # save it into the pc storage
+
+        movq    _RBX(%rsi),%rbx         # restore old registers
+        movq    _RBP(%rsi),%rbp
+        movq    _R12(%rsi),%r12
+        movq    _R13(%rsi),%r13
+        movq    _R14(%rsi),%r14
+        movq    _R15(%rsi),%r15
+        movq    _RSP(%rsi),%rsp         # restore stack pointer
+        movq    _PC(%rsi),%rax          # copy over the ret address
+        movq    %rax,0(%rsp)            # on the stack
+
+        ret
+
+#endif // x86_64
+
+
 #if defined(ApplePowerPC)
 
 	/* The AIX PowerPC code is incompatible with the assembler on MacOS X
@@ -748,3 +813,9 @@ SWITCH:
 	.end SWITCH
 	
 #endif // ALPHA
+
+#if defined(__linux__) && defined(__ELF__)
+/* none of the code above runs off the stack: say so, or the linker
+   gives the whole of nachos an executable stack */
+	.section .note.GNU-stack,"",@progbits
+#endif
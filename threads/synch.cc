@@ -16,17 +16,13 @@
 // re-set the interrupt state back to its original value (whether
 // that be disabled or enabled).
 //
-// Once we'e implemented one set of higher level atomic operations,
-// we can implement others using that implementation.  We illustrate
-// this by implementing locks and condition variables on top of 
-// semaphores, instead of directly enabling and disabling interrupts.
-//
-// Locks are implemented using a semaphore to keep track of
-// whether the lock is held or not -- a semaphore value of 0 means
-// the lock is busy; a semaphore value of 1 means the lock is free.
-//
-// The implementation of condition variables using semaphores is
-// a bit trickier, as explained below under Condition::Wait.
+// All three keep the threads waiting on them in a ThreadQueue, linked
+// through the threads themselves, so blocking and waking up never
+// allocate memory.  Locks and condition variables disable interrupts
+// directly, just as semaphores do: a lock is busy when it has a
+// lockHolder, and a condition variable puts its waiters straight on
+// the ready list, as explained below under Condition::Wait and
+// Condition::Broadcast.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -35,6 +31,28 @@
 #include "copyright.h"
 #include "synch.h"
 #include "main.h"
+#include "slab.h"
+
+//----------------------------------------------------------------------
+// Semaphore::operator new, operator delete
+// 	Semaphores are made and deleted all over the kernel (one per
+//	disk or console request, for a start), so freed semaphores are
+//	kept in a slab cache for re-use.
+//----------------------------------------------------------------------
+
+static SlabCache semaphoreSlab("Semaphore", sizeof(Semaphore));
+
+void *
+Semaphore::operator new(size_t size)
+{
+    return semaphoreSlab.Alloc(size);
+}
+
+void
+Semaphore::operator delete(void *p, size_t size)
+{
+    semaphoreSlab.Free(p, size);
+}
 
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
@@ -48,7 +66,6 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
 }
 
 //----------------------------------------------------------------------
@@ -59,7 +76,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 
 Semaphore::~Semaphore()
 {
-    delete queue;
+    ASSERT(queue.IsEmpty());
 }
 
 //----------------------------------------------------------------------
@@ -82,7 +99,7 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
     while (value == 0) { 		// semaphore not available
-	queue->Append(currentThread);	// so go to sleep
+	queue.Append(currentThread);	// so go to sleep
 	currentThread->Sleep(FALSE);
     } 
     value--; 			// semaphore available, consume its value
@@ -91,6 +108,38 @@ Semaphore::P()
     (void) interrupt->SetLevel(oldLevel);	
 }
 
+//----------------------------------------------------------------------
+// Semaphore::CancellableP
+// 	Like P, except that the wait can be cut short by Thread::Cancel,
+//	or not started at all if the thread has been cancelled already.
+//	Used where the wait may be long, and the thread may need to give
+//	up on it (waiting for input, say).
+//
+//	Returns TRUE if the value was decremented, FALSE if the thread
+//	was cancelled first.
+//----------------------------------------------------------------------
+
+bool
+Semaphore::CancellableP()
+{
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool got;
+
+    while (value == 0 && !currentThread->IsCancelled()) {
+	queue.Append(currentThread);
+	currentThread->waitingIn = &queue;
+	currentThread->Sleep(FALSE);
+    }
+    got = (value > 0);
+    if (got) {
+	value--;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return got;
+}
+
 //----------------------------------------------------------------------
 // Semaphore::V
 // 	Increment semaphore value, waking up a waiter if necessary.
@@ -107,8 +156,8 @@ Semaphore::V()
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
-    if (!queue->IsEmpty()) {  // make thread ready.
-	kernel->scheduler->ReadyToRun(queue->RemoveFront());
+    if (!queue.IsEmpty()) {  // make thread ready.
+	kernel->scheduler->ReadyToRun(queue.RemoveFront());
     }
     value++;
     
@@ -158,38 +207,127 @@ Semaphore::SelfTest()
 Lock::Lock(char* debugName)
 {
     name = debugName;
-    semaphore = new Semaphore("lock", 1);  // initially, unlocked
-    lockHolder = NULL;
+    lockHolder = NULL;		// initially, unlocked
+    nextHeld = NULL;
+    record = kernel->stats->FindLock(debugName);
+    acquireTime = 0;
 }
 
 //----------------------------------------------------------------------
 // Lock::~Lock
-// 	Deallocate a lock
+// 	Deallocate a lock.  If some thread still holds it, take it off
+//	that thread's list of locks.
 //----------------------------------------------------------------------
 Lock::~Lock()
 {
-    delete semaphore;
+    ASSERT(queue.IsEmpty());
+    if (lockHolder != NULL) {
+	Lock **p = &lockHolder->locksHeld;
+
+	while (*p != this) {
+	    p = &(*p)->nextHeld;
+	}
+	*p = nextHeld;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::Donate
+// 	"waiter" is about to wait for this lock: raise the holder to
+//	waiter's level, if it is not already that high.  If the holder
+//	is itself waiting for a lock, pass the level on to that lock's
+//	holder, and so on down the chain.
+//----------------------------------------------------------------------
+
+void
+Lock::Donate(Thread *waiter)
+{
+    int level = min(waiter->schedLevel, waiter->inheritedLevel);
+
+    for (Lock *lock = this; lock != NULL; ) {
+	Thread *holder = lock->lockHolder;
+
+	if (holder == NULL || holder->inheritedLevel <= level) {
+	    break;
+	}
+	DEBUG(dbgThread, holder->getName() << " inherits level " << level
+			  << " through lock " << lock->name);
+	holder->inheritedLevel = level;
+	kernel->scheduler->Inherited(holder);
+	lock = holder->waitingFor;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::WaitingLevel
+// 	Return the best level of any thread waiting for this lock, or
+//	NoInheritedLevel if no one is waiting.
+//----------------------------------------------------------------------
+
+int
+Lock::WaitingLevel()
+{
+    int level = NoInheritedLevel;
+
+    for (Thread *t = queue.Front(); t != NULL; t = t->queueNext) {
+	level = min(level, min(t->schedLevel, t->inheritedLevel));
+    }
+    return level;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
 //	Atomically wait until the lock is free, then set it to busy.
-//	Equivalent to Semaphore::P(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	Like Semaphore::P(), with a NULL lockHolder meaning free.
+//
+//	While we wait, the lock holder runs at our priority, if that is
+//	higher than its own.
 //----------------------------------------------------------------------
 
 void Lock::Acquire()
 {
-    semaphore->P();
-    lockHolder = kernel->currentThread;
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    long long start = kernel->stats->totalTicks;
+    bool waited = FALSE;
+
+    while (lockHolder != NULL) {	// lock busy, so go to sleep
+	waited = TRUE;
+	currentThread->waitingFor = this;
+	Donate(currentThread);
+	queue.Append(currentThread);
+	currentThread->Sleep(FALSE);
+    }
+    currentThread->waitingFor = NULL;
+    lockHolder = currentThread;
+    nextHeld = currentThread->locksHeld;
+    currentThread->locksHeld = this;
+
+    acquireTime = kernel->stats->totalTicks;
+    record->acquires++;
+    if (waited) {
+	long long wait = acquireTime - start;
+
+	record->contended++;
+	record->waitTicks += wait;
+	record->maxWaitTicks = max(record->maxWaitTicks, wait);
+    }
+
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
 //	Atomically set lock to be free, waking up a thread waiting
 //	for the lock, if any.
-//	Equivalent to Semaphore::V(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	Like Semaphore::V().
+//
+//	We give up any priority the waiters lent us through this lock
+//	(but keep what we inherit through the locks we still hold).
+//	If the thread we woke up should now run ahead of us, let it --
+//	unless interrupts were already off, in which case our caller
+//	(Condition::Wait) is about to go to sleep anyway.
 //
 //	By convention, only the thread that acquired the lock
 // 	may release it.
@@ -197,9 +335,108 @@ void Lock::Acquire()
 
 void Lock::Release()
 {
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    Thread *woken = NULL;
+    IntStatus oldLevel;
+    Lock **p;
+
     ASSERT(IsHeldByCurrentThread());
+    oldLevel = interrupt->SetLevel(IntOff);
+    record->holdTicks += kernel->stats->totalTicks - acquireTime;
+
+    for (p = &currentThread->locksHeld; *p != this; p = &(*p)->nextHeld) {}
+    *p = nextHeld;
     lockHolder = NULL;
-    semaphore->V();
+    currentThread->inheritedLevel = NoInheritedLevel;
+    for (Lock *lock = currentThread->locksHeld; lock != NULL;
+						lock = lock->nextHeld) {
+	currentThread->inheritedLevel =
+		min(currentThread->inheritedLevel, lock->WaitingLevel());
+    }
+
+    if (!queue.IsEmpty()) {
+	woken = queue.RemoveFront();
+	kernel->scheduler->ReadyToRun(woken);
+    }
+    if (woken != NULL && oldLevel == IntOn
+			&& kernel->scheduler->Preempts(woken)) {
+	currentThread->Yield();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::SelfTest, LockTestHelper
+// 	Test priority inheritance, through a chain of two locks.  We
+//	hold this lock, at a low level; "first", at a middle level, takes
+//	"second" and waits for this lock; then "second", at the top level,
+//	waits for "second".  We should inherit the top level through
+//	"first", and give it back when we release the lock.
+//
+//	A helper's quantum may run out before it gets to wait (with -rs,
+//	say), so we can not count on the exact level it passes on; only
+//	that it is passed on, and down the whole chain.
+//----------------------------------------------------------------------
+
+static Lock *second;
+static Semaphore *lockTestDone;
+
+static void
+LockTestHelper(Lock *lock)
+{
+    bool inner = (lock == second);
+
+    if (!inner) {
+	second->Acquire();
+    }
+    lock->Acquire();
+    if (!inner) {		// "second" is still waiting for us
+	ASSERT(kernel->currentThread->inheritedLevel != NoInheritedLevel);
+	lock->Release();
+	second->Release();
+	ASSERT(kernel->currentThread->inheritedLevel == NoInheritedLevel);
+    } else {
+	lock->Release();
+    }
+    lockTestDone->V();
+}
+
+void
+Lock::SelfTest()
+{
+    Thread *currentThread = kernel->currentThread;
+    int level = currentThread->schedLevel;
+    Thread *first = new Thread("lock first");
+    Thread *top = new Thread("lock second");
+
+    second = new Lock("test second");
+    lockTestDone = new Semaphore("lock test done", 0);
+    Acquire();
+    currentThread->schedLevel = 2;
+    first->schedLevel = 1;
+    first->Fork((VoidFunctionPtr) LockTestHelper, this);
+    while (first->waitingFor != this) {
+	currentThread->Yield();
+    }
+    ASSERT(currentThread->inheritedLevel != NoInheritedLevel);
+
+    top->schedLevel = 0;
+    top->Fork((VoidFunctionPtr) LockTestHelper, second);
+    while (top->waitingFor != second) {
+	currentThread->Yield();
+    }
+    ASSERT(first->inheritedLevel != NoInheritedLevel);
+    ASSERT(currentThread->inheritedLevel <= first->inheritedLevel);
+
+    Release();
+    ASSERT(currentThread->inheritedLevel == NoInheritedLevel);
+    currentThread->schedLevel = level;
+
+    lockTestDone->P();		// wait for both helpers to finish
+    lockTestDone->P();
+    delete lockTestDone;
+    delete second;
 }
 
 //----------------------------------------------------------------------
@@ -213,7 +450,6 @@ void Lock::Release()
 Condition::Condition(char* debugName)
 {
     name = debugName;
-    waitQueue = new List<Semaphore *>;
 }
 
 //----------------------------------------------------------------------
@@ -223,17 +459,15 @@ Condition::Condition(char* debugName)
 
 Condition::~Condition()
 {
-    delete waitQueue;
+    ASSERT(waitQueue.IsEmpty());
 }
 
 //----------------------------------------------------------------------
 // Condition::Wait
 // 	Atomically release monitor lock and go to sleep.
-//	Our implementation uses semaphores to implement this, by
-//	allocating a semaphore for each waiting thread.  The signaller
-//	will V() this semaphore, so there is no chance the waiter
-//	will miss the signal, even though the lock is released before
-//	calling P().
+//	Interrupts are kept off from putting ourselves on the wait
+//	queue until we are asleep, so there is no chance of missing a
+//	signal, even though the lock is released before we sleep.
 //
 //	Note: we assume Mesa-style semantics, which means that the
 //	waiter must re-acquire the monitor lock when waking up.
@@ -243,16 +477,19 @@ Condition::~Condition()
 
 void Condition::Wait(Lock* conditionLock) 
 {
-     Semaphore *waiter;
+     Interrupt *interrupt = kernel->interrupt;
+     Thread *currentThread = kernel->currentThread;
+     IntStatus oldLevel;
     
      ASSERT(conditionLock->IsHeldByCurrentThread());
 
-     waiter = new Semaphore("condition", 0);
-     waitQueue->Append(waiter);
+     oldLevel = interrupt->SetLevel(IntOff);
+     waitQueue.Append(currentThread);
+     currentThread->waitingIn = &waitQueue;	// for Thread::Cancel
      conditionLock->Release();
-     waiter->P();
+     currentThread->Sleep(FALSE);
+     (void) interrupt->SetLevel(oldLevel);
      conditionLock->Acquire();
-     delete waiter;
 }
 
 //----------------------------------------------------------------------
@@ -264,34 +501,252 @@ void Condition::Wait(Lock* conditionLock)
 //	being woken up (unlike Hoare-style).
 //
 //	Also note: we assume the caller holds the monitor lock
-//	(unlike what is described in Birrell's paper).  This allows
-//	us to access waitQueue without disabling interrupts.
+//	(unlike what is described in Birrell's paper).  Interrupts
+//	still have to be disabled to put the waiter on the ready list.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Signal(Lock* conditionLock)
 {
-    Semaphore *waiter;
+    IntStatus oldLevel;
     
     ASSERT(conditionLock->IsHeldByCurrentThread());
     
-    if (!waitQueue->IsEmpty()) {
-        waiter = waitQueue->RemoveFront();
-	waiter->V();
+    if (!waitQueue.IsEmpty()) {
+	oldLevel = kernel->interrupt->SetLevel(IntOff);
+	kernel->scheduler->ReadyToRun(waitQueue.RemoveFront());
+	(void) kernel->interrupt->SetLevel(oldLevel);
     }
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-// 	Wake up all threads waiting on this condition, if any.
+// 	Wake up all threads waiting on this condition, if any, by
+//	moving the whole wait queue onto the ready list at once.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Broadcast(Lock* conditionLock) 
 {
-    while (!waitQueue->IsEmpty()) {
-        Signal(conditionLock);
+    IntStatus oldLevel;
+
+    ASSERT(conditionLock->IsHeldByCurrentThread());
+
+    if (!waitQueue.IsEmpty()) {
+	oldLevel = kernel->interrupt->SetLevel(IntOff);
+	kernel->scheduler->ReadyToRunAll(&waitQueue);
+	(void) kernel->interrupt->SetLevel(oldLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, so that it can be used for
+//	synchronization.  Initially, no one holds it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    lock = new Lock(debugName);
+    okToRead = new Condition("ok to read");
+    okToWrite = new Condition("ok to write");
+    numReaders = 0;
+    writing = FALSE;
+    numWaitingWriters = 0;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	Deallocate a reader-writer lock.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(numReaders == 0 && !writing);
+    delete okToWrite;
+    delete okToRead;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Wait until there is no writer, active or waiting, then become
+//	one of the readers.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    lock->Acquire();
+    while (writing || numWaitingWriters > 0) {
+	okToRead->Wait(lock);
+    }
+    numReaders++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Stop reading.  The last reader out lets a waiting writer in.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(numReaders > 0);
+    if (--numReaders == 0 && numWaitingWriters > 0) {
+	okToWrite->Signal(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Wait until no one is reading or writing, then start writing.
+//	While we wait, no new readers are let in.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    lock->Acquire();
+    numWaitingWriters++;
+    while (writing || numReaders > 0) {
+	okToWrite->Wait(lock);
+    }
+    numWaitingWriters--;
+    writing = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Stop writing.  Pass the lock to the next writer, if there is one;
+//	otherwise, let in all the waiting readers together.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writing);
+    writing = FALSE;
+    if (numWaitingWriters > 0) {
+	okToWrite->Signal(lock);
+    } else {
+	okToRead->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::SelfTest, RWLockTestReader, RWLockTestWriter
+// 	Test the reader-writer lock.  First, check that readers do get
+//	to share it, and that a writer waiting behind a reader goes ahead
+//	of a reader that comes along later.  Then run a few readers and
+//	writers against each other, checking that writers always have the
+//	lock to themselves.  (Whether readers in the crowd overlap depends
+//	on how the scheduler treats Yield, so that is not checked.)
+//----------------------------------------------------------------------
+
+static const int RWTestRounds = 5;
+
+static RWLock *rwTestLock;
+static Semaphore *rwTestDone;
+static int rwTestReaders, rwTestWriters;
+static char rwTestOrder[2];	// who got the lock first, in order
+static int rwTestNext;
+
+static void
+RWLockTestReader(void *arg)
+{
+    int rounds = (int) (long) arg;
+
+    for (int i = 0; i < rounds; i++) {
+	rwTestLock->AcquireRead();
+	if (rwTestNext < 2) {
+	    rwTestOrder[rwTestNext++] = 'r';
+	}
+	rwTestReaders++;
+	ASSERT(rwTestWriters == 0);
+	kernel->currentThread->Yield();
+	rwTestReaders--;
+	rwTestLock->ReleaseRead();
+	kernel->currentThread->Yield();
+    }
+    rwTestDone->V();
+}
+
+static void
+RWLockTestWriter(void *arg)
+{
+    int rounds = (int) (long) arg;
+
+    for (int i = 0; i < rounds; i++) {
+	rwTestLock->AcquireWrite();
+	if (rwTestNext < 2) {
+	    rwTestOrder[rwTestNext++] = 'w';
+	}
+	rwTestWriters++;
+	ASSERT(rwTestWriters == 1 && rwTestReaders == 0);
+	kernel->currentThread->Yield();
+	rwTestWriters--;
+	rwTestLock->ReleaseWrite();
+	kernel->currentThread->Yield();
+    }
+    rwTestDone->V();
+}
+
+void
+RWLock::SelfTest()
+{
+    Thread *writer = new Thread("rw writer");
+    Thread *reader = new Thread("rw reader");
+
+    rwTestLock = this;
+    rwTestDone = new Semaphore("rw test done", 0);
+    rwTestReaders = rwTestWriters = 0;
+
+    // a reader arriving while we are reading gets in too
+    AcquireRead();
+    (new Thread("rw reader"))->Fork(RWLockTestReader, (void *) 1);
+    rwTestDone->P();			// it can only finish by sharing
+    ReleaseRead();
+
+    // a writer, then a reader, arrive while we are reading
+    AcquireRead();
+    rwTestNext = 0;
+    writer->Fork(RWLockTestWriter, (void *) 1);
+    while (numWaitingWriters == 0) {
+	kernel->currentThread->Yield();
+    }
+    reader->Fork(RWLockTestReader, (void *) 1);
+    for (int i = 0; i < 10; i++) {
+	kernel->currentThread->Yield();
+    }
+    ASSERT(rwTestNext == 0);		// both still waiting
+    ReleaseRead();
+    rwTestDone->P();
+    rwTestDone->P();
+    ASSERT(rwTestOrder[0] == 'w' && rwTestOrder[1] == 'r');
+
+    // now a crowd
+    for (int i = 0; i < 3; i++) {
+	(new Thread("rw reader"))->Fork(RWLockTestReader,
+					(void *) RWTestRounds);
+    }
+    for (int i = 0; i < 2; i++) {
+	(new Thread("rw writer"))->Fork(RWLockTestWriter,
+					(void *) RWTestRounds);
+    }
+    for (int i = 0; i < 5; i++) {
+	rwTestDone->P();
     }
+    delete rwTestDone;
 }
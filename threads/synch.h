@@ -18,6 +18,7 @@
 #include "thread.h"
 #include "list.h"
 #include "main.h"
+#include "stats.h"
 
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
@@ -42,13 +43,17 @@ class Semaphore {
     
     void P();	 	// these are the only operations on a semaphore
     void V();	 	// they are both *atomic*
+    bool CancellableP();	// P, unless the thread is cancelled first
+				// (see Thread::Cancel); FALSE if it was
     void SelfTest();	// test routine for semaphore implementation
+
+    void *operator new(size_t size);	// Semaphores come from a slab cache
+    void operator delete(void *p, size_t size);
     
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List<Thread *> *queue;     
-		  	// threads waiting in P() for the value to be > 0
+    ThreadQueue queue;	// threads waiting in P() for the value to be > 0
    };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -62,6 +67,15 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// A thread waiting for a lock lends its priority to the lock holder
+// (and, if the holder is waiting for another lock, to that lock's
+// holder, and so on), so that a high priority thread is not kept
+// waiting by lower priority threads that happen to be running instead
+// of the lock holder.  The priority goes back when the lock is released.
+//
+// Each lock also keeps count of how often threads had to wait for it,
+// and for how long, in a LockRecord shared by all locks of its name.
 
 class Lock {
   public:
@@ -77,12 +91,21 @@ class Lock {
     				// return true if the current thread 
 				// holds this lock.
     
-    // Note: SelfTest routine provided by SynchList
+    void SelfTest();		// test priority inheritance; the rest
+    				// is tested by SynchList
     
   private:
     char *name;			// debugging assist
     Thread *lockHolder;		// thread currently holding lock
-    Semaphore *semaphore;	// we use a semaphore to implement lock
+				// (NULL if the lock is FREE)
+    ThreadQueue queue;		// threads waiting in Acquire()
+    Lock *nextHeld;		// next lock held by lockHolder
+    LockRecord *record;		// contention statistics
+    long long acquireTime;	// when lockHolder got the lock
+
+    void Donate(Thread *waiter);
+    				// Lend "waiter"'s priority to the holder
+    int WaitingLevel(); 	// Best level of the waiting threads
 };
 
 // The following class defines a "condition variable".  A condition
@@ -130,7 +153,8 @@ class Condition {
     void Wait(Lock *conditionLock); 	// these are the 3 operations on 
 					// condition variables; releasing the 
 					// lock and going to sleep are 
-					// *atomic* in Wait()
+					// *atomic* in Wait().  Thread::Cancel
+					// can cut a Wait short.
     void Signal(Lock *conditionLock);   // conditionLock must be held by
     void Broadcast(Lock *conditionLock);// the currentThread for all of 
 					// these operations
@@ -138,6 +162,42 @@ class Condition {
 
   private:
     char* name;
-    List<Semaphore *> *waitQueue;	// list of waiting threads
+    ThreadQueue waitQueue;		// threads waiting in Wait()
+};
+
+// The following class defines a "reader-writer lock".  Any number of
+// readers may hold the lock at once, or else one writer.
+//
+//	AcquireRead -- wait until no writer holds the lock, or is
+//		waiting for it, then join the readers
+//
+//	AcquireWrite -- wait until no one holds the lock, then take it
+//
+// Writers have preference: once a writer is waiting, new readers wait
+// behind it, so a steady stream of readers cannot starve the writers.
+// When the last writer releases the lock, all the readers waiting for
+// it are woken up at once.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);	// initialize to "no one holds it"
+    ~RWLock();			// deallocate the lock
+    char* getName() { return name; }
+
+    void AcquireRead();		// share the lock with other readers
+    void ReleaseRead();
+    void AcquireWrite();	// hold the lock exclusively
+    void ReleaseWrite();
+
+    void SelfTest();		// test readers and writers
+
+  private:
+    char* name;
+    Lock *lock;			// protects the fields below
+    Condition *okToRead;	// readers wait here for the writers
+    Condition *okToWrite;	// writers wait here for everyone
+    int numReaders;		// # of threads holding the lock to read
+    bool writing;		// is a writer holding the lock?
+    int numWaitingWriters;	// # of writers in AcquireWrite
 };
 #endif // SYNCH_H
@@ -21,30 +21,77 @@
 #include "switch.h"
 #include "synch.h"
 #include "sysdep.h"
+#include "stackpool.h"
+#include "slab.h"
+#include "hostprofile.h"
 
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+//----------------------------------------------------------------------
+// Thread::operator new, operator delete
+// 	Every Fork needs a new thread control block; keep the ones
+//	freed by finished threads for the next one, rather than going
+//	to the heap each time.  (The stack is pooled separately.)
+//----------------------------------------------------------------------
+
+static SlabCache threadSlab("Thread", sizeof(Thread));
+
+void *
+Thread::operator new(size_t size)
+{
+    return threadSlab.Alloc(size);
+}
+
+void
+Thread::operator delete(void *p, size_t size)
+{
+    threadSlab.Free(p, size);
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	"stackWords" is the size of its stack, in words.
 //----------------------------------------------------------------------
 
-Thread::Thread(char* threadName)
+Thread::Thread(char* threadName, int stackWords)
 {
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackPool = NULL;
+    stackSize = stackWords;
     status = JUST_CREATED;
     for (int i = 0; i < MachineStateSize; i++) {
 	machineState[i] = NULL;		// not strictly necessary, since
 					// new thread ignores contents 
 					// of machine registers
     }
+    for (int i = 0; i < NumTotalRegs; i++) {
+	userRegisters[i] = 0;
+    }
     space = NULL;
+    userThreadId = -1;
+    queueNext = NULL;
+    schedLevel = 0;
+    schedTicks = 0;
+    inheritedLevel = NoInheritedLevel;
+    waitingFor = NULL;
+    locksHeld = NULL;
+    pass = 0;
+    cpuTicks = userTicks = 0;
+    readySince = readyTicks = 0;
+    dispatches = syscalls = 0;
+    programStats = NULL;
+    cpu = -1;
+    wakeTime = 0;
+    cancelled = FALSE;
+    waitingIn = NULL;
+    tickets = 0;
 }
 
 //----------------------------------------------------------------------
@@ -65,7 +112,7 @@ Thread::~Thread()
 
     ASSERT(this != kernel->currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	stackPool->Free(stack, stackSize * sizeof(int));
 }
 
 //----------------------------------------------------------------------
@@ -95,7 +142,7 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     Scheduler *scheduler = kernel->scheduler;
     IntStatus oldLevel;
     
-    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (int) func << " " << arg);
+    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (void *) func << " " << arg);
     
     StackAllocate(func, arg);
 
@@ -125,7 +172,7 @@ Thread::CheckOverflow()
 {
     if (stack != NULL) {
 #ifdef HPUX			// Stacks grow upward on the Snakes
-	ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT(stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT(*stack == STACK_FENCEPOST);
 #endif
@@ -149,6 +196,7 @@ Thread::Begin ()
     ASSERT(this == kernel->currentThread);
     DEBUG(dbgThread, "Beginning thread: " << name);
     
+    (void) HostProfile::Start(HostKernel);	// the switch to us is over
     kernel->scheduler->CheckToBeDestroyed();
     kernel->interrupt->Enable();
 }
@@ -175,20 +223,50 @@ Thread::Finish ()
     ASSERT(this == kernel->currentThread);
     
     DEBUG(dbgThread, "Finishing thread: " << name);
+    kernel->scheduler->ReportThread(this);
     
     Sleep(TRUE);				// invokes SWITCH
     // not reached
 }
 
+//----------------------------------------------------------------------
+// Thread::Cancel
+// 	Ask the thread to give up whatever it is waiting for (its
+//	process is exiting, say).  If it is asleep in Condition::Wait,
+//	or Semaphore::CancellableP, take it off the wait queue and make
+//	it ready, now.  From then on, until ClearCancel, code that checks
+//	IsCancelled before waiting does not wait at all.
+//
+//	To Condition::Wait, this looks like a spurious wakeup, which
+//	Mesa-style callers re-check for anyway; a caller that does not
+//	check IsCancelled simply waits again.
+//----------------------------------------------------------------------
+
+void
+Thread::Cancel()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    cancelled = TRUE;
+    if (waitingIn != NULL) {
+	ASSERT(status == BLOCKED);
+	if (waitingIn->Remove(this)) {
+	    kernel->scheduler->ReadyToRun(this);	// clears waitingIn
+	}
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // Thread::Yield
 // 	Relinquish the CPU if any other thread is ready to run.
 //	If so, put the thread on the end of the ready list, so that
 //	it will eventually be re-scheduled.
 //
-//	NOTE: returns immediately if no other thread on the ready queue.
-//	Otherwise returns when the thread eventually works its way
-//	to the front of the ready list and gets re-scheduled.
+//	NOTE: returns immediately if no other thread on the ready queue,
+//	or if the scheduling policy would rather run this thread than any
+//	of them.  Otherwise returns when the thread eventually works its
+//	way to the front of the ready list and gets re-scheduled.
 //
 //	NOTE: we disable interrupts, so that looking at the thread
 //	on the front of the ready list, and switching to it, can be done
@@ -208,10 +286,12 @@ Thread::Yield ()
     
     DEBUG(dbgThread, "Yielding thread: " << name);
     
-    nextThread = kernel->scheduler->FindNextToRun();
-    if (nextThread != NULL) {
-	kernel->scheduler->ReadyToRun(this);
+    kernel->scheduler->ReadyToRun(this);	// we compete, too: the policy
+    nextThread = kernel->scheduler->FindNextToRun(); // may still prefer us
+    if (nextThread != this) {
 	kernel->scheduler->Run(nextThread, FALSE);
+    } else {
+	status = RUNNING;
     }
     (void) kernel->interrupt->SetLevel(oldLevel);
 }
@@ -247,6 +327,9 @@ Thread::Sleep (bool finishing)
     DEBUG(dbgThread, "Sleeping thread: " << name);
 
     status = BLOCKED;
+    if (!finishing) {
+	kernel->scheduler->Blocked(this);
+    }
     while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
 	kernel->interrupt->Idle();	// no one to run, wait for an interrupt
     
@@ -292,7 +375,8 @@ PLabelToAddr(void *plabel)
 
 //----------------------------------------------------------------------
 // Thread::StackAllocate
-//	Allocate and initialize an execution stack.  The stack is
+//	Allocate and initialize an execution stack, from the kernel's
+//	pool of stacks (see stackpool.h).  The stack is
 //	initialized with an initial stack frame for ThreadRoot, which:
 //		enables interrupts
 //		calls (*func)(arg)
@@ -305,34 +389,35 @@ PLabelToAddr(void *plabel)
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stackPool = kernel->stackPool;
+    stack = stackPool->Allocate(stackSize * sizeof(int));
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
     // everyone else works the other way: from high addresses to low addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #endif
 
 #ifdef SPARC
-    stackTop = stack + StackSize - 96; 	// SPARC stack must contains at 
+    stackTop = stack + stackSize - 96; 	// SPARC stack must contains at 
 					// least 1 activation record 
 					// to start with.
     *stack = STACK_FENCEPOST;
 #endif 
 
 #ifdef PowerPC // RS6000
-    stackTop = stack + StackSize - 16; 	// RS6000 requires 64-byte frame marker
+    stackTop = stack + stackSize - 16; 	// RS6000 requires 64-byte frame marker
     *stack = STACK_FENCEPOST;
 #endif 
 
 #ifdef DECMIPS
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
     *stack = STACK_FENCEPOST;
 #endif
 
 #ifdef ALPHA
-    stackTop = stack + StackSize - 8;	// -8 to be on the safe side!
+    stackTop = stack + stackSize - 8;	// -8 to be on the safe side!
     *stack = STACK_FENCEPOST;
 #endif
 
@@ -341,10 +426,19 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
     // the x86 passes the return address on the stack.  In order for SWITCH() 
     // to go to ThreadRoot when we switch to this thread, the return addres 
     // used in SWITCH() must be the starting address of ThreadRoot.
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
     *(--stackTop) = (int) ThreadRoot;
     *stack = STACK_FENCEPOST;
 #endif
+
+#ifdef x86_64
+    // as on the x86, SWITCH() returns to ThreadRoot, through the
+    // address on the top of the stack.  The address is 8 bytes here,
+    // and has to be 16-byte aligned, as if ThreadRoot had been called.
+    stackTop = stack + stackSize - 8;	// -8 to be on the safe side!
+    *(void **) stackTop = (void *) ThreadRoot;
+    *stack = STACK_FENCEPOST;
+#endif
     
 #ifdef PARISC
     machineState[PCState] = PLabelToAddr(ThreadRoot);
@@ -416,10 +510,29 @@ SimpleThread(int which)
     }
 }
 
+//----------------------------------------------------------------------
+// SwitchThread
+// 	Yield the CPU "SwitchTestRounds" times, for timing context
+//	switches.
+//----------------------------------------------------------------------
+
+static const int SwitchTestRounds = 100000;
+
+static void
+SwitchThread(void *arg)
+{
+    for (int i = 0; i < SwitchTestRounds; i++) {
+        kernel->currentThread->Yield();
+    }
+}
+
 //----------------------------------------------------------------------
 // Thread::SelfTest
 // 	Set up a ping-pong between two threads, by forking a thread 
 //	to call SimpleThread, and then calling SimpleThread ourselves.
+//
+//	Then time the same thing without the printing, to see how fast
+//	we can switch threads (compare a 32-bit build with a 64-bit one).
 //----------------------------------------------------------------------
 
 void
@@ -428,9 +541,20 @@ Thread::SelfTest()
     DEBUG(dbgThread, "Entering Thread::SelfTest");
 
     Thread *t = new Thread("forked thread");
+    double start;
 
     t->Fork((VoidFunctionPtr) SimpleThread, (void *) 1);
     kernel->currentThread->Yield();
     SimpleThread(0);
+
+    t = new Thread("switch test");
+    t->Fork(SwitchThread, NULL);
+    start = HostMicroseconds();
+    SwitchThread(NULL);
+    cout << "Context switches per second: "
+	 << (int) (2 * SwitchTestRounds * 1000000.0
+		   / (HostMicroseconds() - start)) << "\n";
+    kernel->currentThread->Yield();	// let it finish, so it is not
+					// still around for the next test
 }
 
@@ -44,6 +44,8 @@
 #include "machine.h"
 #include "addrspace.h"
 
+class StackPool;
+
 // CPU register state to be saved on context switch.  
 // The x86 needs to save only a few registers, 
 // SPARC and MIPS needs to save 10 registers, 
@@ -54,7 +56,8 @@
 #define MachineStateSize 75 
 
 
-// Size of the thread's private execution stack.
+// Size of the thread's private execution stack, unless it asks for
+// some other size.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);	// in words
 
@@ -62,6 +65,13 @@ const int StackSize = (8 * 1024);	// in words
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
+// The inheritedLevel of a thread that no one is waiting on
+const int NoInheritedLevel = 0x7fffffff;
+
+class Lock;
+class SpaceRecord;
+class ThreadQueue;
+
 
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
@@ -82,7 +92,8 @@ class Thread {
     void *machineState[MachineStateSize];  // all registers except for stackTop
 
   public:
-    Thread(char* debugName);		// initialize a Thread 
+    Thread(char* debugName, int stackWords = StackSize);
+					// initialize a Thread 
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
@@ -98,19 +109,29 @@ class Thread {
 				// relinquish the processor
     void Begin();		// Startup code for the thread	
     void Finish();  		// The thread is done executing
+    void Cancel();		// Stop waiting: wake the thread up if
+				// it is asleep in a wait that allows it
+    bool IsCancelled() { return cancelled; }
+    void ClearCancel() { cancelled = FALSE; }
     
     void CheckOverflow();   	// Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return status; }
     char* getName() { return (name); }
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
 
+    void *operator new(size_t size);	// Threads come from a slab cache
+    void operator delete(void *p, size_t size);
+
   private:
     // some of the private data for this class is listed above
     
     int *stack; 	 	// Bottom of the stack 
 				// NULL if this is the main thread
 				// (If NULL, don't deallocate stack)
+    int stackSize;		// # of words in the stack
+    StackPool *stackPool;	// Pool the stack came from, and goes back to
     ThreadStatus status;	// ready, running or blocked
     char* name;
 
@@ -127,8 +148,90 @@ class Thread {
   public:
     void SaveUserState();		// save user-level register state
     void RestoreUserState();		// restore user-level register state
+    void SetUserRegister(int num, int value) { userRegisters[num] = value; }
+					// set up the user-level state of a
+					// thread that has not yet run
 
     AddrSpace *space;			// User code this thread is running.
+    int userThreadId;			// ThreadId within "space", if any
+
+// Scheduling state, kept by the scheduling policy (see schedpolicy.h).
+
+    Thread *queueNext;			// next thread on the same ThreadQueue
+					// (a ready queue, or the wait queue
+					// of a semaphore, lock or condition)
+    int schedLevel;			// MLFQ priority level; 0 is highest
+    int schedTicks;			// timer interrupts used so far of the
+					// current quantum
+    int inheritedLevel;			// best schedLevel of the threads
+					// waiting (perhaps through other
+					// locks) for a lock this one holds
+    Lock *waitingFor;			// lock it is waiting to acquire
+    Lock *locksHeld;			// locks it holds, most recent first
+    unsigned int pass;			// stride scheduling: virtual time at
+					// which it should run next
+    long long cpuTicks;			// time it has spent running
+    long long userTicks;		// of that, time running user code
+    long long readySince;		// when it last became ready to run
+    long long readyTicks;		// time it has spent ready to run
+    int dispatches;			// # of times it has been switched to
+    int syscalls;			// # of system calls it has made
+    SpaceRecord *programStats;		// statistics for the program it
+					// runs (see AddrSpace), or NULL
+    int cpu;				// CPU it is running or ready on, or
+					// last ran on; -1 if it has not yet
+    long long wakeTime;			// timer interrupt to wake up at,
+					// while in Alarm::WaitUntil
+    bool cancelled;			// has Cancel been called (since the
+					// last ClearCancel)?
+    ThreadQueue *waitingIn;		// wait queue it is asleep on, if
+					// Cancel may take it off early
+
+    void setTickets(int n) { tickets = n; }	// Set its share of the CPU
+    int getTickets() { return tickets; }	// (0 -- not set)
+
+  private:
+    int tickets;			// share of the CPU, for proportional
+					// share scheduling
+};
+
+// The following class defines a FIFO queue of threads, linked through
+// the threads themselves, so that putting a thread on a queue never
+// allocates memory.  A thread can be on at most one ThreadQueue at once.
+
+class ThreadQueue {
+  public:
+    ThreadQueue() { first = last = NULL; }
+
+    bool IsEmpty() { return first == NULL; }
+    Thread *Front() { return first; }	// First thread, without removing it
+    void Append(Thread *thread) {	// Put "thread" on the end
+	thread->queueNext = NULL;
+	if (first == NULL) { first = thread; } else { last->queueNext = thread; }
+	last = thread; }
+    Thread *RemoveFront() {		// Take the first thread off, or
+	Thread *thread = first;		// return NULL if empty
+	if (thread != NULL) { first = thread->queueNext; }
+	return thread; }
+    bool Remove(Thread *thread) {	// Take "thread" off, if it is on
+	Thread **p = &first, *prev = NULL;
+	for (; *p != NULL && *p != thread; prev = *p, p = &(*p)->queueNext) {}
+	if (*p == NULL) { return FALSE; }
+	*p = thread->queueNext;
+	if (last == thread) { last = prev; }
+	return TRUE; }
+    void Concatenate(ThreadQueue *other) { // Move all of "other" onto
+	if (other->first == NULL) { return; } // the end, leaving it empty
+	if (first == NULL) { first = other->first; }
+	else { last->queueNext = other->first; }
+	last = other->last;
+	other->first = other->last = NULL; }
+    void Apply(void (*f)(Thread *)) {	// Call "f" on each thread in order
+	for (Thread *t = first; t != NULL; t = t->queueNext) { (*f)(t); } }
+
+  private:
+    Thread *first;			// NULL if the queue is empty
+    Thread *last;			// meaningless if the queue is empty
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
@@ -0,0 +1,186 @@
+// timerwheel.cc
+//	Routines to put threads to sleep on a hierarchical timer wheel,
+//	and to take them off again when they are due.
+//
+//	These routines assume that interrupts are already disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "timerwheel.h"
+
+//----------------------------------------------------------------------
+// SlotIndex
+// 	Return the slot of "level" that interrupt "when" falls in.
+//----------------------------------------------------------------------
+
+static int
+SlotIndex(long long when, int level)
+{
+    return (int) ((when >> (level * WheelBits)) & (WheelSlots - 1));
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::TimerWheel
+// 	Initialize a timer wheel, with no threads on it.
+//----------------------------------------------------------------------
+
+TimerWheel::TimerWheel()
+{
+    current = 0;
+    numSleeping = 0;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Place
+// 	Put "thread" in the slot for its wakeup time, at the lowest
+//	level that reaches that far ahead of the current interrupt.  A
+//	thread that is already due goes in the current slot; one too
+//	far ahead for the top level goes in the top level's last slot,
+//	and is placed again when that slot comes round.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Place(Thread *thread)
+{
+    long long when = max(thread->wakeTime, current);
+    int level;
+
+    for (level = 0; level < WheelLevels - 1; level++) {
+	if (when - current < (1 << ((level + 1) * WheelBits))) {
+	    break;
+	}
+    }
+    if (when - current >= (1 << (WheelLevels * WheelBits))) {
+	when = current + (1 << (WheelLevels * WheelBits)) - 1;
+    }
+    slots[level][SlotIndex(when, level)].Append(thread);
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Insert
+// 	Put "thread" to sleep until timer interrupt number "when".
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Insert(Thread *thread, long long when)
+{
+    thread->wakeTime = when;
+    Place(thread);
+    numSleeping++;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Cascade
+// 	The level below has come round to slot 0: move the threads in the
+//	current slot of "level" down to where they belong now.  If this
+//	level has come round to slot 0 too, do the level above first.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Cascade(int level)
+{
+    int index = SlotIndex(current, level);
+    ThreadQueue moving;
+    Thread *thread;
+
+    if (index == 0 && level + 1 < WheelLevels) {
+	Cascade(level + 1);
+    }
+    moving.Concatenate(&slots[level][index]);
+    while ((thread = moving.RemoveFront()) != NULL) {
+	Place(thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Advance
+// 	Turn the wheel through every interrupt up to and including
+//	"now", moving the threads that are due onto "expired".
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Advance(long long now, ThreadQueue *expired)
+{
+    for (; current <= now; current++) {
+	int index = SlotIndex(current, 0);
+
+	if (index == 0) {
+	    Cascade(1);
+	}
+	for (Thread *t = slots[0][index].Front(); t != NULL; t = t->queueNext) {
+	    numSleeping--;
+	}
+	expired->Concatenate(&slots[0][index]);
+    }
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::NextTurn
+// 	Return the first interrupt, from the current one on, at which
+//	turning the wheel will do something: wake up threads in the bottom
+//	level, or move a slot of a higher level down.  (The threads in a
+//	higher level slot may not be due then; the wheel will know better
+//	once they have moved down.)  Return -1 if no thread is sleeping.
+//----------------------------------------------------------------------
+
+long long
+TimerWheel::NextTurn()
+{
+    long long next = -1;
+
+    if (numSleeping == 0) {
+	return -1;
+    }
+    for (int level = 0; level < WheelLevels; level++) {
+	int shift = level * WheelBits;
+
+	// the slots of this level come round at multiples of 1 << shift;
+	// look at each in turn, up to one full revolution ahead
+	for (int k = 0; k <= WheelSlots; k++) {
+	    long long block = (current >> shift) + k;
+	    long long when = block << shift;
+
+	    if (when < current) {
+		continue;		// this slot has already come round
+	    }
+	    if (next != -1 && when >= next) {
+		break;			// nothing here will be any sooner
+	    }
+	    if (!slots[level][block & (WheelSlots - 1)].IsEmpty()) {
+		next = when;
+		break;
+	    }
+	}
+    }
+    return next;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Print
+// 	Print the sleeping threads, level by level, for debugging.
+//----------------------------------------------------------------------
+
+static void
+PrintSleeper(Thread *thread)
+{
+    cout << " " << thread->getName() << "@" << thread->wakeTime;
+}
+
+void
+TimerWheel::Print()
+{
+    cout << "Timer wheel at interrupt " << current << ", " << numSleeping
+	 << " sleeping threads, next turn " << NextTurn() << "\n";
+    for (int level = 0; level < WheelLevels; level++) {
+	for (int i = 0; i < WheelSlots; i++) {
+	    if (!slots[level][i].IsEmpty()) {
+		cout << "  level " << level << " slot " << i << ":";
+		slots[level][i].Apply(PrintSleeper);
+		cout << "\n";
+	    }
+	}
+    }
+}
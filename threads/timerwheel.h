@@ -0,0 +1,61 @@
+// timerwheel.h
+//	Data structures for keeping track of sleeping threads, by the
+//	time they are to be woken up.
+//
+//	Time is counted in timer interrupts.  The wheel has WheelLevels
+//	levels of WheelSlots slots each; each slot is a queue of threads.
+//	A thread due within WheelSlots interrupts goes in the bottom
+//	level, in the slot for its own interrupt; a thread due later goes
+//	in a higher level, whose slots each cover WheelSlots times as
+//	many interrupts as the level below.  Each interrupt, the wheel
+//	turns one slot, and the threads in that bottom-level slot are
+//	due.  Whenever the bottom level comes back around to slot 0, the
+//	next slot of the level above is emptied down into it.
+//
+//	So putting a thread to sleep takes constant time, and so does
+//	waking up the threads that are due at an interrupt (not counting
+//	moving threads down a level, which happens at most WheelLevels
+//	times for each thread).  Nothing is allocated: threads are kept
+//	in ThreadQueues.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "copyright.h"
+#include "thread.h"
+
+#define WheelBits	6			// log2(WheelSlots)
+#define WheelSlots	(1 << WheelBits)	// # of slots in each level
+#define WheelLevels	4			// # of levels
+
+// The following class defines a hierarchical timer wheel of threads.
+
+class TimerWheel {
+  public:
+    TimerWheel();		// Initialize an empty wheel, at time 0
+
+    void Insert(Thread *thread, long long when);
+				// "thread" is to wake at interrupt "when"
+    void Advance(long long now, ThreadQueue *expired);
+				// Turn the wheel up to interrupt "now",
+				// putting the threads due on "expired"
+    int NumSleeping() { return numSleeping; }
+    long long NextTurn();	// Next interrupt at which the wheel has
+				// something to do, or -1 if it is empty
+
+    void Print();		// Print the contents of the wheel
+
+  private:
+    ThreadQueue slots[WheelLevels][WheelSlots];
+    long long current;		// the next interrupt to expire
+    int numSleeping;		// # of threads on the wheel
+
+    void Place(Thread *thread);	// Put "thread" in its slot
+    void Cascade(int level);	// Move a slot of "level" down
+};
+
+#endif // TIMERWHEEL_H
@@ -20,6 +20,36 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "bitmap.h"
+#include "synch.h"
+#include "syscall.h"
+#include "ipc.h"
+
+// number of pages in each user thread's stack
+static const unsigned int UserStackPages = divRoundUp(UserStackSize, PageSize);
+
+// number of address spaces, besides the first one, each page frame is
+// mapped into (see MapShared)
+static int frameShares[NumPhysPages];
+
+// programs kept in host memory by CacheProgram
+static ProgramImage *programCache = NULL;
+
+//----------------------------------------------------------------------
+// ReleaseFrame
+// 	An address space is done with a page frame.  Put the frame back
+//	in the kernel's frame map, unless it is still shared.
+//----------------------------------------------------------------------
+
+static void
+ReleaseFrame(int frame)
+{
+    if (frameShares[frame] > 0) {
+	frameShares[frame]--;
+    } else {
+	kernel->frameMap->Clear(frame);
+    }
+}
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -60,37 +90,201 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	The page table starts out empty; Load allocates a physical
+//	page frame for each page of the program, from the frames that
+//	are not in use by any other address space.
+//
+//	The program and its stacks grow up from virtual page 0, while
+//	pages shared with other address spaces are mapped in from the
+//	top of the page table down.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
     pageTable = new TranslationEntry[NumPhysPages];
     for (int i = 0; i < NumPhysPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virt page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = -1;
+	pageTable[i].valid = FALSE;
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
 	pageTable[i].readOnly = FALSE;  
     }
-    
-    // zero out the entire address space
-    bzero(kernel->machine->mainMemory, MemorySize);
+
+    numPages = stackBase = 0;
+    mapBase = NumPhysPages;
+    spaceId = -1;
+    tickets = 0;
+    record = NULL;
+    threadMap = new Bitmap(MaxUserThreads);
+    numThreads = 0;
+    nextGeneration = 0;
+    threadLock = new Lock("thread table");
+    threadExited = new Condition("thread exited");
+    for (int i = 0; i < MaxUserThreads; i++) {
+	mailboxes[i] = new Mailbox("mailbox");
+    }
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, returning its page frames.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+   for (int i = 0; i < NumPhysPages; i++) {
+	if (pageTable[i].valid) {
+	    ReleaseFrame(pageTable[i].physicalPage);
+	}
+   }
+   delete [] pageTable;
+   delete threadMap;
+   delete threadLock;
+   delete threadExited;
+   for (int i = 0; i < MaxUserThreads; i++) {
+	delete mailboxes[i];
+   }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocatePages
+// 	Back virtual pages [numPages, newSize) with zeroed physical
+//	page frames, and grow the address space to "newSize" pages.
+//	Either all of the pages get a frame, or none do.
+//
+// Returns:
+//	FALSE if there are not enough free frames.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::AllocatePages(unsigned int newSize)
+{
+    unsigned int i;
+
+    if (newSize > mapBase ||
+	    (int) (newSize - numPages) > kernel->frameMap->NumClear()) {
+	return FALSE;
+    }
+    for (i = numPages; i < newSize; i++) {
+	pageTable[i].physicalPage = kernel->frameMap->FindAndSet();
+	pageTable[i].valid = TRUE;
+	pageTable[i].use = FALSE;
+	pageTable[i].dirty = FALSE;
+	bzero(&kernel->machine->mainMemory[pageTable[i].physicalPage * PageSize],
+		PageSize);
+    }
+    numPages = newSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CacheProgram
+// 	Read the whole of the program in "fileName" into host memory,
+//	so that Load copies it from there, rather than reading the file
+//	each time.  This is for a batch of jobs (see batch.h): the
+//	programs are cached once, before the jobs are forked, and then
+//	every job shares the same copy.
+//
+//	Only the stub file system's files can be read without a kernel;
+//	with the real one, nothing is cached (the program is read from the
+//	Nachos disk, as usual).
+//
+//	Returns FALSE if there is no such program.
+//----------------------------------------------------------------------
+
+static ProgramImage *
+FindProgram(char *fileName)
+{
+    for (ProgramImage *image = programCache; image != NULL;
+		image = image->next) {
+	if (strcmp(image->name, fileName) == 0) {
+	    return image;
+	}
+    }
+    return NULL;
 }
 
+bool
+AddrSpace::CacheProgram(char *fileName)
+{
+#ifdef FILESYS_STUB
+    ProgramImage *image;
+    int fd;
+
+    if (FindProgram(fileName) != NULL) {
+	return TRUE;
+    }
+    if ((fd = OpenForReadWrite(fileName, FALSE)) < 0) {
+	return FALSE;
+    }
+    image = new ProgramImage;
+    image->name = new char[strlen(fileName) + 1];
+    strcpy(image->name, fileName);
+    Lseek(fd, 0, 2);
+    image->length = Tell(fd);
+    Lseek(fd, 0, 0);
+    image->contents = new char[image->length];
+    Read(fd, image->contents, image->length);
+    Close(fd);
+    image->next = programCache;
+    programCache = image;
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ReadProgram
+// 	Read "numBytes" at "position" in the program, from its cached
+//	"image", if it has one, or else from the "executable" file.
+//	Anything past the end of the image reads as zeroes.
+//----------------------------------------------------------------------
+
+static void
+ReadProgram(OpenFile *executable, ProgramImage *image, char *into,
+		int numBytes, int position)
+{
+    int n = 0;
+
+    if (image == NULL) {
+	executable->ReadAt(into, numBytes, position);
+	return;
+    }
+    if (position >= 0 && position < image->length) {
+	n = min(numBytes, image->length - position);
+	bcopy(image->contents + position, into, n);
+    }
+    bzero(into + n, numBytes - n);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Copy "size" bytes at "inFileAddr" in the executable (or its
+//	cached image) into the address space, starting at virtual
+//	address "virtualAddr".  The
+//	pages of a segment need not be contiguous in physical memory, so
+//	copy one page (or part of a page) at a time.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(OpenFile *executable, ProgramImage *image,
+			int virtualAddr, int size, int inFileAddr)
+{
+    unsigned int paddr;
+    int chunk;
+    ExceptionType exception;
+
+    while (size > 0) {
+	chunk = min(size, PageSize - virtualAddr % PageSize);
+	exception = Translate(virtualAddr, &paddr, 0);
+	ASSERT(exception == NoException);
+	ReadProgram(executable, image, &(kernel->machine->mainMemory[paddr]),
+			chunk, inFileAddr);
+	virtualAddr += chunk;
+	inFileAddr += chunk;
+	size -= chunk;
+    }
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::Load
@@ -100,25 +294,32 @@ AddrSpace::~AddrSpace()
 //	the object code file is in NOFF format.
 //
 //	"fileName" is the file containing the object code to load into memory
+//	(the file is not opened if the program has been cached)
 //----------------------------------------------------------------------
 
 bool 
 AddrSpace::Load(char *fileName) 
 {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
+    ProgramImage *image = FindProgram(fileName);
+    OpenFile *executable = NULL;
     NoffHeader noffH;
     unsigned int size;
 
-    if (executable == NULL) {
+    if (image == NULL &&
+		(executable = kernel->fileSystem->Open(fileName)) == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
 	return FALSE;
     }
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    ReadProgram(executable, image, (char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
     	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    if (noffH.noffMagic != NOFFMAGIC) {
+	cerr << "Not a Nachos executable: " << fileName << "\n";
+	delete executable;
+	return FALSE;
+    }
 
 #ifdef RDATA
 // how big is address space?
@@ -132,30 +333,30 @@ AddrSpace::Load(char *fileName)
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
 #endif
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+    size = divRoundUp(size, PageSize);
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
+    // check we're not trying to run anything too big --
+    // at least until we have virtual memory
+    if (!AllocatePages(size)) {
+	cerr << "Not enough memory to run " << fileName << "\n";
+	delete executable;
+	return FALSE;
+    }
+    stackBase = numPages;
 
-    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << numPages * PageSize);
 
 // then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
     if (noffH.code.size > 0) {
         DEBUG(dbgAddr, "Initializing code segment.");
 	DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
-			noffH.code.size, noffH.code.inFileAddr);
+	LoadSegment(executable, image, noffH.code.virtualAddr, noffH.code.size,
+			noffH.code.inFileAddr);
     }
     if (noffH.initData.size > 0) {
         DEBUG(dbgAddr, "Initializing data segment.");
 	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
+	LoadSegment(executable, image, noffH.initData.virtualAddr,
 			noffH.initData.size, noffH.initData.inFileAddr);
     }
 
@@ -163,13 +364,14 @@ AddrSpace::Load(char *fileName)
     if (noffH.readonlyData.size > 0) {
         DEBUG(dbgAddr, "Initializing read only data segment.");
 	DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
+	LoadSegment(executable, image, noffH.readonlyData.virtualAddr,
 			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
     }
 #endif
 
     delete executable;			// close file
+    record = kernel->stats->FindSpace(fileName);
+    record->processes++;
     return TRUE;			// success
 }
 
@@ -186,7 +388,10 @@ void
 AddrSpace::Execute() 
 {
 
-    kernel->currentThread->space = this;
+    if (kernel->currentThread->userThreadId < 0) {
+	(void) AddThread(kernel->currentThread);  // the main thread takes
+						  // the program's own stack
+    }
 
     this->InitRegisters();		// set the initial register values
     this->RestoreState();		// load page table register
@@ -257,7 +462,7 @@ void AddrSpace::SaveState()
 void AddrSpace::RestoreState() 
 {
     kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    kernel->machine->pageTableSize = NumPhysPages;
 }
 
 
@@ -277,7 +482,7 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     unsigned int      vpn    = vaddr / PageSize;
     unsigned int      offset = vaddr % PageSize;
 
-    if(vpn >= numPages) {
+    if(vpn >= NumPhysPages || !pageTable[vpn].valid) {
         return AddressErrorException;
     }
 
@@ -311,6 +516,345 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     return NoException;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn, CopyOut
+//	Copy "size" bytes between the kernel buffer "buf" and the user
+//	buffer at virtual address "vaddr".  The user buffer may span
+//	several pages, which need not be contiguous in physical memory.
+//
+//	Returns the number of bytes copied, or EFAULT if any part of
+//	the user buffer is not in the address space (in which case some
+//	of it may have been copied already).
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyIn(int vaddr, char *buf, int size)
+{
+    unsigned int paddr;
+    int chunk, done;
+
+    for (done = 0; done < size; done += chunk) {
+	if (Translate(vaddr + done, &paddr, 0) != NoException) {
+	    return EFAULT;
+	}
+	chunk = min(size - done, PageSize - (vaddr + done) % PageSize);
+	bcopy(&kernel->machine->mainMemory[paddr], buf + done, chunk);
+    }
+    return size;
+}
+
+int
+AddrSpace::CopyOut(int vaddr, char *buf, int size)
+{
+    unsigned int paddr;
+    int chunk, done;
+
+    for (done = 0; done < size; done += chunk) {
+	if (Translate(vaddr + done, &paddr, 1) != NoException) {
+	    return EFAULT;
+	}
+	chunk = min(size - done, PageSize - (vaddr + done) % PageSize);
+	bcopy(buf + done, &kernel->machine->mainMemory[paddr], chunk);
+    }
+    return size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+//	Copy the null-terminated user string at virtual address "vaddr"
+//	into the kernel buffer "buf", which holds "size" bytes.
+//
+//	Returns the length of the string, EFAULT if it runs off the end
+//	of the address space, or ENAMETOOLONG if it does not fit in "buf".
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyInString(int vaddr, char *buf, int size)
+{
+    unsigned int paddr;
+
+    for (int i = 0; i < size; i++) {
+	if (Translate(vaddr + i, &paddr, 0) != NoException) {
+	    return EFAULT;
+	}
+	buf[i] = kernel->machine->mainMemory[paddr];
+	if (buf[i] == '\0') {
+	    return i;
+	}
+    }
+    return ENAMETOOLONG;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StackTop
+//	Return the initial stack pointer for the user thread in "slot".
+//	Slot 0 runs on the stack allocated by Load; the stack for slot
+//	i > 0 occupies the i'th UserStackSize region above it.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::StackTop(int slot)
+{
+    return (stackBase + slot * UserStackPages) * PageSize - 16;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddThread
+//	Enter "thread" in the join table, and carve a user stack for it
+//	out of the address space.  Stack pages, once allocated, stay
+//	with the address space, to be reused by later threads.
+//
+//	Returns the ThreadId of the new thread, or EAGAIN if the join
+//	table is full, or ENOMEM if there is no room for another stack.
+//	The slot number is the ThreadId modulo MaxUserThreads; the rest
+//	of the ThreadId keeps a recycled slot from answering to a stale id.
+//
+//	"thread" is the kernel thread that will run the user thread.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddThread(Thread *thread)
+{
+    int slot, id;
+    unsigned int needed;
+
+    threadLock->Acquire();
+    slot = threadMap->FindAndSet();
+    if (slot < 0) {
+	threadLock->Release();
+	return EAGAIN;
+    }
+    needed = stackBase + slot * UserStackPages;
+    if (needed > numPages) {
+	if (!AllocatePages(needed)) {
+	    threadMap->Clear(slot);
+	    threadLock->Release();
+	    return ENOMEM;
+	}
+	if (kernel->currentThread->space == this) {
+	    RestoreState();		// make the new stack addressable now
+	}
+    }
+
+    id = nextGeneration++ * MaxUserThreads + slot;
+    threadIds[slot] = id;
+    exited[slot] = FALSE;
+    numThreads++;
+    thread->space = this;
+    thread->programStats = record;
+    thread->userThreadId = id;
+    thread->SetUserRegister(StackReg, StackTop(slot));
+    mailboxes[slot]->Open();
+    threadLock->Release();
+
+    DEBUG(dbgAddr, "Added user thread " << id << ", stack at " << StackTop(slot));
+    return id;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExecuteThread
+//	Run a forked user thread, using the current (kernel) thread.
+//	Like Execute, except that the initial register values were set
+//	up by whoever forked the thread (see AddThread and SysThreadFork),
+//	since a thread that has not run yet has no other way to get them.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ExecuteThread()
+{
+    kernel->currentThread->RestoreUserState();	// set the initial registers
+    this->RestoreState();			// load page table register
+
+    kernel->machine->Run();		// jump to the user thread
+
+    ASSERTNOTREACHED();			// the thread leaves user mode
+					// for good by calling ThreadExit
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ThreadExit
+//	Record the exit value of the current user thread, and wake up
+//	anyone waiting to join it.  The slot (and the stack that goes
+//	with it) stays allocated until the thread is joined.
+//
+// Returns:
+//	The number of threads still running in this address space.
+//
+//	"exitCode" is the value returned to the joiner
+//----------------------------------------------------------------------
+
+int
+AddrSpace::ThreadExit(int exitCode)
+{
+    int id = kernel->currentThread->userThreadId;
+    int slot = id % MaxUserThreads;
+    int left;
+
+    mailboxes[slot]->Close();		// turn away any more messages
+
+    threadLock->Acquire();
+    ASSERT(threadMap->Test(slot) && threadIds[slot] == id && !exited[slot]);
+    exitValues[slot] = exitCode;
+    exited[slot] = TRUE;
+    left = --numThreads;
+    threadExited->Broadcast(threadLock);
+    threadLock->Release();
+
+    DEBUG(dbgAddr, "User thread " << id << " exited with " << exitCode);
+    return left;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ThreadJoin
+//	Wait until the thread "id" of this address space has exited,
+//	then free its slot and stack.
+//
+// Returns:
+//	The exit value of the thread; ESRCH if there is no such thread
+//	(or somebody else joined it first), EDEADLK if a thread tries to
+//	join itself, EINTR if the joiner is cancelled while it waits.
+//----------------------------------------------------------------------
 
+int
+AddrSpace::ThreadJoin(int id)
+{
+    int slot = id % MaxUserThreads;
+    int exitCode;
 
+    if (id < 0) {
+	return ESRCH;
+    }
+    if (id == kernel->currentThread->userThreadId) {
+	return EDEADLK;
+    }
+
+    threadLock->Acquire();
+    while (threadMap->Test(slot) && threadIds[slot] == id && !exited[slot]) {
+	if (kernel->currentThread->IsCancelled()) {
+	    threadLock->Release();
+	    return EINTR;
+	}
+	threadExited->Wait(threadLock);
+    }
+    if (!threadMap->Test(slot) || threadIds[slot] != id) {
+	threadLock->Release();
+	return ESRCH;
+    }
+    exitCode = exitValues[slot];
+    threadMap->Clear(slot);
+    threadLock->Release();
+
+    return exitCode;
+}
 
+//----------------------------------------------------------------------
+// AddrSpace::FindMailbox
+//	Return the mailbox of user thread "id" of this address space,
+//	or NULL if there is no such thread (or it has exited).
+//----------------------------------------------------------------------
+
+Mailbox *
+AddrSpace::FindMailbox(int id)
+{
+    int slot = id % MaxUserThreads;
+
+    if (id < 0 || !threadMap->Test(slot) || threadIds[slot] != id ||
+	    exited[slot]) {
+	return NULL;
+    }
+    return mailboxes[slot];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CloseMailboxes
+//	The program is exiting: wake up any of its threads that are
+//	waiting in Ipc, and turn away any more messages.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::CloseMailboxes()
+{
+    for (int i = 0; i < MaxUserThreads; i++) {
+	mailboxes[i]->Close();
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapShared
+//	Map "count" pages of address space "from", starting at virtual
+//	address "vaddr", into this address space, below any pages that
+//	are shared already.  From now on both address spaces see the
+//	same page frames, until they are deleted.
+//
+// Returns:
+//	The virtual address of the pages in this address space; EINVAL
+//	if "vaddr" is not page aligned or "count" is not positive;
+//	EFAULT if the pages are not all in "from"; ENOMEM if there is
+//	no room for them here.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::MapShared(AddrSpace *from, int vaddr, int count)
+{
+    unsigned int vpn = vaddr / PageSize;
+    unsigned int base;
+    int i;
+
+    if (vaddr < 0 || vaddr % PageSize != 0 || count <= 0) {
+	return EINVAL;
+    }
+    if (vpn + count > NumPhysPages) {
+	return EFAULT;
+    }
+    for (i = 0; i < count; i++) {
+	if (!from->pageTable[vpn + i].valid) {
+	    return EFAULT;
+	}
+    }
+    if (mapBase < numPages + count) {
+	return ENOMEM;
+    }
+
+    base = mapBase - count;
+    for (i = 0; i < count; i++) {
+	TranslationEntry *entry = &pageTable[base + i];
+
+	*entry = from->pageTable[vpn + i];
+	entry->virtualPage = base + i;
+	entry->use = entry->dirty = FALSE;
+	frameShares[entry->physicalPage]++;
+    }
+    mapBase = base;
+
+    DEBUG(dbgAddr, "Mapped " << count << " shared pages at " << base * PageSize);
+    return base * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapShared
+//	Take back "count" pages mapped at "vaddr" by MapShared, when
+//	they turn out not to be wanted after all (the message saying
+//	where they are could not be delivered).  If nothing has been
+//	mapped below them since, the room can be used again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::UnmapShared(int vaddr, int count)
+{
+    unsigned int base = vaddr / PageSize;
+
+    ASSERT(vaddr % PageSize == 0 && base >= mapBase
+	   && base + count <= NumPhysPages);
+    for (int i = 0; i < count; i++) {
+	TranslationEntry *entry = &pageTable[base + i];
+
+	ASSERT(entry->valid);
+	ReleaseFrame(entry->physicalPage);
+	entry->valid = FALSE;
+	entry->physicalPage = -1;
+    }
+    if (mapBase == base) {
+	mapBase = base + count;
+    }
+    DEBUG(dbgAddr, "Unmapped " << count << " shared pages at " << vaddr);
+}
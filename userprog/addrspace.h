@@ -2,7 +2,8 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
+//	Each address space gets its own page frames from the kernel's
+//	frame map, so several programs can be in memory at once.
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
@@ -17,6 +18,25 @@
 #include "filesys.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxUserThreads		8	// user threads per address space,
+					// including the one running main
+
+class Thread;
+class Bitmap;
+class Lock;
+class Condition;
+class Mailbox;
+class SpaceRecord;
+
+// A user program, read into memory by AddrSpace::CacheProgram.
+
+class ProgramImage {
+  public:
+    char *name;				// file it was read from (a copy)
+    char *contents;			// the whole file
+    int length;				// # of bytes in it
+    ProgramImage *next;			// next program in the cache
+};
 
 class AddrSpace {
   public:
@@ -27,6 +47,12 @@ class AddrSpace {
                                         // a file
 					// return false if not found
 
+    static bool CacheProgram(char *fileName);
+					// Keep a copy of the program in
+					// host memory, for Load to use from
+					// now on; FALSE if there's no such
+					// program
+
     void Execute();             	// Run a program
 					// assumes the program has already
                                         // been loaded
@@ -39,14 +65,79 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    // Move data between the kernel and a user buffer at virtual
+    // address _vaddr_.  Return the # of bytes copied (not counting
+    // the null, for strings), or a negative error code.
+    int CopyIn(int vaddr, char *buf, int size);
+    int CopyOut(int vaddr, char *buf, int size);
+    int CopyInString(int vaddr, char *buf, int size);
+
+    int getSpaceId() { return spaceId; }	// SpaceId of the process
+    void setSpaceId(int id) { spaceId = id; }	// running in this space
+
+    int getTickets() { return tickets; }	// Share of the CPU for each
+    void setTickets(int n) { tickets = n; }	// thread (0 -- not set)
+
+    // User threads sharing this address space.  Each one gets a slot
+    // in the join table, and every slot but the first gets its own
+    // user stack carved out above the program's stack.
+
+    int AddThread(Thread *thread);	// Give "thread" a slot and a user
+					// stack; return its ThreadId, or
+					// a negative error code
+    void ExecuteThread();		// Run a forked user thread
+    int ThreadExit(int exitCode);	// Record the current thread's exit
+					// value; return # of threads left
+    int ThreadJoin(int id);		// Wait for thread "id" to exit and
+					// return its exit value
+
+    // Inter-process communication (see ipc.h)
+
+    Mailbox *FindMailbox(int id);	// Mailbox of thread "id", if any
+    void CloseMailboxes();		// Stop taking messages for any thread
+    int MapShared(AddrSpace *from, int vaddr, int count);
+					// Share "count" pages of "from" with
+					// this space; return where they went
+    void UnmapShared(int vaddr, int count);
+					// Undo a MapShared that returned
+					// "vaddr"
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    int spaceId;			// entry in the process table
+    int tickets;			// CPU share of each thread, if set
+    SpaceRecord *record;		// statistics for the program loaded,
+					// shared with its threads
+    unsigned int mapBase;		// Lowest page mapped from another
+					// address space; pages from numPages
+					// up to here are not in use
+    unsigned int stackBase;		// First page above the program's
+					// own stack; user thread stacks
+					// are allocated from here up
+
+    Bitmap *threadMap;			// slots in use in the join table
+    int threadIds[MaxUserThreads];	// ThreadId of the thread in each slot
+    int exitValues[MaxUserThreads];	// exit value, once it has exited
+    bool exited[MaxUserThreads];	// has the thread in the slot exited?
+    int numThreads;			// # of threads that have not exited
+    int nextGeneration;			// makes recycled ThreadIds unique
+    Lock *threadLock;			// protects the join table
+    Condition *threadExited;		// signalled whenever a thread exits
+    Mailbox *mailboxes[MaxUserThreads];	// Ipc mailbox of each slot
 
+    bool AllocatePages(unsigned int newSize);
+					// Give pages [numPages, newSize)
+					// each a page frame of its own
+    void LoadSegment(OpenFile *executable, ProgramImage *image,
+			int virtualAddr, int size, int inFileAddr);
+					// Copy a segment of the program
+					// into the address space
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
+    int StackTop(int slot);		// initial stack pointer for "slot"
 
 };
 
@@ -0,0 +1,300 @@
+// aio.cc
+//	Routines to carry out asynchronous I/O for user programs.
+//
+//	Requests from every process go on one queue, served by a fixed
+//	pool of worker threads, started the first time a program sets up
+//	an IoRing.  A worker does the same thing the Read and Write system
+//	calls do, except that it copies to and from the address space of
+//	the program that submitted the request, instead of the current
+//	one; then it posts the result.
+//
+//	The kernel never lets a program have more requests in flight than
+//	there are free slots in its completion ring, so a completion always
+//	has somewhere to go.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "aio.h"
+#include "main.h"
+#include "addrspace.h"
+#include "filetable.h"
+#include "synchlist.h"
+#include "syscall.h"
+
+// Byte offsets of the fields of an IoRing, as laid out by the (32-bit)
+// user program; see syscall.h.  The kernel may not be 32-bit itself, so
+// it cannot use sizeof on the structures.
+
+static const int SqHeadOffset = 0;
+static const int SqTailOffset = 4;
+static const int CqHeadOffset = 8;
+static const int CqTailOffset = 12;
+static const int RequestWords = 5;	// opcode, id, buffer, size, userData
+static const int SqOffset = 16;
+static const int CqOffset = SqOffset + IoRingSize * RequestWords * 4;
+extern const int IoRingBytes = CqOffset + IoRingSize * 2 * 4;
+
+// A request, taken off a submission ring and waiting for a worker.
+
+class IoJob {
+  public:
+    IoContext *context;		// who submitted it
+    int opcode;			// IoRead or IoWrite
+    int id;			// OpenFileId to read or write
+    int buffer;			// virtual address of the data
+    int size;			// # of bytes
+    int userData;		// passed back in the completion
+};
+
+static SynchList<IoJob *> *ioJobs = NULL;	// requests for the workers
+static Thread *ioWorkers[NumIoWorkers];		// the workers, and the
+static IoJob *ioWorking[NumIoWorkers];		// request each is on, or NULL
+
+//----------------------------------------------------------------------
+// IoWorker
+// 	Body of I/O worker thread # "arg": carry out requests, forever.
+//	A worker that is cancelled (see IoContext::Cancel) is cancelled
+//	for that one request only.
+//----------------------------------------------------------------------
+
+static void
+IoWorker(void *arg)
+{
+    int me = (int) (long) arg;
+
+    for (;;) {
+	IoJob *job = ioJobs->RemoveFront();
+
+	ioWorking[me] = job;
+	job->context->Run(job);
+	ioWorking[me] = NULL;
+	kernel->currentThread->ClearCancel();
+	delete job;
+    }
+}
+
+//----------------------------------------------------------------------
+// IoContext::IoContext
+// 	Initialize the asynchronous I/O state of a process.  The caller
+//	has checked that "ring" is a whole IoRing within "space".
+//	Requests the program queued before this are taken as they are.
+//----------------------------------------------------------------------
+
+IoContext::IoContext(AddrSpace *s, FileTable *f, int r)
+{
+    space = s;
+    files = f;
+    ring = r;
+    lock = new Lock("io context");
+    posted = new Condition("io posted");
+    sqHead = GetWord(SqHeadOffset);
+    cqTail = GetWord(CqTailOffset);
+    inFlight = 0;
+    cancelled = FALSE;
+
+    if (ioJobs == NULL) {		// first user: start up the workers
+	ioJobs = new SynchList<IoJob *>;
+	for (int i = 0; i < NumIoWorkers; i++) {
+	    ioWorkers[i] = new Thread("io worker");
+	    ioWorking[i] = NULL;
+	    ioWorkers[i]->Fork(IoWorker, (void *) (long) i);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// IoContext::~IoContext
+// 	The process is exiting.  Its requests still refer to its address
+//	space and files, so wait for the workers to finish them first.
+//	(Cancel them first, or this could take forever.)
+//----------------------------------------------------------------------
+
+IoContext::~IoContext()
+{
+    lock->Acquire();
+    while (inFlight > 0) {
+	posted->Wait(lock);
+    }
+    lock->Release();
+    delete lock;
+    delete posted;
+}
+
+//----------------------------------------------------------------------
+// IoContext::Cancel
+// 	The process is exiting: finish its requests as soon as possible.
+//	Workers carrying them out are cancelled (see Thread::Cancel), so
+//	that one waiting for input, or on a pipe, gives up; requests not
+//	started yet fail with EINTR without being tried.
+//----------------------------------------------------------------------
+
+void
+IoContext::Cancel()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    cancelled = TRUE;
+    for (int i = 0; i < NumIoWorkers; i++) {
+	if (ioWorking[i] != NULL && ioWorking[i]->context == this) {
+	    ioWorkers[i]->Cancel();
+	}
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// IoContext::GetWord, PutWord, NumPosted
+// 	Access the IoRing in user memory.
+//
+//	The completion ring's head is written by the user, so NumPosted
+//	can not trust it: a head that is not within IoRingSize behind
+//	the tail is taken to mean the ring is full.  Otherwise Submit
+//	could put more requests in flight than there is room for their
+//	results.
+//----------------------------------------------------------------------
+
+int
+IoContext::GetWord(int offset)
+{
+    int word;
+    int r = space->CopyIn(ring + offset, (char *) &word, sizeof(word));
+
+    ASSERT(r == sizeof(word));		// checked in SysIoSetup
+    return WordToHost(word);
+}
+
+void
+IoContext::PutWord(int offset, int value)
+{
+    int word = WordToMachine(value);
+    int r = space->CopyOut(ring + offset, (char *) &word, sizeof(word));
+
+    ASSERT(r == sizeof(word));
+}
+
+int
+IoContext::NumPosted()
+{
+    int n = cqTail - GetWord(CqHeadOffset);
+
+    if (n < 0 || n > IoRingSize) {
+	return IoRingSize;
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// IoContext::Submit
+// 	Take up to "count" requests off the submission ring, and queue
+//	them for the workers.  Stop early if the ring runs out, or if
+//	the completion ring could not hold any more results.
+//
+//	Returns the number of requests submitted.
+//----------------------------------------------------------------------
+
+int
+IoContext::Submit(int count)
+{
+    int sqTail, offset, n;
+    IoJob *job;
+
+    lock->Acquire();
+    sqTail = GetWord(SqTailOffset);
+    for (n = 0; n < count && sqHead != sqTail; n++) {
+	if (inFlight + NumPosted() >= IoRingSize) {
+	    break;
+	}
+	offset = SqOffset + (sqHead % IoRingSize) * RequestWords * 4;
+	job = new IoJob;
+	job->context = this;
+	job->opcode = GetWord(offset);
+	job->id = GetWord(offset + 4);
+	job->buffer = GetWord(offset + 8);
+	job->size = GetWord(offset + 12);
+	job->userData = GetWord(offset + 16);
+	sqHead++;
+	inFlight++;
+	ioJobs->Append(job);
+    }
+    PutWord(SqHeadOffset, sqHead);
+    lock->Release();
+
+    DEBUG(dbgSys, "IoSubmit started " << n << " requests");
+    return n;
+}
+
+//----------------------------------------------------------------------
+// IoContext::Wait
+// 	Wait until at least "min" completions are waiting on the
+//	completion ring, or there are no more requests in flight.
+//
+//	Returns the number of completions on the ring, or EINTR if the
+//	caller is cancelled while it waits.
+//----------------------------------------------------------------------
+
+int
+IoContext::Wait(int min)
+{
+    int n;
+
+    lock->Acquire();
+    while (NumPosted() < min && inFlight > 0) {
+	if (kernel->currentThread->IsCancelled()) {
+	    lock->Release();
+	    return EINTR;
+	}
+	posted->Wait(lock);
+    }
+    n = NumPosted();
+    lock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// IoContext::Run
+// 	Carry out a request, on behalf of the process that submitted it,
+//	then post the result: the number of bytes read or written, or a
+//	negative error code.  A size bigger than the whole address space
+//	is refused before any buffer is allocated for it.
+//----------------------------------------------------------------------
+
+void
+IoContext::Run(IoJob *job)
+{
+    char *buf = NULL;
+    int result, offset;
+
+    if (cancelled) {
+	result = EINTR;
+    } else if (job->size < 0 || job->size > MemorySize) {
+	result = EINVAL;		// no user buffer is that big
+    } else if (job->opcode == IoWrite) {
+	buf = new char[job->size];
+	result = space->CopyIn(job->buffer, buf, job->size);
+	if (result >= 0) {
+	    result = files->Write(job->id, buf, job->size);
+	}
+    } else if (job->opcode == IoRead) {
+	buf = new char[job->size];
+	result = files->Read(job->id, buf, job->size);
+	if (result > 0) {
+	    result = space->CopyOut(job->buffer, buf, result);
+	}
+    } else {
+	result = EINVAL;
+    }
+    delete [] buf;
+
+    lock->Acquire();
+    offset = CqOffset + (cqTail % IoRingSize) * 2 * 4;
+    PutWord(offset, job->userData);
+    PutWord(offset + 4, result);
+    cqTail++;
+    PutWord(CqTailOffset, cqTail);
+    inFlight--;
+    posted->Broadcast(lock);
+    lock->Release();
+}
@@ -0,0 +1,87 @@
+// aio.h
+//	Data structures for asynchronous I/O from user programs.
+//
+//	A user program that wants to keep several Read and Write
+//	operations in flight at once sets up an IoRing (see syscall.h) in
+//	its own memory.  It queues requests on the submission ring and
+//	calls IoSubmit; the kernel hands them to a pool of I/O worker
+//	threads, and returns right away.  As each request finishes, its
+//	worker posts the result on the completion ring, where the program
+//	can poll for it without a system call, or IoWait for it.
+//
+//	The kernel only ever touches the rings through the address space,
+//	so a worker can post a completion while some other program is
+//	running.
+//
+//	A worker reading the console does not hold up the simulation
+//	while there is nothing to read: like the Read system call, it
+//	waits for the host I/O watcher (see iowatcher.h) to say there is
+//	input, and other threads run in the meantime.  But there are
+//	limits to the overlap:
+//
+//	- The workers are Nachos threads, run by the same host thread as
+//	  everything else, so host I/O never runs alongside the
+//	  simulation.  What overlaps is waiting for input with running
+//	  other threads.
+//	- Writes to host files are made on the spot, and hold up the
+//	  simulation for as long as the host takes.
+//	- At most NumIoWorkers requests, from all processes together,
+//	  can be waiting at once; the rest queue up behind them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef AIO_H
+#define AIO_H
+
+#include "copyright.h"
+
+#define NumIoWorkers	4	// # of kernel threads doing async I/O
+
+extern const int IoRingBytes;	// size of an IoRing in user memory
+
+class AddrSpace;
+class FileTable;
+class Lock;
+class Condition;
+class IoJob;
+
+// The following class defines the asynchronous I/O state of a process:
+// where its rings are, and how many of its requests are in flight.
+
+class IoContext {
+  public:
+    IoContext(AddrSpace *space, FileTable *files, int ring);
+				// Use the IoRing at virtual address
+				// "ring" in "space"
+    ~IoContext();		// Wait for requests in flight, then
+				// de-allocate
+
+    int Submit(int count);	// Start up to "count" queued requests;
+				// return # started, or an error code
+    int Wait(int min);		// Wait for "min" completions to be
+				// posted; return # posted
+
+    void Run(IoJob *job);	// Carry out "job" (by a worker thread)
+    void Cancel();		// Give up on the requests in flight
+
+  private:
+    AddrSpace *space;		// address space holding the rings
+    FileTable *files;		// files the requests refer to
+    int ring;			// virtual address of the IoRing
+
+    Lock *lock;			// protects everything below
+    Condition *posted;		// signalled when a completion is posted
+    int sqHead;			// next request to take off the ring
+    int cqTail;			// next free slot in the completion ring
+    int inFlight;		// # of requests not yet completed
+    bool cancelled;		// fail requests, rather than do them?
+
+    int GetWord(int offset);	// Read/write a word of the IoRing
+    void PutWord(int offset, int value);
+    int NumPosted();		// # of completions the user has not
+				// taken off the ring
+};
+
+#endif // AIO_H
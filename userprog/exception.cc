@@ -25,6 +25,7 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+#include "hostprofile.h"
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -58,8 +59,24 @@ static void MovePC()
 	kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
 }
 
+/* Finish a system call, by going on to the next instruction -- unless
+   another thread of the process called Exit while this one was in the
+   kernel (perhaps cutting its wait short), in which case it leaves */
+static void ReturnFromSyscall()
+{
+	MovePC();
+	if (CurrentProcess()->exiting)
+	{
+		DEBUG(dbgSys, "Thread of exiting process " << CurrentProcess()->id << " leaves\n");
+		SysThreadExit(0);
+
+		ASSERTNOTREACHED();
+	}
+}
+
 void ExceptionHandler(ExceptionType which)
 {
+	HostTimer timer(HostException);
 	int type = kernel->machine->ReadRegister(2);
 	int result;
 
@@ -68,6 +85,15 @@ void ExceptionHandler(ExceptionType which)
 	switch (which)
 	{
 	case SyscallException:
+		kernel->currentThread->syscalls++;
+		if (CurrentProcess()->exiting)
+		{
+			/* another thread has called Exit; this one goes too */
+			DEBUG(dbgSys, "Thread of exiting process " << CurrentProcess()->id << " leaves\n");
+			SysThreadExit(0);
+
+			ASSERTNOTREACHED();
+		}
 		switch (type)
 		{
 		case SC_Halt:
@@ -110,40 +136,166 @@ void ExceptionHandler(ExceptionType which)
 		case SC_Strncmp:
 			DEBUG(dbgSys, "Strncmp str1:" << (int)kernel->machine->ReadRegister(4) << " str2:" << (int)kernel->machine->ReadRegister(5)
 										  << " len:" << (int)kernel->machine->ReadRegister(6) << "\n");
-			result = SysStrncmp((char *)kernel->machine->ReadRegister(4),
-									(char *)kernel->machine->ReadRegister(5),
+			result = SysStrncmp((int)kernel->machine->ReadRegister(4),
+									(int)kernel->machine->ReadRegister(5),
 									(int)kernel->machine->ReadRegister(6));
 			
 			kernel->machine->WriteRegister(2, (int)result);
-			MovePC();
+			ReturnFromSyscall();
 			return;
 
 		case SC_Write:
-			result = SysWrite((char *)kernel->machine->ReadRegister(4),
+			result = SysWrite((int)kernel->machine->ReadRegister(4),
 								  (int)kernel->machine->ReadRegister(5),
 								  (OpenFileId)kernel->machine->ReadRegister(6));
 			kernel->machine->WriteRegister(2, (int)result);
-			MovePC();
+			ReturnFromSyscall();
 			return;
 
 		case SC_Read:
-			result = SysRead((char *)kernel->machine->ReadRegister(4),
+			result = SysRead((int)kernel->machine->ReadRegister(4),
 								 (int)kernel->machine->ReadRegister(5),
 								 (OpenFileId)kernel->machine->ReadRegister(6));
 			kernel->machine->WriteRegister(2, (int)result);
-			MovePC();
+			ReturnFromSyscall();
 			return;
 
+		case SC_Exit:
+			DEBUG(dbgSys, "Exit " << kernel->machine->ReadRegister(4) << "\n");
+			SysExit((int)kernel->machine->ReadRegister(4));
+
+			ASSERTNOTREACHED();
+			break;
+
 		case SC_Exec:
-			result = SysExec((char *)kernel->machine->ReadRegister(4));
+			result = SysExec((int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_ExecIO:
+			result = SysExecIO((int)kernel->machine->ReadRegister(4),
+								   (OpenFileId)kernel->machine->ReadRegister(5),
+								   (OpenFileId)kernel->machine->ReadRegister(6));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_Close:
+			result = SysClose((OpenFileId)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_Pipe:
+			result = SysPipe(/* OpenFileId fds[2] */ (int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_IoSetup:
+			result = SysIoSetup(/* IoRing *ring */ (int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_IoSubmit:
+			result = SysIoSubmit((int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_IoWait:
+			result = SysIoWait((int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_SetTickets:
+			result = SysSetTickets((int)kernel->machine->ReadRegister(4));
 			kernel->machine->WriteRegister(2, (int)result);
-			MovePC();
+			ReturnFromSyscall();
+			return;
+
+		case SC_Sleep:
+			result = SysSleep((int)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
 			return;
 
 		case SC_Join:
 			result = SysJoin((int)kernel->machine->ReadRegister(4));
 			kernel->machine->WriteRegister(2, (int)result);
-			MovePC();
+			ReturnFromSyscall();
+			return;
+
+		case SC_ThreadFork:
+			DEBUG(dbgSys, "ThreadFork func:" << kernel->machine->ReadRegister(4) << "\n");
+			result = SysThreadFork(/* void (*func)() */ (int)kernel->machine->ReadRegister(4),
+								   /* return address, set up by start.s */ (int)kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_ThreadYield:
+			SysThreadYield();
+			ReturnFromSyscall();
+			return;
+
+		case SC_ThreadExit:
+			DEBUG(dbgSys, "ThreadExit " << kernel->machine->ReadRegister(4) << "\n");
+			SysThreadExit((int)kernel->machine->ReadRegister(4));
+
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_ThreadJoin:
+			result = SysThreadJoin((ThreadId)kernel->machine->ReadRegister(4));
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_getSpaceID:
+			result = SysGetSpaceID();
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_getThreadID:
+			result = SysGetThreadID();
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
+			return;
+
+		case SC_Ipc:
+			/* the last six arguments are on the user stack, above
+			   the space the caller reserves for r4-r7 */
+			{
+				int args[6];
+				int sp = kernel->machine->ReadRegister(StackReg);
+
+				if (kernel->currentThread->space->CopyIn(sp + 16, (char *)args, sizeof(args)) < 0)
+				{
+					result = EFAULT;
+				}
+				else
+				{
+					for (int i = 0; i < 6; i++)
+						args[i] = WordToHost(args[i]);
+					result = SysIpc(/* int sendDescriptor */ (int)kernel->machine->ReadRegister(4),
+									/* SpaceId r_space */ (SpaceId)kernel->machine->ReadRegister(5),
+									/* ThreadId r_thread */ (ThreadId)kernel->machine->ReadRegister(6),
+									/* int s_msg0 */ (int)kernel->machine->ReadRegister(7),
+									/* int s_msg1 */ args[0],
+									/* int receiveDescriptor */ args[1],
+									/* SpaceId *s_space */ args[2],
+									/* ThreadId *s_thread */ args[3],
+									/* int *r_msg0 */ args[4],
+									/* int *r_msg1 */ args[5]);
+				}
+			}
+			kernel->machine->WriteRegister(2, (int)result);
+			ReturnFromSyscall();
 			return;
 
 		default:
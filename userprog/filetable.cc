@@ -0,0 +1,307 @@
+// filetable.cc
+//	Routines to manage the open files of a user process.
+//
+//	Host descriptors are never closed on the host, since several
+//	processes share the host's stdin and stdout; closing one just
+//	forgets about it.  Pipe ends are counted, so that the pipe knows
+//	when it has lost its last reader or writer, and is deleted when
+//	both ends are gone.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "filetable.h"
+#include "pipe.h"
+#include "main.h"
+#include "syscall.h"
+#include "inputlog.h"
+#include "synch.h"
+#include "callback.h"
+
+#include <unistd.h>
+
+//----------------------------------------------------------------------
+// FileTable::FileTable
+// 	Initialize a file table, with the console open.
+//----------------------------------------------------------------------
+
+FileTable::FileTable()
+{
+    lock = new Lock("file table");
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	kind[i] = NotOpen;
+	pipe[i] = NULL;
+    }
+    kind[ConsoleInput] = kind[ConsoleOutput] = HostFile;
+    hostFile[ConsoleInput] = 0;		// host stdin
+    hostFile[ConsoleOutput] = 1;	// host stdout
+}
+
+//----------------------------------------------------------------------
+// FileTable::~FileTable
+// 	The process is done: close any files it left open.
+//----------------------------------------------------------------------
+
+FileTable::~FileTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	if (kind[i] != NotOpen) {
+	    (void) Close(i);
+	}
+    }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FileTable::FindFree
+// 	Return the lowest OpenFileId not in use, or -1 if they all are.
+//	The caller holds the lock.
+//----------------------------------------------------------------------
+
+int
+FileTable::FindFree()
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	if (kind[i] == NotOpen) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+// The following class lets a thread wait for a host file to have
+// something to read, while the rest of the simulation carries on.
+
+class HostInputWait : public CallBackObj {
+  public:
+    HostInputWait() { ready = new Semaphore("host input", 0); }
+    ~HostInputWait() { delete ready; }
+
+    Semaphore *ready;		// V'ed once there is input
+
+    void CallBack() { ready->V(); }
+};
+
+//----------------------------------------------------------------------
+// HostRead
+// 	Read from a host file (the console), logging what was read if
+//	input is being recorded, or taking it from the log, without
+//	reading the host file, if it is being played back.
+//
+//	The host read itself would stop the whole simulation until the
+//	user typed something, so first the thread waits, like a device,
+//	for the host I/O watcher to say there is input; other threads
+//	run in the meantime.  When the read comes, it has something to
+//	return at once.
+//
+//	Returns EINTR, without reading anything, if the thread is
+//	cancelled (see Thread::Cancel) before there is input.
+//----------------------------------------------------------------------
+
+static int
+HostRead(int fd, char *into, int size)
+{
+    InputLog *log = kernel->inputLog;
+    HostInputWait waiter;
+    bool ready;
+    int result;
+
+    kernel->interrupt->WhenReadable(fd, &waiter, ConsoleReadInt);
+    ready = waiter.ready->CancellableP();
+    kernel->interrupt->ForgetReadable(fd, &waiter);
+    if (!ready) {
+	return EINTR;
+    }
+    if (log != NULL && log->IsPlayingBack()) {
+	return log->Play(InputHostRead, into, size);
+    }
+    result = read(fd, into, (size_t) size);
+    if (log != NULL) {
+	log->Record(InputHostRead, into, result);
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Read, Write
+// 	Move data between a kernel buffer and an open file, depending
+//	on the kind of file.
+//
+//	The entry is looked up with the lock held, but the data are moved
+//	without it.  A pipe is entered first, so that it stays around even
+//	if another thread closes "id" meanwhile.
+//
+//	Returns the number of bytes moved, or EBADF if "id" is not open
+//	in the right direction.
+//----------------------------------------------------------------------
+
+int
+FileTable::Read(int id, char *into, int size)
+{
+    OpenFileKind k;
+    int fd, result;
+    PipeBuffer *p;
+
+    lock->Acquire();
+    k = IsOpen(id) ? kind[id] : NotOpen;
+    fd = (k == HostFile) ? hostFile[id] : -1;
+    p = (k == PipeReadEnd) ? pipe[id] : NULL;
+    if (p != NULL) {
+	p->Enter();
+    }
+    lock->Release();
+
+    switch (k) {
+      case HostFile:
+	return HostRead(fd, into, size);
+      case PipeReadEnd:
+	result = p->Read(into, size);
+	if (p->Leave()) {
+	    delete p;
+	}
+	return result;
+      default:
+	return EBADF;
+    }
+}
+
+int
+FileTable::Write(int id, char *from, int size)
+{
+    OpenFileKind k;
+    int fd, result;
+    PipeBuffer *p;
+
+    lock->Acquire();
+    k = IsOpen(id) ? kind[id] : NotOpen;
+    fd = (k == HostFile) ? hostFile[id] : -1;
+    p = (k == PipeWriteEnd) ? pipe[id] : NULL;
+    if (p != NULL) {
+	p->Enter();
+    }
+    lock->Release();
+
+    switch (k) {
+      case HostFile:
+	return write(fd, from, (size_t) size);
+      case PipeWriteEnd:
+	result = p->Write(from, size);
+	if (p->Leave()) {
+	    delete p;
+	}
+	return result;
+      default:
+	return EBADF;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileTable::Close
+// 	Close an open file.  For a pipe end, let the pipe know, and
+//	delete the pipe if this was the last end of it (and no thread is
+//	inside it; otherwise the last one out deletes it).
+//----------------------------------------------------------------------
+
+int
+FileTable::Close(int id)
+{
+    lock->Acquire();
+    if (!IsOpen(id)) {
+	lock->Release();
+	return EBADF;
+    }
+    CloseEntry(id);
+    lock->Release();
+    return 0;
+}
+
+void
+FileTable::CloseEntry(int id)
+{
+    if (kind[id] == PipeReadEnd || kind[id] == PipeWriteEnd) {
+	if (pipe[id]->CloseEnd(kind[id] == PipeWriteEnd)) {
+	    delete pipe[id];
+	}
+	pipe[id] = NULL;
+    }
+    kind[id] = NotOpen;
+}
+
+//----------------------------------------------------------------------
+// FileTable::OpenPipe
+// 	Create a new pipe, and give each end an OpenFileId.
+//----------------------------------------------------------------------
+
+int
+FileTable::OpenPipe(int *readId, int *writeId)
+{
+    int r, w;
+
+    lock->Acquire();
+    r = FindFree();
+    if (r < 0) {
+	lock->Release();
+	return EMFILE;
+    }
+    kind[r] = PipeReadEnd;		// reserve it, for FindFree
+    w = FindFree();
+    if (w < 0) {
+	kind[r] = NotOpen;
+	lock->Release();
+	return EMFILE;
+    }
+    kind[w] = PipeWriteEnd;
+    pipe[r] = pipe[w] = new PipeBuffer();
+    lock->Release();
+
+    *readId = r;
+    *writeId = w;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Inherit
+// 	Open "id" on the file that "fromId" refers to in the table of
+//	another process (whatever "id" referred to before is closed).
+//	Used by Exec to hand a new process its console.
+//
+//	The entry is copied (and a pipe end counted) with only "from"
+//	locked, then installed with only this table locked, so the two
+//	locks are never held together.
+//----------------------------------------------------------------------
+
+int
+FileTable::Inherit(int id, FileTable *from, int fromId)
+{
+    OpenFileKind k;
+    int fd;
+    PipeBuffer *p;
+
+    if (id < 0 || id >= MaxOpenFiles) {
+	return EBADF;
+    }
+    from->lock->Acquire();
+    if (!from->IsOpen(fromId)) {
+	from->lock->Release();
+	return EBADF;
+    }
+    k = from->kind[fromId];
+    fd = from->hostFile[fromId];
+    p = from->pipe[fromId];
+    if (p != NULL) {
+	p->AddEnd(k == PipeWriteEnd);
+    }
+    from->lock->Release();
+
+    lock->Acquire();
+    if (kind[id] != NotOpen) {
+	CloseEntry(id);
+    }
+    kind[id] = k;
+    hostFile[id] = fd;
+    pipe[id] = p;
+    lock->Release();
+    return 0;
+}
@@ -0,0 +1,67 @@
+// filetable.h
+//	Data structures for the open files of a user process.
+//
+//	An OpenFileId is an index into the process's file table.  An
+//	entry refers either to a host file descriptor (this is how the
+//	console is reached, since ConsoleInput and ConsoleOutput start out
+//	as the host's stdin and stdout), or to one end of a pipe.  Read
+//	and Write look at the kind of entry to decide where the data go.
+//
+//	Exec passes entries on to the new process, which is how a shell
+//	connects the programs of a pipeline together.
+//
+//	The threads of a process, and its I/O workers (see aio.h), may use
+//	its file table at the same time, so a lock protects the table.  It
+//	is not held across a Read or Write, which may wait for a long time.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "copyright.h"
+
+#define MaxOpenFiles	16	// # of open files per process
+
+class PipeBuffer;
+class Lock;
+
+// What an entry in a file table refers to.
+
+enum OpenFileKind { NotOpen, HostFile, PipeReadEnd, PipeWriteEnd };
+
+class FileTable {
+  public:
+    FileTable();		// Create a table with just the console
+				// open, as ConsoleInput and ConsoleOutput
+    ~FileTable();		// Close everything that is still open
+
+    int Read(int id, char *into, int size);
+    int Write(int id, char *from, int size);
+				// Read/write "id", whatever kind of file
+				// it is; return # of bytes, or a negative
+				// error code
+    int Close(int id);		// Close "id"; return 0, or EBADF
+
+    int OpenPipe(int *readId, int *writeId);
+				// Create a pipe, and open both ends of it;
+				// return 0, or EMFILE if there is no room
+    int Inherit(int id, FileTable *from, int fromId);
+				// Make "id" refer to what "fromId" refers
+				// to in "from"; return 0, or EBADF
+
+  private:
+    Lock *lock;				// protects the entries
+    OpenFileKind kind[MaxOpenFiles];	// what each entry refers to
+    int hostFile[MaxOpenFiles];		// host descriptor, for HostFile
+    PipeBuffer *pipe[MaxOpenFiles];	// the pipe, for the pipe ends
+
+    bool IsOpen(int id) {
+	return id >= 0 && id < MaxOpenFiles && kind[id] != NotOpen; }
+    int FindFree();		// lowest unused id, or -1
+    void CloseEntry(int id);	// Close "id", with the lock held
+};
+
+#endif // FILETABLE_H
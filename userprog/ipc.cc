@@ -0,0 +1,217 @@
+// ipc.cc
+//	Routines to pass short messages between user threads.
+//
+//	A message only goes into the queue if the owner of the mailbox
+//	is not already waiting for one.  Otherwise the sender copies it
+//	directly into the owner's buffer (which lives on the owner's
+//	kernel stack, in SysIpc) and wakes the owner up.  Since the
+//	owner only waits when the queue is empty, messages are still
+//	received in the order they were sent.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "ipc.h"
+#include "main.h"
+#include "synch.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// Mailbox::Mailbox
+// 	Initialize a mailbox.  It refuses messages until it has an
+//	owner (see Open).
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Mailbox::Mailbox(char *debugName)
+{
+    name = debugName;
+    lock = new Lock(debugName);
+    notFull = new Condition(debugName);
+    delivered = new Condition(debugName);
+    drained = new Condition(debugName);
+    closed = TRUE;
+    first = count = 0;
+    waiting = NULL;
+    numSenders = 0;
+}
+
+//----------------------------------------------------------------------
+// Mailbox::~Mailbox
+// 	De-allocate a mailbox.  The caller must have closed it, so
+//	no one is still using it.
+//----------------------------------------------------------------------
+
+Mailbox::~Mailbox()
+{
+    ASSERT(closed && numSenders == 0);
+    delete lock;
+    delete notFull;
+    delete delivered;
+    delete drained;
+}
+
+//----------------------------------------------------------------------
+// Mailbox::Open
+// 	Start accepting messages for a new owner.  Anything left over
+//	from the previous owner is thrown away.
+//----------------------------------------------------------------------
+
+void
+Mailbox::Open()
+{
+    lock->Acquire();
+    ASSERT(waiting == NULL && numSenders == 0);
+    closed = FALSE;
+    first = count = 0;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Mailbox::Close
+// 	Stop accepting messages, because the owner is going away.
+//	Senders waiting for room give up, and so does the owner, if it
+//	is waiting for a message.
+//
+//	We wait for the senders to leave before returning, so that
+//	the mailbox can be safely deleted along with the owner's
+//	address space.
+//----------------------------------------------------------------------
+
+void
+Mailbox::Close()
+{
+    lock->Acquire();
+    closed = TRUE;
+    notFull->Broadcast(lock);
+    delivered->Signal(lock);
+    while (numSenders > 0) {
+	drained->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Mailbox::Send
+// 	Deliver a message to the owner of the mailbox: directly, if it
+//	is waiting for one, otherwise through the queue.  If the queue
+//	is full, wait until the owner makes room.
+//
+//	Returns 0, or ESRCH if the mailbox is (or gets) closed before
+//	the message could be delivered.
+//----------------------------------------------------------------------
+
+int
+Mailbox::Send(IpcMessage *message)
+{
+    int result = 0;
+
+    lock->Acquire();
+    numSenders++;
+    while (count == MailboxSize && !closed) {
+	notFull->Wait(lock);
+    }
+    numSenders--;
+    if (closed) {
+	if (numSenders == 0) {
+	    drained->Signal(lock);
+	}
+	result = ESRCH;
+    } else if (waiting != NULL) {	// hand it over
+	ASSERT(count == 0);
+	*waiting = *message;
+	waiting = NULL;
+	delivered->Signal(lock);
+    } else {
+	queue[(first + count) % MailboxSize] = *message;
+	count++;
+    }
+    lock->Release();
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Mailbox::Receive
+// 	Take the oldest message out of the mailbox, or wait for one if
+//	there are none.  Only the owner may call this.
+//
+//	Returns 0, or EINTR if the mailbox was closed.
+//----------------------------------------------------------------------
+
+int
+Mailbox::Receive(IpcMessage *message)
+{
+    lock->Acquire();
+    if (closed) {
+	lock->Release();
+	return EINTR;
+    }
+    if (count > 0) {
+	*message = queue[first];
+	first = (first + 1) % MailboxSize;
+	count--;
+	notFull->Signal(lock);
+	lock->Release();
+	return 0;
+    }
+
+    ASSERT(waiting == NULL);		// only the owner receives
+    waiting = message;
+    while (waiting != NULL && !closed) {
+	delivered->Wait(lock);
+    }
+    if (waiting != NULL) {		// closed before anything came
+	waiting = NULL;
+	lock->Release();
+	return EINTR;
+    }
+    lock->Release();
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// Mailbox::SelfTest, SelfTestHelper
+// 	Test the mailbox, by having a helper thread send more messages
+//	than fit in the queue, some of them handed over directly, and
+//	then block on a full mailbox until it is closed.
+//----------------------------------------------------------------------
+
+static void
+SelfTestHelper(void *arg)
+{
+    Mailbox *mailbox = (Mailbox *) arg;
+    IpcMessage message;
+
+    message.fromSpace = message.fromThread = -1;
+    message.type = IpcShort;
+    for (int i = 0; i < 3 * MailboxSize; i++) {
+	message.word0 = i;
+	message.word1 = -i;
+	ASSERT(mailbox->Send(&message) == 0);
+    }
+    for (int i = 0; i <= MailboxSize; i++) {	// the last one blocks
+	ASSERT(mailbox->Send(&message) == (i < MailboxSize ? 0 : ESRCH));
+    }
+}
+
+void
+Mailbox::SelfTest()
+{
+    Thread *helper = new Thread("mailbox sender");
+    IpcMessage message;
+
+    Open();
+    helper->Fork(SelfTestHelper, this);
+    for (int i = 0; i < 3 * MailboxSize; i++) {
+	ASSERT(Receive(&message) == 0);
+	ASSERT(message.word0 == i && message.word1 == -i);
+    }
+    while (count < MailboxSize || numSenders == 0) {
+	kernel->currentThread->Yield();	// let the helper fill us up
+    }
+    Close();
+    ASSERT(Receive(&message) == EINTR);
+}
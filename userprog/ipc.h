@@ -0,0 +1,79 @@
+// ipc.h
+//	Data structures for message passing between user threads.
+//
+//	Every user thread has a mailbox, through which other threads
+//	(in any process) can send it short messages with the Ipc system
+//	call.  A mailbox is a small bounded queue, with a twist: if the
+//	owner is already blocked waiting for a message, the sender hands
+//	the message straight to it, and the queue is never touched.
+//
+//	Bulk data does not go through the mailbox at all; the sender maps
+//	its pages into the receiver's address space instead (see
+//	AddrSpace::MapShared), and just sends where they ended up.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IPC_H
+#define IPC_H
+
+#include "copyright.h"
+
+#define MailboxSize	4	// # of messages a mailbox can queue up
+
+class Lock;
+class Condition;
+
+// A message, as passed by Ipc: who sent it, what kind it is
+// (IpcShort or IpcMap), and two words of content.
+
+class IpcMessage {
+  public:
+    int fromSpace;		// SpaceId of the sender
+    int fromThread;		// ThreadId of the sender
+    int type;			// IpcShort, or IpcMap
+    int word0, word1;		// the message itself
+};
+
+// The following class defines a mailbox, owned by one user thread.
+
+class Mailbox {
+  public:
+    Mailbox(char *debugName);	// Create a closed mailbox
+    ~Mailbox();
+
+    void Open();		// Empty the mailbox, and start accepting
+				// messages for a new owner
+    void Close();		// Refuse further messages, wake up anyone
+				// blocked on the mailbox, and wait for
+				// them to get out of the way
+
+    int Send(IpcMessage *message);
+				// Deliver "message", waiting for room if
+				// need be; return 0, or ESRCH if closed
+    int Receive(IpcMessage *message);
+				// Owner waits for a message; return 0, or
+				// EINTR if the mailbox was closed
+
+    void SelfTest();		// test the mailbox
+
+  private:
+    char *name;			// useful for debugging
+    Lock *lock;			// protects everything below
+    bool closed;		// is the mailbox refusing messages?
+
+    IpcMessage queue[MailboxSize];	// circular queue of messages
+    int first;			// index of the oldest message
+    int count;			// # of messages in the queue
+    Condition *notFull;		// senders wait here for room
+
+    IpcMessage *waiting;	// the owner's buffer, if it is blocked
+				// in Receive and the queue is empty
+    Condition *delivered;	// owner waits here for "waiting" to fill
+
+    int numSenders;		// # of senders waiting for room
+    Condition *drained;		// Close waits here for them to leave
+};
+
+#endif // IPC_H
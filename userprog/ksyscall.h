@@ -12,6 +12,10 @@
 #define __USERPROG_KSYSCALL_H__ 
 
 #include "kernel.h"
+#include "proctable.h"
+#include "ipc.h"
+#include "filetable.h"
+#include "aio.h"
 
 
 #include <stdlib.h>
@@ -29,7 +33,7 @@
 #include <sys/types.h>
 #include <pthread.h>
 
-#define SHELL "/bin/sh"
+#define MaxExecName 127	/* longest file name Exec accepts */
 
 void SysHalt()
 {
@@ -42,43 +46,330 @@ int SysAdd(int op1, int op2)
   return op1 + op2;
 }
 
-int SysStrncmp(char *str1, char *str2, int n)
+/* Process running the current thread */
+static Process *CurrentProcess() {
+  Process *process =
+    kernel->processTable->Lookup(kernel->currentThread->space->getSpaceId());
+  ASSERT(process != NULL);
+  return process;
+}
+
+int SysStrncmp(int str1, int str2, int n)
 {
-  /*cerr << (char *)&kernel->machine->mainMemory[(int)str1] << endl <<
-                 (char *)&kernel->machine->mainMemory[(int)str2] << endl;*/
-  return strncmp((char *)&kernel->machine->mainMemory[(int)str1],
-                 (char *)&kernel->machine->mainMemory[(int)str2], n);
+  AddrSpace *space = kernel->currentThread->space;
+  char c1, c2;
+
+  for (int i = 0; i < n; i++) {
+    if (space->CopyIn(str1 + i, &c1, 1) < 0 ||
+        space->CopyIn(str2 + i, &c2, 1) < 0)
+      return EFAULT;
+    if (c1 != c2)
+      return (unsigned char) c1 - (unsigned char) c2;
+    if (c1 == '\0')
+      break;
+  }
+  return 0;
 }
 
-int SysWrite(char *buffer, int size, OpenFileId id) {
-  return write(id, (char *)&kernel->machine->mainMemory[(int)buffer], (size_t) size);
+/* No user buffer can be bigger than the address space, so a size past
+   MemorySize is an error, rather than a huge kernel allocation */
+int SysWrite(int buffer, int size, OpenFileId id) {
+  char *buf;
+  int r;
+
+  if (size < 0 || size > MemorySize)
+    return EINVAL;
+  buf = new char[size];
+  r = kernel->currentThread->space->CopyIn(buffer, buf, size);
+  if (r >= 0)
+    r = CurrentProcess()->files->Write(id, buf, size);
+  delete [] buf;
+  return r;
 }
 
-int SysRead(char *buffer, int size, OpenFileId id) {
-/*char s[9];
-  int i = 0;
-  do {read(id,&s[i],1);}while(s[i++]!='\n');s[--i]='\0';
-  cerr << s << endl;
-  SysHalt();*/  
-  int r = read(id, (char *)&kernel->machine->mainMemory[(int)buffer], (size_t) size);
-//cerr << (int)buffer << ':' << kernel->machine->mainMemory[(int)buffer] << ' ';
+int SysRead(int buffer, int size, OpenFileId id) {
+  char *buf;
+  int r;
+
+  if (size < 0 || size > MemorySize)
+    return EINVAL;
+  buf = new char[size];
+  r = CurrentProcess()->files->Read(id, buf, size);
+  if (r > 0)
+    r = kernel->currentThread->space->CopyOut(buffer, buf, r);
+  delete [] buf;
   return r;
 }
 
-SpaceId SysExec(char* exec_name) {
-//cerr << (char *)&kernel->machine->mainMemory[(int)exec_name] << endl;
-  pid_t child;
-  child = vfork();
-  if(child == 0) {
-    execl (SHELL, SHELL, "-c", (char *)&kernel->machine->mainMemory[(int)exec_name], NULL);
-    _exit (EXIT_FAILURE);
-  } else if(child < 0)
-    return EPERM;
-  return (SpaceId) child;
+/* Kernel thread body of a process started by Exec */
+static void ExecBegin(void *arg) {
+  kernel->currentThread->space->Execute();
+}
+
+SpaceId SysExecIO(int exec_name, OpenFileId input, OpenFileId output) {
+  char name[MaxExecName + 1];
+  int len = kernel->currentThread->space->CopyInString(exec_name, name,
+                                                       sizeof(name));
+  FileTable *parentFiles = CurrentProcess()->files;
+  FileTable *files;
+  AddrSpace *space;
+  Process *process;
+  Thread *thread;
+
+  if (len < 0)
+    return len;
+  files = new FileTable();
+  if (files->Inherit(ConsoleInput, parentFiles, input) < 0 ||
+      files->Inherit(ConsoleOutput, parentFiles, output) < 0) {
+    delete files;
+    return EBADF;
+  }
+  space = new AddrSpace;
+  if (!space->Load(name)) {
+    delete space;
+    delete files;
+    return ENOENT;
+  }
+  process = kernel->processTable->Create(CurrentProcess(), space);
+  if (process == NULL) {
+    delete space;
+    delete files;
+    return EAGAIN;
+  }
+  space->setSpaceId(process->id);
+  process->files = files;
+
+  /* register the main thread now, so that it can be sent messages
+   * even before it gets to run */
+  thread = new Thread("user program");
+  (void) space->AddThread(thread);
+  kernel->processTable->AddThread(process, thread);
+  thread->Fork((VoidFunctionPtr) ExecBegin, NULL);
+  return process->id;
+}
+
+SpaceId SysExec(int exec_name) {
+  return SysExecIO(exec_name, ConsoleInput, ConsoleOutput);
+}
+
+int SysClose(OpenFileId id) {
+  int r = CurrentProcess()->files->Close(id);
+
+  return r < 0 ? r : 1;
+}
+
+int SysPipe(int fds) {
+  FileTable *files = CurrentProcess()->files;
+  int ids[2];
+  int r = files->OpenPipe(&ids[0], &ids[1]);
+
+  if (r < 0)
+    return r;
+  ids[0] = WordToMachine(ids[0]);
+  ids[1] = WordToMachine(ids[1]);
+  if (kernel->currentThread->space->CopyOut(fds, (char *) ids,
+                                            sizeof(ids)) < 0) {
+    files->Close(WordToHost(ids[0]));
+    files->Close(WordToHost(ids[1]));
+    return EFAULT;
+  }
+  return 0;
+}
+
+int SysIoSetup(int ring) {
+  Process *process = CurrentProcess();
+  AddrSpace *space = kernel->currentThread->space;
+  char *buf;
+  int r;
+
+  if (process->io != NULL)
+    return EBUSY;
+  buf = new char[IoRingBytes];	/* make sure the whole ring is there */
+  r = space->CopyIn(ring, buf, IoRingBytes);
+  delete [] buf;
+  if (r < 0)
+    return r;
+  process->io = new IoContext(space, process->files, ring);
+  return 0;
+}
+
+int SysIoSubmit(int count) {
+  IoContext *io = CurrentProcess()->io;
+
+  return io == NULL ? EINVAL : io->Submit(count);
+}
+
+int SysIoWait(int min) {
+  IoContext *io = CurrentProcess()->io;
+
+  return io == NULL ? EINVAL : io->Wait(min);
 }
 
 int SysJoin(SpaceId id) {
-  return waitpid((pid_t) id, (int*) 0, 0);
+  return kernel->processTable->Join(CurrentProcess(), id);
+}
+
+/* Kernel thread body of a forked user thread */
+static void UserThreadBegin(void *arg) {
+  kernel->currentThread->space->ExecuteThread();
+}
+
+ThreadId SysThreadFork(int func, int whenDone) {
+  AddrSpace *space = kernel->currentThread->space;
+  Thread *thread = new Thread("user thread");
+  ThreadId id = space->AddThread(thread);
+
+  if (id < 0) {
+    delete thread;
+    return id;
+  }
+  thread->SetUserRegister(PCReg, func);
+  thread->SetUserRegister(NextPCReg, func + 4);
+  thread->SetUserRegister(RetAddrReg, whenDone);
+  kernel->processTable->AddThread(CurrentProcess(), thread);
+  thread->Fork((VoidFunctionPtr) UserThreadBegin, NULL);
+  return id;
+}
+
+void SysThreadYield() {
+  kernel->currentThread->Yield();
+}
+
+void SysThreadExit(int exitCode) {
+  Thread *thread = kernel->currentThread;
+  AddrSpace *space = thread->space;
+  Process *process = CurrentProcess();
+
+  if (thread->getTickets() == 0)	/* for the report at Halt */
+    thread->setTickets(space->getTickets());
+  kernel->processTable->RemoveThread(process, thread);
+  if (space->ThreadExit(exitCode) == 0) {
+    /* that was the last thread running the program; turn away Ipc,
+     * and wait for senders to let go of the space before deleting it */
+    thread->space = NULL;
+    space->CloseMailboxes();
+    kernel->processTable->DrainPins(process);
+    delete process->io;		/* waits for its requests in flight */
+    process->io = NULL;
+    delete process->files;	/* close its pipes, so readers see EOF */
+    process->files = NULL;
+    int running = kernel->processTable->Exit(process, process->exitStatus);
+    delete space;
+    if (running == 0) {
+      kernel->exitStatus = process->exitStatus;
+      SysHalt();			/* Halt reports this thread */
+    }
+  }
+  thread->Finish();
+}
+
+/* The other threads of the process follow, as they leave the kernel
+ * or next enter it (see ExceptionHandler); any that are waiting in
+ * the kernel are woken up first */
+void SysExit(int status) {
+  Process *process = CurrentProcess();
+
+  if (!process->exiting) {
+    process->exiting = TRUE;
+    process->exitStatus = status;
+    kernel->processTable->Cancel(process);
+    /* wake up threads blocked in Ipc, so that they can leave too */
+    kernel->currentThread->space->CloseMailboxes();
+  }
+  SysThreadExit(status);
+}
+
+int SysThreadJoin(ThreadId id) {
+  return kernel->currentThread->space->ThreadJoin(id);
+}
+
+int SysSetTickets(int tickets) {
+  if (tickets < 0 || tickets > MaxTickets)
+    return EINVAL;
+  kernel->currentThread->space->setTickets(tickets);
+  return 0;
+}
+
+int SysSleep(int ticks) {
+  if (ticks < 0)
+    return EINVAL;
+  kernel->alarm->WaitUntil(ticks);
+  return 0;
+}
+
+SpaceId SysGetSpaceID() {
+  return kernel->currentThread->space->getSpaceId();
+}
+
+ThreadId SysGetThreadID() {
+  return kernel->currentThread->userThreadId;
+}
+
+/* Store "value" at user address "vaddr", unless it is null */
+static int PutUserWord(int vaddr, int value) {
+  int word = WordToMachine(value);
+
+  if (vaddr == 0)
+    return 0;
+  return kernel->currentThread->space->CopyOut(vaddr, (char *) &word,
+                                               sizeof(word));
+}
+
+int SysIpc(int sendDescriptor, SpaceId r_space, ThreadId r_thread,
+           int s_msg0, int s_msg1, int receiveDescriptor,
+           int s_space, int s_thread, int r_msg0, int r_msg1) {
+  AddrSpace *space = kernel->currentThread->space;
+  IpcMessage message;
+  Process *receiver;
+  Mailbox *mailbox;
+  int r;
+
+  if (sendDescriptor != IpcNone) {
+    if (sendDescriptor != IpcShort && sendDescriptor != IpcMap)
+      return EINVAL;
+    /* the receiver's space, and so its mailboxes, stay put until Unpin */
+    receiver = kernel->processTable->Pin(r_space);
+    if (receiver == NULL)
+      return ESRCH;
+    mailbox = receiver->space->FindMailbox(r_thread);
+    if (mailbox == NULL) {
+      kernel->processTable->Unpin(receiver);
+      return ESRCH;
+    }
+
+    message.fromSpace = space->getSpaceId();
+    message.fromThread = kernel->currentThread->userThreadId;
+    message.type = sendDescriptor;
+    message.word0 = s_msg0;
+    message.word1 = s_msg1;
+    if (sendDescriptor == IpcMap) {
+      /* zero copy: the receiver gets the sender's page frames */
+      message.word0 = receiver->space->MapShared(space, s_msg0, s_msg1);
+      if (message.word0 < 0) {
+        kernel->processTable->Unpin(receiver);
+        return message.word0;
+      }
+    }
+    r = mailbox->Send(&message);
+    if (r < 0 && sendDescriptor == IpcMap)
+      receiver->space->UnmapShared(message.word0, s_msg1);
+    kernel->processTable->Unpin(receiver);
+    if (r < 0)
+      return r;
+  }
+
+  if (receiveDescriptor == IpcNone)
+    return 0;
+  mailbox = space->FindMailbox(kernel->currentThread->userThreadId);
+  r = mailbox->Receive(&message);
+  if (r < 0)
+    return r;
+  if (PutUserWord(s_space, message.fromSpace) < 0 ||
+      PutUserWord(s_thread, message.fromThread) < 0 ||
+      PutUserWord(r_msg0, message.word0) < 0 ||
+      PutUserWord(r_msg1, message.word1) < 0)
+    return EFAULT;
+  return message.type;
 }
 
 
@@ -0,0 +1,277 @@
+// pipe.cc
+//	Routines to move data between processes through a pipe.
+//
+//	Read returns as soon as there is any data at all, like a UNIX
+//	pipe, so a reader sees lines as they are written.  Write does not
+//	return until everything has been put in the buffer (possibly in
+//	several pieces, if the buffer is smaller than the data).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pipe.h"
+#include "main.h"
+#include "synch.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// PipeBuffer::PipeBuffer
+// 	Initialize an empty pipe, with one read end and one write end.
+//----------------------------------------------------------------------
+
+PipeBuffer::PipeBuffer()
+{
+    lock = new Lock("pipe");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+    first = count = 0;
+    readers = writers = 1;
+    users = 0;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::~PipeBuffer
+// 	De-allocate a pipe, once both ends are closed, and no thread
+//	is left inside it.
+//----------------------------------------------------------------------
+
+PipeBuffer::~PipeBuffer()
+{
+    ASSERT(readers == 0 && writers == 0 && users == 0);
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::AddEnd, CloseEnd
+// 	Keep track of the number of open read and write ends.  Closing
+//	the last write end wakes up the readers, so they can see end of
+//	file; closing the last read end wakes up the writers, so they can
+//	give up.
+//
+//	CloseEnd returns TRUE if both ends are now closed, and so the
+//	caller should delete the pipe -- unless some thread is still
+//	using it, in which case that thread deletes it in Leave.
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::AddEnd(bool writer)
+{
+    lock->Acquire();
+    if (writer) {
+	writers++;
+    } else {
+	readers++;
+    }
+    lock->Release();
+}
+
+bool
+PipeBuffer::CloseEnd(bool writer)
+{
+    bool unused;
+
+    lock->Acquire();
+    if (writer) {
+	ASSERT(writers > 0);
+	if (--writers == 0) {
+	    notEmpty->Broadcast(lock);
+	}
+    } else {
+	ASSERT(readers > 0);
+	if (--readers == 0) {
+	    notFull->Broadcast(lock);
+	}
+    }
+    unused = (readers == 0 && writers == 0 && users == 0);
+    lock->Release();
+    return unused;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Enter, Leave
+// 	Keep track of the threads using the pipe.  The file table calls
+//	Enter while it still holds the end open, before the Read or Write
+//	that may wait, and Leave once it returns.  Leave returns TRUE if
+//	the ends were closed meanwhile, and so the caller should delete
+//	the pipe.
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::Enter()
+{
+    lock->Acquire();
+    users++;
+    lock->Release();
+}
+
+bool
+PipeBuffer::Leave()
+{
+    bool unused;
+
+    lock->Acquire();
+    ASSERT(users > 0);
+    users--;
+    unused = (readers == 0 && writers == 0 && users == 0);
+    lock->Release();
+    return unused;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+// 	Wait until there is data in the pipe, or no one left to write
+//	any, then copy out as much as there is, up to "size" bytes.
+//
+//	Returns the number of bytes read, 0 at end of file, or EINTR if
+//	the reader is cancelled (see Thread::Cancel) while it waits.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Read(char *into, int size)
+{
+    int done;
+
+    lock->Acquire();
+    while (count == 0 && writers > 0) {
+	if (kernel->currentThread->IsCancelled()) {
+	    lock->Release();
+	    return EINTR;
+	}
+	notEmpty->Wait(lock);
+    }
+    for (done = 0; done < size && count > 0; done++) {
+	into[done] = buffer[first];
+	first = (first + 1) % PipeSize;
+	count--;
+    }
+    if (done > 0) {
+	notFull->Broadcast(lock);
+    }
+    lock->Release();
+    return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+// 	Copy "size" bytes into the pipe, waiting for readers to make room
+//	whenever it fills up.
+//
+//	Returns "size", or if all the read ends are closed first, the
+//	number of bytes written before then -- EPIPE if there were none.
+//	Likewise if the writer is cancelled while it waits, except that
+//	the error is EINTR.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Write(char *from, int size)
+{
+    Thread *writer = kernel->currentThread;
+    int done = 0;
+
+    lock->Acquire();
+    while (done < size && readers > 0) {
+	while (count == PipeSize && readers > 0 && !writer->IsCancelled()) {
+	    notFull->Wait(lock);
+	}
+	if (count == PipeSize) {
+	    break;			// no room, and no more waiting
+	}
+	for (; done < size && count < PipeSize; done++) {
+	    buffer[(first + count) % PipeSize] = from[done];
+	    count++;
+	}
+	notEmpty->Broadcast(lock);
+    }
+    if (done == 0 && size > 0) {
+	done = (readers > 0) ? EINTR : EPIPE;
+    }
+    lock->Release();
+    return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::SelfTest, SelfTestHelper
+// 	Test a pipe, by having a helper thread write a few times the
+//	size of the buffer through it, in pieces that do not line up
+//	with the pieces the reader asks for.  Then the helper closes
+//	its end, and the reader should see end of file.
+//
+//	Then check that a pipe outlives its ends while a reader is still
+//	inside it: close both ends of a second pipe while a helper is
+//	waiting to read from it; it is the helper that gets to delete it.
+//----------------------------------------------------------------------
+
+static const int SelfTestBytes = 3 * PipeSize + 17;
+static Semaphore *selfTestDone;		// V'ed once the reader is done
+
+static void
+SelfTestHelper(void *arg)
+{
+    PipeBuffer *pipe = (PipeBuffer *) arg;
+    char piece[7];
+    int done, n;
+
+    for (done = 0; done < SelfTestBytes; done += n) {
+	n = min(SelfTestBytes - done, (int) sizeof(piece));
+	for (int i = 0; i < n; i++) {
+	    piece[i] = (char) (done + i);
+	}
+	ASSERT(pipe->Write(piece, n) == n);
+    }
+    (void) pipe->CloseEnd(TRUE);
+}
+
+static void
+SelfTestReader(void *arg)
+{
+    PipeBuffer *pipe = (PipeBuffer *) arg;
+    char c;
+
+    ASSERT(pipe->Read(&c, 1) == 0);
+    if (pipe->Leave()) {
+	delete pipe;
+    }
+    selfTestDone->V();
+}
+
+void
+PipeBuffer::SelfTest()
+{
+    Thread *helper = new Thread("pipe writer");
+    PipeBuffer *other;
+    IntStatus oldLevel;
+    char piece[13];
+    int done, n;
+
+    helper->Fork(SelfTestHelper, this);
+    for (done = 0; (n = Read(piece, sizeof(piece))) > 0; done += n) {
+	for (int i = 0; i < n; i++) {
+	    ASSERT(piece[i] == (char) (done + i));
+	}
+    }
+    ASSERT(done == SelfTestBytes);
+
+    AddEnd(TRUE);			// no readers: writes fail
+    ASSERT(!CloseEnd(FALSE));
+    ASSERT(Write(piece, 1) == EPIPE);
+    ASSERT(CloseEnd(TRUE));
+
+    other = new PipeBuffer();
+    selfTestDone = new Semaphore("pipe test", 0);
+    helper = new Thread("pipe reader");
+    other->Enter();			// for the helper
+    helper->Fork(SelfTestReader, other);
+    while (helper->getStatus() != BLOCKED) {
+	kernel->currentThread->Yield();
+    }
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    ASSERT(!other->CloseEnd(TRUE));	// wakes the helper, but it
+    ASSERT(!other->CloseEnd(FALSE));	// cannot run (even on another
+    (void) kernel->interrupt->SetLevel(oldLevel);	// CPU) until now
+    selfTestDone->P();
+    delete selfTestDone;
+}
@@ -0,0 +1,71 @@
+// pipe.h
+//	Data structures for pipes between user processes.
+//
+//	A pipe is a fixed-size ring buffer in the kernel.  Writers wait
+//	while it is full, and readers while it is empty; both use
+//	condition variables, so a pipe is a monitor much like a bounded
+//	buffer.  The difference is that a pipe knows how many open read
+//	and write ends it has: when the last writer goes away, readers
+//	see end of file, and when the last reader goes away, writers get
+//	EPIPE instead of waiting forever.
+//
+//	A pipe also counts the threads that are using it (see Enter), so
+//	that it is not deleted while one of them is still waiting inside
+//	it -- say, a reader woken when the last write end was closed, that
+//	has not run yet when the last read end is closed too.
+//
+//	The class is called PipeBuffer, since syscall.h already gives the
+//	name Pipe to the system call that creates one.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+
+#define PipeSize	512	// # of bytes a pipe can hold
+
+class Lock;
+class Condition;
+
+class PipeBuffer {
+  public:
+    PipeBuffer();		// Create a pipe with one reader and
+				// one writer
+    ~PipeBuffer();
+
+    void AddEnd(bool writer);	// Another descriptor refers to a read
+				// (or write) end of the pipe
+    bool CloseEnd(bool writer);	// A read (or write) end is closed;
+				// return TRUE if none are left, and
+				// no one is using the pipe
+    void Enter();		// A thread is about to Read or Write
+    bool Leave();		// ... and now it is done; return TRUE
+				// if the pipe is no longer needed
+
+    int Read(char *into, int size);
+				// Wait for data, then read up to "size"
+				// bytes of it; return 0 at end of file
+    int Write(char *from, int size);
+				// Write all "size" bytes, waiting for
+				// room as needed; return EPIPE if no
+				// one is left to read them
+
+    void SelfTest();		// test the pipe
+
+  private:
+    Lock *lock;			// protects everything below
+    Condition *notEmpty;	// readers wait here for data
+    Condition *notFull;		// writers wait here for room
+    char buffer[PipeSize];	// circular buffer of data
+    int first;			// index of the oldest byte
+    int count;			// # of bytes in the buffer
+    int readers;		// # of open read ends
+    int writers;		// # of open write ends
+    int users;			// # of threads between Enter and Leave
+};
+
+#endif // PIPE_H
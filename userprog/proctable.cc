@@ -0,0 +1,514 @@
+// proctable.cc
+//	Routines to keep track of the user programs running on Nachos.
+//
+//	A process is "running" from the time it is created until its last
+//	thread finishes.  Then it is a zombie, until its parent Joins it,
+//	or exits without doing so.  Either way the entry is reaped: it goes
+//	back on the free stack, with its SpaceId advanced by the table size
+//	so that the next process to use the entry gets a different id.
+//
+//	The running processes are also kept on a dense array, so that
+//	listing them (e.g., for a shell's "jobs" command) never has to
+//	skip over free entries.  A process leaves it by swapping the last
+//	running process into its place.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "proctable.h"
+#include "main.h"
+#include "synch.h"
+#include "syscall.h"
+#include "aio.h"
+#include "filetable.h"
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+// 	Initialize an empty process table, with room for "size" processes.
+//	SpaceIds start out equal to the entry index.
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable(int sz)
+{
+    ASSERT(sz > 0);
+    size = sz;
+    entries = new Process[size];
+    freeEntries = new int[size];
+    running = new Process *[size];
+    for (int i = 0; i < size; i++) {
+	entries[i].id = i;
+	entries[i].inUse = FALSE;
+	entries[i].threads = new List<Thread *>;
+	entries[i].joinWait = new Condition("join");
+	entries[i].unpinned = new Condition("unpinned");
+	freeEntries[i] = size - 1 - i;	// so entry 0 is used first
+    }
+    numFree = size;
+    numRunning = 0;
+    lock = new Lock("process table");
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::~ProcessTable
+// 	De-allocate a process table.  Any processes still in it are
+//	simply forgotten.
+//----------------------------------------------------------------------
+
+ProcessTable::~ProcessTable()
+{
+    for (int i = 0; i < size; i++) {
+	delete entries[i].threads;
+	delete entries[i].joinWait;
+	delete entries[i].unpinned;
+    }
+    delete [] entries;
+    delete [] freeEntries;
+    delete [] running;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Create
+// 	Allocate an entry for a new process, running in "space", and
+//	make it a child of "parent" (or of no one, if "parent" is NULL).
+//
+//	Returns NULL if the table is full.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Create(Process *parent, AddrSpace *space)
+{
+    Process *process;
+
+    lock->Acquire();
+    if (numFree == 0) {
+	lock->Release();
+	return NULL;
+    }
+    process = &entries[freeEntries[--numFree]];
+    ASSERT(!process->inUse && process->threads->IsEmpty());
+    process->inUse = TRUE;
+    process->space = space;
+    process->files = NULL;
+    process->io = NULL;
+    process->exiting = FALSE;
+    process->exited = FALSE;
+    process->exitStatus = 0;
+    process->numPins = 0;
+    process->pinsRefused = FALSE;
+    process->firstChild = NULL;
+
+    process->parent = parent;
+    process->prevSibling = NULL;
+    if (parent != NULL) {
+	process->nextSibling = parent->firstChild;
+	if (parent->firstChild != NULL) {
+	    parent->firstChild->prevSibling = process;
+	}
+	parent->firstChild = process;
+    } else {
+	process->nextSibling = NULL;
+    }
+
+    process->liveIndex = numRunning;
+    running[numRunning++] = process;
+    lock->Release();
+
+    DEBUG(dbgAddr, "Created process " << process->id);
+    return process;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Lookup
+// 	Return the process with SpaceId "id", or NULL if there is none.
+//	An id left over from a process that has been reaped finds the
+//	entry recycled (or free), and so does not match.
+//
+//	No need for the lock: nothing here can cause a context switch.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Lookup(int id)
+{
+    Process *process;
+
+    if (id < 0) {
+	return NULL;
+    }
+    process = &entries[id % size];
+    if (!process->inUse || process->id != id) {
+	return NULL;
+    }
+    return process;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::AddThread, RemoveThread
+// 	Keep track of the kernel threads running a process.  There are
+//	at most MaxUserThreads of them, so a List is good enough.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::AddThread(Process *process, Thread *thread)
+{
+    lock->Acquire();
+    process->threads->Append(thread);
+    lock->Release();
+}
+
+void
+ProcessTable::RemoveThread(Process *process, Thread *thread)
+{
+    lock->Acquire();
+    process->threads->Remove(thread);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Cancel
+// 	Some thread of "process" has called Exit.  Its other threads may
+//	be waiting in the kernel for something that will never come --
+//	a pipe with no writer, the console, a thread or child that will
+//	never finish.  Cancel them all (see Thread::Cancel), so that each
+//	gives up with EINTR and leaves on its way out of the kernel;
+//	likewise for any asynchronous I/O the process has in flight.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Cancel(Process *process)
+{
+    lock->Acquire();
+    for (ListIterator<Thread *> it(process->threads); !it.IsDone();
+							it.Next()) {
+	if (it.Item() != kernel->currentThread) {
+	    it.Item()->Cancel();
+	}
+    }
+    lock->Release();
+    if (process->io != NULL) {
+	process->io->Cancel();
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Pin, Unpin, DrainPins
+// 	Keep a process's address space from being deleted while a thread
+//	of another process is using it -- sending Ipc to one of its
+//	mailboxes, say, which may mean waiting for room.
+//
+//	Once the last thread of the process leaves, it closes the
+//	mailboxes (so that senders stop waiting), then calls DrainPins
+//	to wait for them to let go, before deleting the address space.
+//	From then on Pin finds nothing.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Pin(int id)
+{
+    Process *process;
+
+    lock->Acquire();
+    process = Lookup(id);
+    if (process != NULL && (process->exited || process->pinsRefused)) {
+	process = NULL;
+    }
+    if (process != NULL) {
+	process->numPins++;
+    }
+    lock->Release();
+    return process;
+}
+
+void
+ProcessTable::Unpin(Process *process)
+{
+    lock->Acquire();
+    ASSERT(process->numPins > 0);
+    if (--process->numPins == 0) {
+	process->unpinned->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+void
+ProcessTable::DrainPins(Process *process)
+{
+    lock->Acquire();
+    process->pinsRefused = TRUE;
+    while (process->numPins > 0) {
+	process->unpinned->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exit
+// 	The last thread of "process" has finished, with "status".
+//	Its children become orphans -- those that have already exited
+//	are reaped, since no one is left to Join them.  The process
+//	itself is reaped right away if it is an orphan, otherwise it
+//	stays around for its parent, and anyone waiting to Join it
+//	is woken up.
+//
+//	Returns the number of processes that are still running.
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Exit(Process *process, int status)
+{
+    Process *child, *next;
+    Process *last;
+    int stillRunning;
+
+    lock->Acquire();
+    ASSERT(process->inUse && !process->exited);
+    DEBUG(dbgAddr, "Process " << process->id << " exits with " << status);
+
+    process->exited = TRUE;
+    process->exitStatus = status;
+    process->space = NULL;
+
+    last = running[--numRunning];	// take it off the running list
+    last->liveIndex = process->liveIndex;
+    running[process->liveIndex] = last;
+    process->liveIndex = -1;
+
+    for (child = process->firstChild; child != NULL; child = next) {
+	next = child->nextSibling;
+	child->parent = NULL;
+	child->prevSibling = child->nextSibling = NULL;
+	if (child->exited) {
+	    Free(child);
+	}
+    }
+    process->firstChild = NULL;
+
+    if (process->parent == NULL) {
+	Free(process);
+    } else {
+	process->joinWait->Broadcast(lock);
+    }
+    stillRunning = numRunning;
+    lock->Release();
+    return stillRunning;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Join
+// 	Wait for process "id", a child of "parent", to exit, then
+//	reap it and return its exit status.
+//
+//	Returns ESRCH if there is no such process (including if some
+//	other thread of the parent Joined it first), ECHILD if it is
+//	not a child of "parent", or EINTR if the joiner is cancelled
+//	(because the parent is exiting) while it waits.
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Join(Process *parent, int id)
+{
+    Process *process;
+    int status;
+
+    lock->Acquire();
+    process = Lookup(id);
+    if (process == NULL) {
+	lock->Release();
+	return ESRCH;
+    }
+    if (process->parent != parent) {
+	lock->Release();
+	return ECHILD;
+    }
+    while (!process->exited) {
+	if (kernel->currentThread->IsCancelled()) {
+	    lock->Release();
+	    return EINTR;
+	}
+	process->joinWait->Wait(lock);
+	if (Lookup(id) == NULL) {	// another joiner got here first
+	    lock->Release();
+	    return ESRCH;
+	}
+    }
+    status = process->exitStatus;
+    Free(process);
+    lock->Release();
+    return status;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Free
+// 	Return the entry of an exited process to the free stack.
+//	Caller must hold the table lock.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Free(Process *process)
+{
+    ASSERT(process->inUse && process->exited && process->firstChild == NULL);
+    DEBUG(dbgAddr, "Reaping process " << process->id);
+
+    if (process->parent != NULL) {	// unlink it from its siblings
+	if (process->prevSibling != NULL) {
+	    process->prevSibling->nextSibling = process->nextSibling;
+	} else {
+	    process->parent->firstChild = process->nextSibling;
+	}
+	if (process->nextSibling != NULL) {
+	    process->nextSibling->prevSibling = process->prevSibling;
+	}
+    }
+    while (!process->threads->IsEmpty()) {
+	process->threads->RemoveFront();
+    }
+    process->inUse = FALSE;
+    process->id += size;
+    freeEntries[numFree++] = process - entries;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Apply, Print
+// 	Apply a function to each running process, or print them all.
+//	These only look at the running list, not the whole table.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Apply(void (*func)(Process *))
+{
+    for (int i = 0; i < numRunning; i++) {
+	(*func)(running[i]);
+    }
+}
+
+static void
+ProcessPrint(Process *process)
+{
+    cout << process->id << "\t"
+	 << (process->parent != NULL ? process->parent->id : -1) << "\t"
+	 << process->threads->NumInList()
+	 << (process->exiting ? "\texiting" : "") << "\n";
+}
+
+void
+ProcessTable::Print()
+{
+    cout << "SpaceId\tParent\tThreads\n";
+    Apply(ProcessPrint);
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::SelfTest
+// 	Stress test the process table, by having kernel threads play the
+//	part of thousands of user processes.  Each batch of processes
+//	fills the table, and the children exit in a different order from
+//	the one in which the parent joins them.
+//
+//	Then check that exiting does not wait forever for a thread that
+//	is blocked in the kernel: a thread reading an empty pipe should
+//	give up once another thread of the process starts the exit, and
+//	that the exit waits for another process to unpin it.
+//----------------------------------------------------------------------
+
+static ProcessTable *selfTestTable;	// table the helpers run against
+static int selfTestPipe;		// the pipe SelfTestReader reads
+
+static void
+SelfTestChild(void *arg)
+{
+    Process *process = (Process *) arg;
+
+    for (int i = 0; i < process->id % 3; i++) {
+	kernel->currentThread->Yield();
+    }
+    selfTestTable->RemoveThread(process, kernel->currentThread);
+    selfTestTable->Exit(process, process->id * 2);
+}
+
+static void
+SelfTestReader(void *arg)
+{
+    Process *process = (Process *) arg;
+    char c;
+
+    ASSERT(process->files->Read(selfTestPipe, &c, 1) == EINTR);
+    ASSERT(process->exiting);
+    delete process->files;
+    process->files = NULL;
+    selfTestTable->RemoveThread(process, kernel->currentThread);
+    selfTestTable->DrainPins(process);
+    selfTestTable->Exit(process, process->exitStatus);
+}
+
+void
+ProcessTable::SelfTest()
+{
+    const int numProcesses = 4000;
+    Process *root, *child, *grandchild;
+    Thread *reader;
+    int *ids = new int[size];
+    int batch, created, i, id, writeEnd;
+
+    ASSERT(numRunning == 0);
+    selfTestTable = this;
+    root = Create(NULL, NULL);
+
+    for (created = 0; created < numProcesses; created += batch) {
+	for (batch = 0; (child = Create(root, NULL)) != NULL; batch++) {
+	    Thread *t = new Thread("process");
+	    ids[batch] = child->id;
+	    AddThread(child, t);
+	    t->Fork(SelfTestChild, child);
+	}
+	ASSERT(batch == size - 1);
+	ASSERT(numFree == 0);
+	for (i = batch - 1; i >= 0; i--) {
+	    ASSERT(Join(root, ids[i]) == ids[i] * 2);
+	    ASSERT(Lookup(ids[i]) == NULL);
+	    ASSERT(Join(root, ids[i]) == ESRCH);
+	}
+	ASSERT(root->firstChild == NULL && numRunning == 1);
+    }
+
+    // orphans: a zombie grandchild is reaped when its parent exits,
+    // and only the parent of a process may join it
+    child = Create(root, NULL);
+    grandchild = Create(child, NULL);
+    id = grandchild->id;
+    ASSERT(Join(root, id) == ECHILD);
+    ASSERT(Exit(grandchild, 1) == 2);
+    ASSERT(Lookup(id) != NULL);
+    ASSERT(Exit(child, 2) == 1);
+    ASSERT(Lookup(id) == NULL);
+    ASSERT(Join(root, child->id) == 2);
+
+    // exiting: the reader is blocked on the pipe (we hold the only
+    // write end, and write nothing), until we -- playing the thread
+    // that calls Exit -- cancel it; then it waits for us -- playing
+    // another process, sending to this one -- to unpin it
+    child = Create(root, NULL);
+    child->files = new FileTable();
+    ASSERT(child->files->OpenPipe(&selfTestPipe, &writeEnd) == 0);
+    reader = new Thread("blocked reader");
+    AddThread(child, reader);
+    reader->Fork(SelfTestReader, child);
+    while (reader->getStatus() != BLOCKED) {
+	kernel->currentThread->Yield();
+    }
+    ASSERT(Pin(child->id) == child);
+    child->exiting = TRUE;
+    child->exitStatus = 3;
+    Cancel(child);
+    while (!child->pinsRefused || reader->getStatus() != BLOCKED) {
+	kernel->currentThread->Yield();
+    }
+    ASSERT(Pin(child->id) == NULL && !child->exited);
+    Unpin(child);
+    ASSERT(Join(root, child->id) == 3);
+
+    ASSERT(Exit(root, 0) == 0);
+    ASSERT(numFree == size);
+    delete [] ids;
+}
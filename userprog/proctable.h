@@ -0,0 +1,126 @@
+// proctable.h
+//	Data structures to keep track of the user programs (processes)
+//	running on Nachos.
+//
+//	Every process started by Exec (or from the command line) has an
+//	entry in the process table, keyed by its SpaceId.  The entry
+//	outlives the process itself: once the process exits, the entry
+//	holds its exit status until the parent Joins it (or exits too).
+//
+//	The table is a dense array of preallocated entries.  A SpaceId
+//	is the index of its entry plus a multiple of the table size, so
+//	Lookup is one array reference plus a check that the entry has not
+//	been recycled since.  Creating, exiting, joining and reaping a
+//	process are all constant time, except that a process exiting
+//	has to disown each of its own children.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include "copyright.h"
+#include "list.h"
+
+#define MaxProcesses		32	// # of processes that can exist
+					// (running, or exited but not
+					// yet joined) at any one time
+
+class Thread;
+class AddrSpace;
+class Lock;
+class Condition;
+class FileTable;
+class IoContext;
+
+// The following class defines an entry in the process table.
+// Like TranslationEntry, it is a record rather than an object;
+// its fields are protected by the lock of the table it is in.
+
+class Process {
+  public:
+    int id;			// SpaceId of the process
+    AddrSpace *space;		// its address space, while it runs
+    List<Thread *> *threads;	// kernel threads running the process
+    FileTable *files;		// its open files, while it runs
+    IoContext *io;		// its asynchronous I/O, if it uses any
+
+    Process *parent;		// process that Exec'ed it, if still around
+    Process *firstChild;	// processes it Exec'ed, not yet reaped
+    Process *prevSibling;	// neighbours in the parent's list of
+    Process *nextSibling;	// children
+
+    bool exiting;		// has some thread called Exit?
+    bool exited;		// have all its threads finished?
+    int exitStatus;		// status to hand to the joiner
+    Condition *joinWait;	// joiners wait here for "exited"
+
+    int numPins;		// # of threads of other processes using
+				// its address space (see Pin)
+    bool pinsRefused;		// is its address space going away?
+    Condition *unpinned;	// DrainPins waits here for "numPins" == 0
+
+    bool inUse;			// is this entry allocated?
+    int liveIndex;		// position in the table's list of
+				// running processes, or -1
+};
+
+// The following class defines the process table itself.
+
+class ProcessTable {
+  public:
+    ProcessTable(int size);		// Create an empty table
+    ~ProcessTable();			// De-allocate the table
+
+    Process *Create(Process *parent, AddrSpace *space);
+					// Enter a new running process;
+					// return NULL if the table is full
+    Process *Lookup(int id);		// Find process "id"; NULL if there
+					// isn't one, or it has been reaped
+
+    void AddThread(Process *process, Thread *thread);
+    void RemoveThread(Process *process, Thread *thread);
+					// Keep track of the threads running
+					// "process"
+
+    void Cancel(Process *process);	// "process" is exiting: stop its
+					// other threads waiting in the
+					// kernel
+
+    Process *Pin(int id);		// Find running process "id", and
+					// keep its address space around
+					// until Unpin; NULL if none
+    void Unpin(Process *process);
+    void DrainPins(Process *process);	// Refuse any more Pins of
+					// "process", and wait for the
+					// current ones to be undone
+    int Exit(Process *process, int status);
+					// "process" has finished; return
+					// # of processes still running
+    int Join(Process *parent, int id);	// Wait for child "id" to exit;
+					// return its exit status, or a
+					// negative error code
+
+    int NumRunning() { return numRunning; }
+    void Apply(void (*func)(Process *));
+					// Apply "func" to every running
+					// process
+    void Print();			// List the running processes
+
+    void SelfTest();			// test the process table
+
+  private:
+    int size;				// # of entries in the table
+    Process *entries;			// the entries themselves
+    int *freeEntries;			// stack of free entries
+    int numFree;
+    Process **running;			// dense list of running processes
+    int numRunning;
+    Lock *lock;				// protects everything above
+
+    void Free(Process *process);	// Reap an exited process
+};
+
+#endif // PROCTABLE_H
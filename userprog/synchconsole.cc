@@ -100,10 +100,14 @@ SynchConsoleOutput::~SynchConsoleOutput()
 void
 SynchConsoleOutput::PutChar(char ch)
 {
+    long long start = kernel->stats->totalTicks;
+
     lock->Acquire();
     consoleOutput->PutChar(ch);
     waitFor->P();
     lock->Release();
+    kernel->stats->consoleWriteLatency.Record(
+				kernel->stats->totalTicks - start);
 }
 
 //----------------------------------------------------------------------
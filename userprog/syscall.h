@@ -39,6 +39,13 @@
 #define SC_getThreadID  18
 #define SC_Ipc          19
 #define SC_Clock        20
+#define SC_Pipe         21
+#define SC_ExecIO       22
+#define SC_IoSetup      23
+#define SC_IoSubmit     24
+#define SC_IoWait       25
+#define SC_SetTickets   26
+#define SC_Sleep        27
 
 #define SC_Add		42
 #define SC_Strncmp	43
@@ -84,6 +91,7 @@ typedef int ThreadId;
 
 /* Run the specified executable, with no args */
 /* This can be implemented as a call to ExecV.
+ * Returns the SpaceId of the new program, or a negative error code.
  */ 
 SpaceId Exec(char* exec_name);
 
@@ -94,7 +102,8 @@ SpaceId Exec(char* exec_name);
 SpaceId ExecV(int argc, char* argv[]);
  
 /* Only return once the user program "id" has finished.  
- * Return the exit status.
+ * Return the exit status.  Only the program that Exec'ed "id" may
+ * Join it, and only once (otherwise ECHILD or ESRCH is returned).
  */
 int Join(SpaceId id); 	
  
@@ -166,6 +175,81 @@ int Delete(char* name);
  */
 int Close(OpenFileId id);
 
+/* Create a pipe: a kernel buffer that can be written through fds[1]
+ * and read through fds[0].  Read waits for data, and returns 0 once
+ * every write end is closed; Write waits for room, and fails with
+ * EPIPE once every read end is closed.
+ * Return 0 on success, negative error code on failure
+ */
+int Pipe(OpenFileId fds[2]);
+
+/* Like Exec, but the new program's ConsoleInput and ConsoleOutput
+ * are the caller's "input" and "output" (Exec passes on the caller's
+ * own ConsoleInput and ConsoleOutput).  Used to set up pipelines.
+ */
+SpaceId ExecIO(char* exec_name, OpenFileId input, OpenFileId output);
+
+/* Asynchronous I/O.  A program queues Read and Write requests on the
+ * submission ring of an IoRing in its own memory, advancing sqTail,
+ * and calls IoSubmit; the kernel takes them off (advancing sqHead) and
+ * returns without waiting for them.  Each result is posted on the
+ * completion ring, advancing cqTail; the program takes it off by
+ * advancing cqHead.  Heads and tails only ever go up -- the slot
+ * is the count modulo IoRingSize.
+ */
+#define IoRingSize	8
+#define IoRead		0
+#define IoWrite		1
+
+typedef struct {
+    int opcode;			/* IoRead or IoWrite */
+    OpenFileId id;
+    char *buffer;
+    int size;
+    int userData;		/* handed back in the completion */
+} IoRequest;
+
+typedef struct {
+    int userData;
+    int result;			/* as Read or Write would return it */
+} IoCompletion;
+
+typedef struct {
+    int sqHead, sqTail;
+    int cqHead, cqTail;
+    IoRequest sq[IoRingSize];
+    IoCompletion cq[IoRingSize];
+} IoRing;
+
+/* Use "ring" for this program's asynchronous I/O.  Return 0, or a
+ * negative error code.
+ */
+int IoSetup(IoRing *ring);
+
+/* Start up to "count" of the queued requests.  Fewer are started if
+ * the completion ring could not hold all of their results.  Return
+ * the number started.
+ */
+int IoSubmit(int count);
+
+/* Wait until at least "min" completions are on the completion ring
+ * (or nothing more is in flight); return the number there are.
+ */
+int IoWait(int min);
+
+/* Give each thread of this program "tickets" tickets, which sets its
+ * share of the CPU under a proportional share scheduling policy (see
+ * the -sp flag); 0 goes back to the default.  Return 0, or a negative
+ * error code.
+ */
+int SetTickets(int tickets);
+
+/* Put the calling thread to sleep for at least "ticks" ticks of
+ * simulated time (it wakes at the next timer interrupt after that).
+ * Return 0, or a negative error code.
+ */
+int Sleep(int ticks);
+
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
@@ -174,7 +258,8 @@ int Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread.  The thread runs on its own user stack; if
+ * "func" returns, the thread exits as if it had called ThreadExit(0).
  * Return a positive ThreadId on success, negative error code on failure
  */
 ThreadId ThreadFork(void (*func)());
@@ -207,8 +292,29 @@ ThreadId getThreadID();
 
 /*
  * IPC Inter Process Communication
+ *
+ * Send a message to thread "r_thread" of address space "r_space", then
+ * wait for a message from anyone, as selected by the two descriptors:
+ *
+ *   IpcNone   skip this half of the call.
+ *   IpcShort  the message is the two words "s_msg0" and "s_msg1".
+ *   IpcMap    share the "s_msg1" pages starting at the page-aligned
+ *             address "s_msg0" with "r_space"; the receiver gets the
+ *             address they are mapped at, and the number of pages.
+ *
+ * If the receiver has no room for another message, the sender waits.
+ * Any receiveDescriptor but IpcNone accepts either kind of message;
+ * the sender and the message are stored through whichever of "s_space",
+ * "s_thread", "r_msg0" and "r_msg1" are not null.
+ *
+ * Returns the kind of message received (or 0, if none was asked for),
+ * or a negative error code.
  */
-void Ipc(int sendDescriptor, SpaceId r_space, ThreadId r_thread,
+#define IpcNone		0
+#define IpcShort	1
+#define IpcMap		2
+
+int Ipc(int sendDescriptor, SpaceId r_space, ThreadId r_thread,
 	 int s_msg0, int s_msg1,
 	 int receiveDescriptor, SpaceId * s_space, ThreadId * s_thread,
 	 int * r_msg0, int * r_msg1);